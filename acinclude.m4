@@ -124,6 +124,21 @@ static int f (int (*func)(int, const struct sigaction *, struct sigaction *))
     [Define if you have a working sigaction function.])
 ],[AC_MSG_RESULT(no)])
 
+dnl popen is only used by the tests, to read from a non-seekable stream.
+dnl As for sigaction, its prototype may not be available.
+AC_MSG_CHECKING(for popen and pclose)
+AC_LINK_IFELSE([AC_LANG_PROGRAM([[
+#include <stdio.h>
+]], [[
+ FILE *(*f)(const char *, const char *) = popen;
+ int (*g)(FILE *) = pclose;
+ return f == 0 || g == 0;
+]])], [
+   AC_MSG_RESULT(yes)
+   AC_DEFINE(HAVE_POPEN, 1,
+    [Define if you have working popen and pclose functions.])
+],[AC_MSG_RESULT(no)])
+
 dnl check for long long
 AC_CHECK_TYPE([long long int],
    AC_DEFINE(HAVE_LONG_LONG, 1, [Define if compiler supports long long]),,)
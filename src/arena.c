@@ -0,0 +1,148 @@
+/* mpfr_arena_init, mpfr_arena_reset, mpfr_arena_clear, mpfr_init2_arena --
+   allocation of significands in an arena
+
+Copyright 2016 Free Software Foundation, Inc.
+Contributed by the AriC and Caramba projects, INRIA.
+
+This file is part of the GNU MPFR Library.
+
+The GNU MPFR Library is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+The GNU MPFR Library is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with the GNU MPFR Library; see the file COPYING.LESSER.  If not, see
+http://www.gnu.org/licenses/ or write to the Free Software Foundation, Inc.,
+51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA. */
+
+
+#include "mpfr-impl.h"
+
+/* An arena is a list of chunks, in which the significands are allocated
+   one after the other (bump allocation), with the same layout as in
+   mpfr_init2: the allocation size, then the limbs. The allocation size is
+   stored negated, so that the significands are not freed by mpfr_clear
+   and are moved to the heap if mpfr_set_prec or mpfr_prec_round need more
+   limbs (see MPFR_IS_ARENA_ALLOC). Only the last chunk is used for new
+   allocations; the previous ones are kept until mpfr_arena_reset or
+   mpfr_arena_clear. */
+
+/* Default size of the first chunk, in bytes. */
+#define MPFR_ARENA_DEFAULT_SIZE 4096
+
+/* Header of a chunk; the union keeps the significands suitably aligned. */
+typedef union {
+  struct {
+    void  *prev;  /* previous chunk, NULL for the first one */
+    size_t size;  /* size of the chunk in bytes, header included */
+  } h;
+  mpfr_size_limb_t align;
+} mpfr_arena_chunk_t;
+
+void
+mpfr_arena_init (mpfr_arena_ptr a, size_t size)
+{
+  a->_mpfr_chunk = NULL;
+  a->_mpfr_used = 0;
+  a->_mpfr_size = size != 0 ? size : MPFR_ARENA_DEFAULT_SIZE;
+}
+
+/* Add to the arena a chunk with at least size available bytes, and at
+   least twice as large as the last one. */
+static void
+arena_grow (mpfr_arena_ptr a, size_t size)
+{
+  mpfr_arena_chunk_t *c;
+  size_t n;
+
+  n = a->_mpfr_chunk == NULL ? a->_mpfr_size : 2 * a->_mpfr_size;
+  if (n < sizeof (mpfr_arena_chunk_t) + size)
+    n = sizeof (mpfr_arena_chunk_t) + size;
+  c = (mpfr_arena_chunk_t *) (*__gmp_allocate_func) (n);
+  c->h.prev = a->_mpfr_chunk;
+  c->h.size = n;
+  a->_mpfr_chunk = c;
+  a->_mpfr_used = sizeof (mpfr_arena_chunk_t);
+  a->_mpfr_size = n;
+}
+
+/* Free the chunks from c, following the list of the previous chunks.
+   Return the total size of the freed chunks. */
+static size_t
+arena_free (mpfr_arena_chunk_t *c)
+{
+  mpfr_arena_chunk_t *prev;
+  size_t total;
+
+  for (total = 0; c != NULL; c = prev)
+    {
+      prev = (mpfr_arena_chunk_t *) c->h.prev;
+      total += c->h.size;
+      (*__gmp_free_func) (c, c->h.size);
+    }
+  return total;
+}
+
+void
+mpfr_arena_reset (mpfr_arena_ptr a)
+{
+  mpfr_arena_chunk_t *c;
+
+  c = (mpfr_arena_chunk_t *) a->_mpfr_chunk;
+  if (c == NULL)
+    return;
+  if (c->h.prev != NULL)
+    {
+      /* Replace all the chunks by a single one, large enough for the
+         same allocations: the next uses of the arena will not need to
+         allocate any memory. */
+      size_t total = arena_free (c);
+      a->_mpfr_chunk = NULL;
+      a->_mpfr_size = total;
+      arena_grow (a, 0);
+    }
+  a->_mpfr_used = sizeof (mpfr_arena_chunk_t);
+}
+
+void
+mpfr_arena_clear (mpfr_arena_ptr a)
+{
+  arena_free ((mpfr_arena_chunk_t *) a->_mpfr_chunk);
+  a->_mpfr_chunk = NULL;
+  a->_mpfr_used = 0;
+  a->_mpfr_size = 0;
+}
+
+MPFR_HOT_FUNCTION_ATTR void
+mpfr_init2_arena (mpfr_ptr x, mpfr_prec_t p, mpfr_arena_ptr a)
+{
+  mp_size_t xsize;
+  size_t size;
+  mpfr_limb_ptr tmp;
+
+  MPFR_ASSERTN (MPFR_PREC_COND (p));
+
+  xsize = MPFR_PREC2LIMBS (p);
+  /* keep the next allocation aligned like this one */
+  size = MPFR_MALLOC_SIZE (xsize) + sizeof (mpfr_size_limb_t) - 1;
+  size -= size % sizeof (mpfr_size_limb_t);
+  if (MPFR_UNLIKELY (a->_mpfr_size - a->_mpfr_used < size
+                     || a->_mpfr_chunk == NULL))
+    arena_grow (a, size);
+  tmp = (mpfr_limb_ptr) ((char *) a->_mpfr_chunk + a->_mpfr_used);
+  a->_mpfr_used += size;
+
+  MPFR_PREC(x) = p;                /* Set prec */
+  MPFR_EXP (x) = MPFR_EXP_INVALID; /* make sure that the exp field has a
+                                      valid value in the C point of view */
+  MPFR_SET_POS(x);                 /* Set a sign */
+  MPFR_SET_MANT_PTR(x, tmp);       /* Set Mantissa ptr */
+  MPFR_SET_ALLOC_SIZE(x, -xsize);  /* Owned by the arena */
+  MPFR_SET_NAN(x);                 /* initializes to NaN */
+}
@@ -0,0 +1,129 @@
+/* mpfr_array_init2, mpfr_array_set_prec, mpfr_array_clear -- arrays of
+   numbers of the same precision with their significands in one block
+
+Copyright 2016 Free Software Foundation, Inc.
+Contributed by the AriC and Caramba projects, INRIA.
+
+This file is part of the GNU MPFR Library.
+
+The GNU MPFR Library is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+The GNU MPFR Library is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with the GNU MPFR Library; see the file COPYING.LESSER.  If not, see
+http://www.gnu.org/licenses/ or write to the Free Software Foundation, Inc.,
+51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA. */
+
+#include "mpfr-impl.h"
+
+/* The significands of x[0], ..., x[n-1] are stored one after the other
+   with a fixed stride, each one with the layout of mpfr_init2 (the
+   allocation size, then the limbs). As for an arena, the allocation size
+   is stored negated, so that mpfr_clear ignores them (see
+   MPFR_IS_ARENA_ALLOC). The first significand is aligned on
+   MPFR_ARRAY_ALIGN bytes and preceded by a header giving the pointer and
+   the size of the allocated block. */
+
+/* Alignment of the first significand (a typical cache line size) */
+#define MPFR_ARRAY_ALIGN 64
+
+typedef union {
+  struct {
+    void  *block; /* allocated block */
+    size_t size;  /* its size in bytes */
+  } h;
+  mpfr_size_limb_t align;
+} mpfr_array_header_t;
+
+/* Set the significands of x[0], ..., x[n-1] to those of xsize limbs of a
+   newly allocated block, and their precision to p. */
+static void
+array_alloc (mpfr_ptr x, size_t n, mp_size_t xsize, mpfr_prec_t p)
+{
+  size_t stride, size, i;
+  char *block, *start;
+  mpfr_array_header_t *h;
+
+  stride = MPFR_MALLOC_SIZE (xsize);
+  MPFR_ASSERTN (n <= (((size_t) -1) - sizeof (mpfr_array_header_t)
+                      - MPFR_ARRAY_ALIGN) / stride);
+  size = sizeof (mpfr_array_header_t) + MPFR_ARRAY_ALIGN - 1 + n * stride;
+  block = (char *) (*__gmp_allocate_func) (size);
+  start = block + sizeof (mpfr_array_header_t);
+  start += (MPFR_ARRAY_ALIGN - (size_t) start % MPFR_ARRAY_ALIGN)
+    % MPFR_ARRAY_ALIGN;
+  h = (mpfr_array_header_t *) start - 1;
+  h->h.block = block;
+  h->h.size = size;
+
+  for (i = 0; i < n; i++)
+    {
+      mpfr_ptr y = x + i;
+
+      MPFR_PREC (y) = p;
+      MPFR_EXP (y) = MPFR_EXP_INVALID;
+      MPFR_SET_POS (y);
+      MPFR_SET_MANT_PTR (y, start + i * stride);
+      MPFR_SET_ALLOC_SIZE (y, -xsize);
+      MPFR_SET_NAN (y);
+    }
+}
+
+/* Free the block of the array x of size n > 0. */
+static void
+array_free (mpfr_ptr x)
+{
+  mpfr_array_header_t *h;
+
+  /* the significand of x[0] must not have left the block */
+  MPFR_ASSERTN (MPFR_IS_ARENA_ALLOC (x));
+  h = (mpfr_array_header_t *) MPFR_GET_REAL_PTR (x) - 1;
+  (*__gmp_free_func) (h->h.block, h->h.size);
+}
+
+void
+mpfr_array_init2 (mpfr_ptr x, size_t n, mpfr_prec_t p)
+{
+  MPFR_ASSERTN (MPFR_PREC_COND (p));
+  if (n > 0)
+    array_alloc (x, n, MPFR_PREC2LIMBS (p), p);
+}
+
+void
+mpfr_array_set_prec (mpfr_ptr x, size_t n, mpfr_prec_t p)
+{
+  mp_size_t xsize;
+  size_t i;
+
+  MPFR_ASSERTN (MPFR_PREC_COND (p));
+  if (n == 0)
+    return;
+
+  /* Reallocate the block only if the new size is greater than the old */
+  xsize = MPFR_PREC2LIMBS (p);
+  if (xsize > - MPFR_GET_ALLOC_SIZE (x))
+    {
+      array_free (x);
+      array_alloc (x, n, xsize, p);
+    }
+  else
+    for (i = 0; i < n; i++)
+      {
+        MPFR_PREC (x + i) = p;
+        MPFR_SET_NAN (x + i);
+      }
+}
+
+void
+mpfr_array_clear (mpfr_ptr x, size_t n)
+{
+  if (n > 0)
+    array_free (x);
+}
@@ -23,6 +23,51 @@ http://www.gnu.org/licenses/ or write to the Free Software Foundation, Inc.,
 #define MPFR_NEED_LONGLONG_H
 #include "mpfr-impl.h"
 
+/* Put in S*2^(*eS) an approximation of A*2^eA + B*2^eB, where A > 0 and
+   B > 0, with a relative error less than 2^(1-prec): the result is exact
+   if it fits on about prec bits, otherwise its low bits are truncated.
+   S may be the same variable as A; B is destroyed. */
+static void
+mpfr_atan_add_2exp (mpz_ptr S, mpfr_exp_t *eS, mpz_srcptr A, mpfr_exp_t eA,
+                    mpz_ptr B, mpfr_exp_t eB, mpfr_prec_t prec)
+{
+  mpfr_prec_t sA, sB;
+  mpfr_exp_t e;
+
+  MPFR_ASSERTD (mpz_sgn (A) > 0 && mpz_sgn (B) > 0);
+  MPFR_MPZ_SIZEINBASE2 (sA, A);
+  MPFR_MPZ_SIZEINBASE2 (sB, B);
+  /* A*2^eA + B*2^eB >= 2^(e+prec), where e is the first term of the
+     maximum; each truncation below yields an error less than 2^e */
+  e = MAX (MAX (eA + sA, eB + sB) - prec - 1, MIN (eA, eB));
+  if (eA >= e)
+    mpz_mul_2exp (S, A, eA - e);
+  else
+    mpz_tdiv_q_2exp (S, A, e - eA);
+  if (eB >= e)
+    mpz_mul_2exp (B, B, eB - e);
+  else
+    mpz_tdiv_q_2exp (B, B, e - eB);
+  mpz_add (S, S, B);
+  *eS = e;
+}
+
+/* Truncate Q > 0 to prec bits, and add the shift count to *eQ, so that
+   Q*2^(*eQ) gets a relative error less than 2^(1-prec). */
+static void
+mpfr_atan_trunc (mpz_ptr Q, mpfr_exp_t *eQ, mpfr_prec_t prec)
+{
+  mpfr_prec_t sQ;
+
+  MPFR_ASSERTD (mpz_sgn (Q) > 0);
+  MPFR_MPZ_SIZEINBASE2 (sQ, Q);
+  if (sQ > prec)
+    {
+      mpz_tdiv_q_2exp (Q, Q, sQ - prec);
+      *eQ += sQ - prec;
+    }
+}
+
 /* If x = p/2^r, put in y an approximation of atan(x)/x using 2^m terms
    for the series expansion, with an error of at most 1 ulp.
    Assumes |x| < 1.
@@ -33,6 +78,16 @@ http://www.gnu.org/licenses/ or write to the Free Software Foundation, Inc.,
 
    When we sum terms up to x^k/(2k+1), the denominator Q[0] is
    3*5*7*...*(2k+1) ~ (2k/e)^k.
+
+   In huge precision, the exact S[k] and Q[k] would get much larger than
+   the target precision, increasing both the memory usage and the cost of
+   the products. Thus each S[k] and Q[k] obtained by a combination is
+   truncated to prect = precy + m + 2*GMP_NUMB_BITS bits, the actual values
+   being S[k]*2^eS[k] and Q[k]*2^eQ[k]. Since all S[k] and Q[k] are positive,
+   the errors do not cancel, and each truncation (less than 2^(m+2) in
+   total) contributes a relative error less than 2^(1-prect) to S[0] or
+   Q[0]: the additional relative error on S[0]/Q[0] is less than
+   2^(-precy-2*GMP_NUMB_BITS+4).
 */
 static void
 mpfr_atan_aux (mpfr_ptr y, mpz_ptr p, long r, int m, mpz_t *tab)
@@ -43,7 +98,9 @@ mpfr_atan_aux (mpfr_ptr y, mpz_ptr p, long r, int m, mpz_t *tab)
   int im, done;
   mpfr_prec_t mult;
   mpfr_prec_t accu[MPFR_PREC_BITS], log2_nb_terms[MPFR_PREC_BITS];
+  mpfr_exp_t eS[MPFR_PREC_BITS], eQ[MPFR_PREC_BITS];
   mpfr_prec_t precy = MPFR_PREC(y);
+  mpfr_prec_t prect = precy + m + 2 * GMP_NUMB_BITS;
 
   MPFR_ASSERTD(mpz_cmp_ui (p, 0) != 0);
   MPFR_ASSERTD (m+1 <= MPFR_PREC_BITS);
@@ -103,6 +160,7 @@ mpfr_atan_aux (mpfr_ptr y, mpz_ptr p, long r, int m, mpz_t *tab)
           mpz_mul_2exp (S[k], Q[k+1], r);
           mpz_sub (S[k], S[k], S[k+1]); /* S(i,i+2) */
           mpz_mul_ui (Q[k], Q[k+1], 2 * i + 1); /* Q(i,i+2) */
+          eS[k] = eQ[k] = 0;
           log2_nb_terms[k] = 1; /* S[k]/Q[k] corresponds to 2 terms */
           for (j = (i + 2) >> 1, l = 1; (j & 1) == 0; l ++, j >>= 1, k --)
             {
@@ -112,9 +170,12 @@ mpfr_atan_aux (mpfr_ptr y, mpz_ptr p, long r, int m, mpz_t *tab)
               mpz_mul (S[k], S[k], Q[k-1]);
               mpz_mul (S[k], S[k], ptoj[l]);
               mpz_mul (S[k-1], S[k-1], Q[k]);
-              mpz_mul_2exp (S[k-1], S[k-1], r << l);
-              mpz_add (S[k-1], S[k-1], S[k]);
+              mpfr_atan_add_2exp (S[k-1], &eS[k-1],
+                                  S[k-1], eS[k-1] + eQ[k] + (r << l),
+                                  S[k], eS[k] + eQ[k-1], prect);
               mpz_mul (Q[k-1], Q[k-1], Q[k]);
+              eQ[k-1] += eQ[k];
+              mpfr_atan_trunc (Q[k-1], &eQ[k-1], prect);
               log2_nb_terms[k-1] = l + 1;
               /* now S[k-1]/Q[k-1] corresponds to 2^(l+1) terms */
               MPFR_MPZ_SIZEINBASE2(mult, ptoj[l+1]);
@@ -136,15 +197,19 @@ mpfr_atan_aux (mpfr_ptr y, mpz_ptr p, long r, int m, mpz_t *tab)
           mpz_mul_2exp (S[k], Q[k+1], r);
           mpz_sub_ui (S[k], S[k], 1 + 2 * i);
           mpz_mul_ui (Q[k], Q[k + 1], 1 + 2 * i);
+          eS[k] = eQ[k] = 0;
           log2_nb_terms[k] = 1; /* S[k]/Q[k] corresponds to 2 terms */
           for (j = (i + 2) >> 1, l = 1; (j & 1) == 0; l++, j >>= 1, k --)
             {
               MPFR_ASSERTD (k > 0);
               mpz_mul (S[k], S[k], Q[k-1]);
               mpz_mul (S[k-1], S[k-1], Q[k]);
-              mpz_mul_2exp (S[k-1], S[k-1], r << l);
-              mpz_add (S[k-1], S[k-1], S[k]);
+              mpfr_atan_add_2exp (S[k-1], &eS[k-1],
+                                  S[k-1], eS[k-1] + eQ[k] + (r << l),
+                                  S[k], eS[k] + eQ[k-1], prect);
               mpz_mul (Q[k-1], Q[k-1], Q[k]);
+              eQ[k-1] += eQ[k];
+              mpfr_atan_trunc (Q[k-1], &eQ[k-1], prect);
               log2_nb_terms[k-1] = l + 1;
             }
         }
@@ -162,9 +227,12 @@ mpfr_atan_aux (mpfr_ptr y, mpz_ptr p, long r, int m, mpz_t *tab)
         mpz_mul (S[k], S[k], ptoj[j]);
       mpz_mul (S[k-1], S[k-1], Q[k]);
       l += 1 << log2_nb_terms[k];
-      mpz_mul_2exp (S[k-1], S[k-1], r * l);
-      mpz_add (S[k-1], S[k-1], S[k]);
+      mpfr_atan_add_2exp (S[k-1], &eS[k-1],
+                          S[k-1], eS[k-1] + eQ[k] + r * l,
+                          S[k], eS[k] + eQ[k-1], prect);
       mpz_mul (Q[k-1], Q[k-1], Q[k]);
+      eQ[k-1] += eQ[k];
+      mpfr_atan_trunc (Q[k-1], &eQ[k-1], prect);
     }
 
   MPFR_MPZ_SIZEINBASE2 (diff, S[0]);
@@ -186,90 +254,30 @@ mpfr_atan_aux (mpfr_ptr y, mpz_ptr p, long r, int m, mpz_t *tab)
   mpz_tdiv_q (S[0], S[0], Q[0]);
   mpfr_set_z (y, S[0], MPFR_RNDD);
   /* TODO: Check/prove that the following expression doesn't overflow. */
-  expo = MPFR_GET_EXP (y) + expo - r * (i - 1);
+  expo = MPFR_GET_EXP (y) + expo + eS[0] - eQ[0] - r * (i - 1);
   MPFR_SET_EXP (y, expo);
 }
 
-int
-mpfr_atan (mpfr_ptr atan, mpfr_srcptr x, mpfr_rnd_t rnd_mode)
+/* Put in atan an approximation of sign*atan(xp), where xp > 0, xp <> 1,
+   and comparaison is the sign of xp-1, using argument reduction and the
+   binary splitting algorithm of mpfr_atan_aux. Return the ternary value.
+   This is the general algorithm, used for large precision.
+   The exponent range must be extended by the caller. */
+static int
+mpfr_atan_bsplit (mpfr_ptr atan, mpfr_srcptr xp, int comparaison,
+                  mpfr_sign_t sign, mpfr_rnd_t rnd_mode)
 {
-  mpfr_t xp, arctgt, sk, tmp, tmp2;
+  mpfr_t arctgt, sk, tmp, tmp2;
   mpz_t  ukz;
   mpz_t tabz[3*(MPFR_PREC_BITS+1)];
   mpfr_exp_t exptol;
   mpfr_prec_t prec, realprec, est_lost, lost;
   unsigned long twopoweri, log2p, red;
-  int comparaison, inexact;
+  int inexact;
   int i, n0, oldn0;
   MPFR_GROUP_DECL (group);
-  MPFR_SAVE_EXPO_DECL (expo);
   MPFR_ZIV_DECL (loop);
 
-  MPFR_LOG_FUNC
-    (("x[%Pu]=%.*Rg rnd=%d", mpfr_get_prec (x), mpfr_log_prec, x, rnd_mode),
-     ("atan[%Pu]=%.*Rg inexact=%d",
-      mpfr_get_prec (atan), mpfr_log_prec, atan, inexact));
-
-  /* Singular cases */
-  if (MPFR_UNLIKELY (MPFR_IS_SINGULAR (x)))
-    {
-      if (MPFR_IS_NAN (x))
-        {
-          MPFR_SET_NAN (atan);
-          MPFR_RET_NAN;
-        }
-      else if (MPFR_IS_INF (x))
-        {
-          MPFR_SAVE_EXPO_MARK (expo);
-          if (MPFR_IS_POS (x))  /* arctan(+inf) = Pi/2 */
-            inexact = mpfr_const_pi (atan, rnd_mode);
-          else /* arctan(-inf) = -Pi/2 */
-            {
-              inexact = -mpfr_const_pi (atan,
-                                        MPFR_INVERT_RND (rnd_mode));
-              MPFR_CHANGE_SIGN (atan);
-            }
-          mpfr_div_2ui (atan, atan, 1, rnd_mode);  /* exact (no exceptions) */
-          MPFR_SAVE_EXPO_FREE (expo);
-          return mpfr_check_range (atan, inexact, rnd_mode);
-        }
-      else /* x is necessarily 0 */
-        {
-          MPFR_ASSERTD (MPFR_IS_ZERO (x));
-          MPFR_SET_ZERO (atan);
-          MPFR_SET_SAME_SIGN (atan, x);
-          MPFR_RET (0);
-        }
-    }
-
-  /* atan(x) = x - x^3/3 + x^5/5...
-     so the error is < 2^(3*EXP(x)-1)
-     so `EXP(x)-(3*EXP(x)-1)` = -2*EXP(x)+1 */
-  MPFR_FAST_COMPUTE_IF_SMALL_INPUT (atan, x, -2 * MPFR_GET_EXP (x), 1, 0,
-                                    rnd_mode, {});
-
-  /* Set x_p=|x| */
-  MPFR_TMP_INIT_ABS (xp, x);
-
-  MPFR_SAVE_EXPO_MARK (expo);
-
-  /* Other simple case arctan(-+1)=-+pi/4 */
-  comparaison = mpfr_cmp_ui (xp, 1);
-  if (MPFR_UNLIKELY (comparaison == 0))
-    {
-      int neg = MPFR_IS_NEG (x);
-      inexact = mpfr_const_pi (atan, MPFR_IS_POS (x) ? rnd_mode
-                               : MPFR_INVERT_RND (rnd_mode));
-      if (neg)
-        {
-          inexact = -inexact;
-          MPFR_CHANGE_SIGN (atan);
-        }
-      mpfr_div_2ui (atan, atan, 2, rnd_mode);  /* exact (no exceptions) */
-      MPFR_SAVE_EXPO_FREE (expo);
-      return mpfr_check_range (atan, inexact, rnd_mode);
-    }
-
   realprec = MPFR_PREC (atan) + MPFR_INT_CEIL_LOG2 (MPFR_PREC (atan)) + 4;
   prec = realprec + GMP_NUMB_BITS;
 
@@ -424,12 +432,299 @@ mpfr_atan (mpfr_ptr atan, mpfr_srcptr x, mpfr_rnd_t rnd_mode)
     }
   MPFR_ZIV_FREE (loop);
 
-  inexact = mpfr_set4 (atan, arctgt, rnd_mode, MPFR_SIGN (x));
+  inexact = mpfr_set4 (atan, arctgt, rnd_mode, sign);
 
   for (i = 0 ; i < oldn0 ; i++)
     mpz_clear (tabz[i]);
   mpz_clear (ukz);
   MPFR_GROUP_CLEAR (group);
+  return inexact;
+}
+
+/* Tables for the small and medium precision engine (mpfr_atan_table):
+   atan_table[l][i] is an approximation of atan(i/2^(K*(l+1))) for
+   1 <= i < 2^K, where K = MPFR_ATAN_TABLE_BITS, rounded to nearest to
+   at least the precision requested by the last caller. An entry with a
+   zero precision is not initialized. The tables are computed lazily and
+   kept until mpfr_free_cache; since mpfr_atan2, mpfr_asin and mpfr_acos
+   all call mpfr_atan internally, they share them. */
+#define MPFR_ATAN_TABLE_BITS 6
+#define MPFR_ATAN_TABLE_LEVELS 2
+
+static MPFR_THREAD_ATTR __mpfr_struct
+atan_table[MPFR_ATAN_TABLE_LEVELS][1 << MPFR_ATAN_TABLE_BITS];
+
+/* Return atan_table[l][i], with a precision of at least prec. */
+static mpfr_srcptr
+mpfr_atan_table_get (int l, unsigned long i, mpfr_prec_t prec)
+{
+  mpfr_ptr t = &atan_table[l][i];
+
+  MPFR_ASSERTD (i > 0 && i < (1UL << MPFR_ATAN_TABLE_BITS));
+  if (MPFR_UNLIKELY (MPFR_PREC (t) < prec))
+    {
+      mpfr_t c;
+
+      /* As for the constant caches, increase the precision by at least
+         10% to avoid recomputing the entry on small precision increases. */
+      if (MPFR_PREC (t) == 0)
+        mpfr_init2 (t, prec);
+      else
+        mpfr_set_prec (t, MAX (prec, MPFR_PREC (t) + MPFR_PREC (t) / 10));
+      mpfr_init2 (c, MPFR_ATAN_TABLE_BITS);
+      mpfr_set_ui_2exp (c, i, - MPFR_ATAN_TABLE_BITS * (l + 1), MPFR_RNDN);
+      /* 0 < c < 1, and c is exact */
+      mpfr_atan_bsplit (t, c, -1, MPFR_SIGN_POS, MPFR_RNDN);
+      mpfr_clear (c);
+    }
+  return t;
+}
+
+void
+mpfr_atan_freecache (void)
+{
+  int l, i;
+
+  for (l = 0; l < MPFR_ATAN_TABLE_LEVELS; l++)
+    for (i = 1; i < (1 << MPFR_ATAN_TABLE_BITS); i++)
+      if (MPFR_PREC (&atan_table[l][i]) != 0)
+        {
+          mpfr_clear (&atan_table[l][i]);
+          MPFR_PREC (&atan_table[l][i]) = 0;
+        }
+}
+
+/* Put in atan an approximation of sign*atan(xp), where xp > 0, xp <> 1,
+   and comparaison is the sign of xp-1. Return the ternary value.
+   This engine is used for precisions up to MPFR_ATAN_TABLE_THRESHOLD.
+   The exponent range must be extended by the caller.
+
+   Let s = min(xp, 1/xp) <= 1. We apply for each table level l = 0, 1
+   the reduction
+     atan(t) = atan(c) + atan((t-c)/(1+t*c)),  c = i/2^(K*(l+1)),
+   with i = min(floor(t*2^(K*(l+1))), 2^K-1), where K = MPFR_ATAN_TABLE_BITS,
+   taking atan(c) from the tables, so that the final t satisfies
+   0 <= t < 2^(-2K). Then atan(t) is evaluated by its Taylor series
+   t - t^3/3 + t^5/5 - ..., which needs about w/(4K) terms at working
+   precision w.
+
+   Error analysis (all roundings are to nearest):
+   (a) s = o(1/xp) has an absolute error at most 2^(-w)*s, thus so has
+       atan(s), since atan is 1-Lipschitz. If xp < 1, s = xp is exact.
+   (b) t*2^(K*(l+1)) - i is exact, and o(o(t*i) + 2^(K*(l+1))) has a
+       relative error at most 2*2^(-w), thus the new t has a relative
+       error at most 3.1*2^(-w), i.e., an absolute error at most
+       3.1*2^(-w-K*(l+1)). Since the new t is the exact reduction of a
+       value within that bound from the old t, the total contribution of
+       (b) is less than 2^(-w-3).
+   (c) each table entry has an absolute error at most 2^(-w-1).
+   (d) in the series, with n terms added after t, u = o(t^2), and the k-th
+       term o(o(t^(2k-1)*u)/(2k+1)) has an absolute error at most
+       1.01*2^(-w)*t*u^k; the truncation error is at most t*2^(-w) since
+       we stop at a term less than 2^(EXP(t)-w) and the series alternates;
+       each addition yields an error at most 2*t*2^(-w). Since
+       atan(t) >= 3t/4, the relative error on the series is at most
+       (4n+4)*2^(-w).
+   (e) the final additions with the table entries yield an error at most
+       2^(-w-6) + 2^(-w-1).
+   If no table entry is used, i.e., s < 2^(-2K), only (a) and (d) apply
+   and the relative error is at most (4n+6)*2^(-w). Otherwise the result
+   is larger than 2^(-2K-1), and since t < 2^(-2K) in (d), the absolute
+   error is at most 2^(-w) * (3.2 + (n+1)/2^(4K-2)). */
+static int
+mpfr_atan_table (mpfr_ptr atan, mpfr_srcptr xp, int comparaison,
+                 mpfr_sign_t sign, mpfr_rnd_t rnd_mode)
+{
+  mpfr_t sk, u, tk, q, arctgt;
+  mpfr_prec_t prec, w;
+  mpfr_exp_t err, e;
+  unsigned long idx[MPFR_ATAN_TABLE_LEVELS], n;
+  int l, inexact;
+  MPFR_GROUP_DECL (group);
+  MPFR_ZIV_DECL (loop);
+
+  prec = MPFR_PREC (atan);
+  w = prec + MPFR_INT_CEIL_LOG2 (prec) + 2 * MPFR_ATAN_TABLE_BITS + 4;
+
+  MPFR_GROUP_INIT_5 (group, w, sk, u, tk, q, arctgt);
+  MPFR_ZIV_INIT (loop, w);
+  for (;;)
+    {
+      /* The mpfr_ui_div below mustn't underflow, as in mpfr_atan_bsplit. */
+      if (comparaison > 0)
+        mpfr_ui_div (sk, 1, xp, MPFR_RNDN);
+      else
+        mpfr_set (sk, xp, MPFR_RNDN);
+      /* now 0 < sk <= 1 */
+
+      /* Argument reduction with the tables */
+      for (l = 0; l < MPFR_ATAN_TABLE_LEVELS; l++)
+        {
+          unsigned long i = 0;
+          int shift = MPFR_ATAN_TABLE_BITS * (l + 1);
+
+          if (MPFR_NOTZERO (sk) && MPFR_GET_EXP (sk) > - shift)
+            {
+              mpfr_mul_2ui (tk, sk, shift, MPFR_RNDN);  /* exact */
+              i = mpfr_get_ui (tk, MPFR_RNDZ);
+              /* sk = 1 may happen at the first level and sk = 2^(-K) at
+                 the second one, due to the roundings */
+              if (i >= 1UL << MPFR_ATAN_TABLE_BITS)
+                i = (1UL << MPFR_ATAN_TABLE_BITS) - 1;
+              mpfr_sub_ui (tk, tk, i, MPFR_RNDN);  /* exact */
+              mpfr_mul_ui (u, sk, i, MPFR_RNDN);
+              mpfr_add_ui (u, u, 1UL << shift, MPFR_RNDN);
+              mpfr_div (sk, tk, u, MPFR_RNDN);
+            }
+          idx[l] = i;
+        }
+
+      /* Taylor series: now 0 <= sk < 2^(-2K) if a table entry is used */
+      n = 0;
+      if (MPFR_IS_ZERO (sk))
+        {
+          MPFR_SET_ZERO (arctgt);
+          MPFR_SET_POS (arctgt);
+        }
+      else
+        {
+          mpfr_sqr (u, sk, MPFR_RNDN);
+          mpfr_set (tk, sk, MPFR_RNDN);
+          mpfr_set (arctgt, sk, MPFR_RNDN);
+          for (;;)
+            {
+              mpfr_mul (tk, tk, u, MPFR_RNDN);
+              if (MPFR_IS_ZERO (tk)
+                  || MPFR_GET_EXP (tk) <= MPFR_GET_EXP (sk) - w)
+                break;
+              n ++;
+              mpfr_div_ui (q, tk, 2 * n + 1, MPFR_RNDN);
+              if (n & 1)
+                mpfr_sub (arctgt, arctgt, q, MPFR_RNDN);
+              else
+                mpfr_add (arctgt, arctgt, q, MPFR_RNDN);
+            }
+        }
+
+      if (idx[0] == 0 && idx[1] == 0)
+        {
+          MPFR_ASSERTD (MPFR_NOTZERO (arctgt));
+          err = w - MPFR_INT_CEIL_LOG2 (4 * n + 8);
+        }
+      else
+        {
+          for (l = MPFR_ATAN_TABLE_LEVELS - 1; l >= 0; l--)
+            if (idx[l] != 0)
+              mpfr_add (arctgt, arctgt,
+                        mpfr_atan_table_get (l, idx[l], w), MPFR_RNDN);
+          /* 3.2 + (n+1)/2^(4K-2) <= 4 for n < 800 */
+          err = w - (n < 800 ? 2 : MPFR_INT_CEIL_LOG2 (n))
+            + MPFR_GET_EXP (arctgt);
+        }
+
+      if (comparaison > 0)
+        { /* atan(x) = Pi/2-atan(1/x) for x > 0 */
+          e = MPFR_GET_EXP (arctgt) - err;
+          mpfr_const_pi (u, MPFR_RNDN);
+          mpfr_div_2ui (u, u, 1, MPFR_RNDN);
+          mpfr_sub (arctgt, u, arctgt, MPFR_RNDN);
+          /* the error on Pi/2 and on the subtraction is at most 2^(1-w) */
+          e = MAX (e, 1 - w) + 1;
+          err = MPFR_GET_EXP (arctgt) - e;
+        }
+
+      if (MPFR_LIKELY (MPFR_CAN_ROUND (arctgt, err, prec, rnd_mode)))
+        break;
+      MPFR_ZIV_NEXT (loop, w);
+      MPFR_GROUP_REPREC_5 (group, w, sk, u, tk, q, arctgt);
+    }
+  MPFR_ZIV_FREE (loop);
+
+  inexact = mpfr_set4 (atan, arctgt, rnd_mode, sign);
+
+  MPFR_GROUP_CLEAR (group);
+  return inexact;
+}
+
+int
+mpfr_atan (mpfr_ptr atan, mpfr_srcptr x, mpfr_rnd_t rnd_mode)
+{
+  mpfr_t xp;
+  int comparaison, inexact;
+  MPFR_SAVE_EXPO_DECL (expo);
+
+  MPFR_LOG_FUNC
+    (("x[%Pu]=%.*Rg rnd=%d", mpfr_get_prec (x), mpfr_log_prec, x, rnd_mode),
+     ("atan[%Pu]=%.*Rg inexact=%d",
+      mpfr_get_prec (atan), mpfr_log_prec, atan, inexact));
+
+  /* Singular cases */
+  if (MPFR_UNLIKELY (MPFR_IS_SINGULAR (x)))
+    {
+      if (MPFR_IS_NAN (x))
+        {
+          MPFR_SET_NAN (atan);
+          MPFR_RET_NAN;
+        }
+      else if (MPFR_IS_INF (x))
+        {
+          MPFR_SAVE_EXPO_MARK (expo);
+          if (MPFR_IS_POS (x))  /* arctan(+inf) = Pi/2 */
+            inexact = mpfr_const_pi (atan, rnd_mode);
+          else /* arctan(-inf) = -Pi/2 */
+            {
+              inexact = -mpfr_const_pi (atan,
+                                        MPFR_INVERT_RND (rnd_mode));
+              MPFR_CHANGE_SIGN (atan);
+            }
+          mpfr_div_2ui (atan, atan, 1, rnd_mode);  /* exact (no exceptions) */
+          MPFR_SAVE_EXPO_FREE (expo);
+          return mpfr_check_range (atan, inexact, rnd_mode);
+        }
+      else /* x is necessarily 0 */
+        {
+          MPFR_ASSERTD (MPFR_IS_ZERO (x));
+          MPFR_SET_ZERO (atan);
+          MPFR_SET_SAME_SIGN (atan, x);
+          MPFR_RET (0);
+        }
+    }
+
+  /* atan(x) = x - x^3/3 + x^5/5...
+     so the error is < 2^(3*EXP(x)-1)
+     so `EXP(x)-(3*EXP(x)-1)` = -2*EXP(x)+1 */
+  MPFR_FAST_COMPUTE_IF_SMALL_INPUT (atan, x, -2 * MPFR_GET_EXP (x), 1, 0,
+                                    rnd_mode, {});
+
+  /* Set x_p=|x| */
+  MPFR_TMP_INIT_ABS (xp, x);
+
+  MPFR_SAVE_EXPO_MARK (expo);
+
+  /* Other simple case arctan(-+1)=-+pi/4 */
+  comparaison = mpfr_cmp_ui (xp, 1);
+  if (MPFR_UNLIKELY (comparaison == 0))
+    {
+      int neg = MPFR_IS_NEG (x);
+      inexact = mpfr_const_pi (atan, MPFR_IS_POS (x) ? rnd_mode
+                               : MPFR_INVERT_RND (rnd_mode));
+      if (neg)
+        {
+          inexact = -inexact;
+          MPFR_CHANGE_SIGN (atan);
+        }
+      mpfr_div_2ui (atan, atan, 2, rnd_mode);  /* exact (no exceptions) */
+      MPFR_SAVE_EXPO_FREE (expo);
+      return mpfr_check_range (atan, inexact, rnd_mode);
+    }
+
+
+  if (MPFR_PREC (atan) <= MPFR_ATAN_TABLE_THRESHOLD)
+    inexact = mpfr_atan_table (atan, xp, comparaison, MPFR_SIGN (x),
+                               rnd_mode);
+  else
+    inexact = mpfr_atan_bsplit (atan, xp, comparaison, MPFR_SIGN (x),
+                                rnd_mode);
 
   MPFR_SAVE_EXPO_FREE (expo);
   return mpfr_check_range (atan, inexact, rnd_mode);
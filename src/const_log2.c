@@ -161,9 +161,13 @@ mpfr_const_log2_internal (mpfr_ptr x, mpfr_rnd_t rnd_mode)
       Q  = T + 2*lgN;
       for (i = 0; i < lgN; i++)
         {
-          mpz_init (T[i]);
-          mpz_init (P[i]);
-          mpz_init (Q[i]);
+          /* T[i], P[i] and Q[i] get the values of N/2^i terms, each one
+             taking at most lgN + 2 bits */
+          mp_bitcnt_t size = (mp_bitcnt_t) (N >> i) * (lgN + 2);
+
+          mpz_init2 (T[i], size);
+          mpz_init2 (P[i], size);
+          mpz_init2 (Q[i], size);
         }
 
       S (T, P, Q, 0, N, 0);
@@ -43,39 +43,15 @@ http://www.gnu.org/licenses/ or write to the Free Software Foundation, Inc.,
     }                                           \
   while ((storage) != 0)
 
-#define ALLOC_RESULT(buffer, buffer_size, wanted_size)                  \
-  do                                                                    \
-    {                                                                   \
-      if ((buffer) == NULL || *(buffer_size) < (wanted_size))           \
-        {                                                               \
-          (buffer) = (unsigned char *) (*__gmp_reallocate_func)         \
-            ((buffer), *(buffer_size), (wanted_size));                  \
-          if ((buffer) == NULL)                                         \
-            {                                                           \
-              *(buffer_size) = 0;                                       \
-              return NULL;                                              \
-            }                                                           \
-        }                                                               \
-      *(buffer_size) = (wanted_size);                                   \
-    }                                                                   \
-  while (0)
-
-/*
- * size in byte of a MPFR number in a binary object of a variable size
- */
-#define MAX_VARIABLE_STORAGE(exponent_size, precision) \
-  ((size_t)(((precision) >> 3) + (exponent_size) +     \
-            ((precision) > 248 ? sizeof(mpfr_prec_t) : 0) + 3))
-
 /* copy in result[] the values in data[] with a different endianness,
    where data_size might be smaller than data_max_size, so that we only
    copy data_size bytes from the end of data[]. */
 static void
 #if defined (HAVE_BIG_ENDIAN)
-putLittleEndianData (unsigned char *result, unsigned char *data,
+putLittleEndianData (unsigned char *result, const unsigned char *data,
                      size_t data_max_size, size_t data_size)
 #elif defined (HAVE_LITTLE_ENDIAN)
-putBigEndianData (unsigned char *result, unsigned char *data,
+putBigEndianData (unsigned char *result, const unsigned char *data,
                   size_t data_max_size, size_t data_size)
 #endif
 {
@@ -89,10 +65,10 @@ putBigEndianData (unsigned char *result, unsigned char *data,
 /* copy in result[] the values in data[] with the same endianness */
 static void
 #if defined (HAVE_BIG_ENDIAN)
-putBigEndianData (unsigned char *result, unsigned char *data,
+putBigEndianData (unsigned char *result, const unsigned char *data,
                   size_t data_max_size, size_t data_size)
 #elif defined (HAVE_LITTLE_ENDIAN)
-putLittleEndianData (unsigned char *result, unsigned char *data,
+putLittleEndianData (unsigned char *result, const unsigned char *data,
                      size_t data_max_size, size_t data_size)
 #endif
 {
@@ -106,10 +82,10 @@ putLittleEndianData (unsigned char *result, unsigned char *data,
    left untouched). */
 static void
 #if defined (HAVE_BIG_ENDIAN)
-getLittleEndianData (unsigned char *result, unsigned char *data,
+getLittleEndianData (unsigned char *result, const unsigned char *data,
                      size_t data_max_size, size_t data_size)
 #elif defined (HAVE_LITTLE_ENDIAN)
-getBigEndianData (unsigned char *result, unsigned char *data,
+getBigEndianData (unsigned char *result, const unsigned char *data,
                   size_t data_max_size, size_t data_size)
 #endif
 {
@@ -123,10 +99,10 @@ getBigEndianData (unsigned char *result, unsigned char *data,
 /* copy in result[] the values in data[] with the same endianness */
 static void
 #if defined (HAVE_BIG_ENDIAN)
-getBigEndianData (unsigned char *result, unsigned char *data,
+getBigEndianData (unsigned char *result, const unsigned char *data,
                   size_t data_max_size, size_t data_size)
 #elif defined (HAVE_LITTLE_ENDIAN)
-getLittleEndianData (unsigned char *result, unsigned char *data,
+getLittleEndianData (unsigned char *result, const unsigned char *data,
                      size_t data_max_size, size_t data_size)
 #endif
 {
@@ -138,75 +114,100 @@ getLittleEndianData (unsigned char *result, unsigned char *data,
 
 /* Internal Function */
 /*
- * buffer : OUT : store the precision in binary format, can be null
- *               (may be reallocated if too small)
- * buffer_size : IN/OUT : size of the buffer => size used in the buffer
- * precision : IN : precision to store
- * return pointer to a buffer storing the precision in binary format
+ * x : IN : MPFR number
+ * return the number of bytes used by x in the binary format
  */
-static unsigned char *
-mpfr_fpif_store_precision (unsigned char *buffer, size_t *buffer_size,
-                           mpfr_prec_t precision)
+static size_t
+mpfr_fpif_size (mpfr_srcptr x)
 {
-  unsigned char *result;
-  size_t size_precision;
+  mpfr_prec_t precision;
+  size_t size;
 
-  size_precision = 0;
+  precision = MPFR_PREC (x);
+  size = 2; /* first bytes of the precision and of the exponent */
 
   if (precision > MPFR_MAX_EMBEDDED_PRECISION)
     {
       mpfr_prec_t copy_precision;
 
       copy_precision = precision - (MPFR_MAX_EMBEDDED_PRECISION + 1);
-      COUNT_NB_BYTE(copy_precision, size_precision);
+      COUNT_NB_BYTE(copy_precision, size);
     }
 
-  result = buffer;
-  ALLOC_RESULT(result, buffer_size, size_precision + 1);
+  if (MPFR_IS_SINGULAR (x))
+    return size;
+
+  if (MPFR_GET_EXP (x) > MPFR_MAX_EMBEDDED_EXPONENT ||
+      MPFR_GET_EXP (x) < -MPFR_MAX_EMBEDDED_EXPONENT)
+    {
+      mpfr_uexp_t copy_exponent;
+
+      copy_exponent = (SAFE_ABS (mpfr_uexp_t, MPFR_GET_EXP (x))
+                       - MPFR_MAX_EMBEDDED_EXPONENT) << 1;
+      COUNT_NB_BYTE(copy_exponent, size);
+    }
+
+  return size + ((precision + 7) >> 3);
+}
 
+/*
+ * buffer : OUT : store the precision in binary format
+ * precision : IN : precision to store
+ * return the number of bytes written in the buffer
+ */
+static size_t
+mpfr_fpif_store_precision (unsigned char *buffer, mpfr_prec_t precision)
+{
   if (precision > MPFR_MAX_EMBEDDED_PRECISION)
     {
-      result[0] = size_precision - 1;
-      precision -= (MPFR_MAX_EMBEDDED_PRECISION + 1);
-      putLittleEndianData (result + 1, (unsigned char *) &precision,
+      mpfr_prec_t copy_precision;
+      size_t size_precision;
+
+      precision -= MPFR_MAX_EMBEDDED_PRECISION + 1;
+      copy_precision = precision;
+      size_precision = 0;
+      COUNT_NB_BYTE(copy_precision, size_precision);
+
+      buffer[0] = size_precision - 1;
+      putLittleEndianData (buffer + 1, (unsigned char *) &precision,
                            sizeof(mpfr_prec_t), size_precision);
+      return size_precision + 1;
     }
-  else
-    result[0] = precision + 7;
 
-  return result;
+  buffer[0] = precision + 7;
+  return 1;
 }
 
-#define BUFFER_SIZE 8
-
 /*
- * fh : IN : file handler
- * return the precision stored in the binary buffer, 0 in case of error
+ * precision : OUT : precision stored in the binary buffer
+ * buffer : IN : binary buffer
+ * size : IN : number of bytes available in the buffer
+ * return the number of bytes read from the buffer, 0 in case of error
  */
-static mpfr_prec_t
-mpfr_fpif_read_precision_from_file (FILE *fh)
+static size_t
+mpfr_fpif_read_precision (mpfr_prec_t *precision,
+                          const unsigned char *buffer, size_t size)
 {
-  mpfr_prec_t precision;
-  size_t precision_size;
-  unsigned char buffer[BUFFER_SIZE];
-
-  if (fh == NULL)
-    return 0;
+  mpfr_prec_t prec;
+  size_t precision_size, used_size;
 
-  if (fread (buffer, 1, 1, fh) != 1)
+  if (size < 1)
     return 0;
 
   precision_size = buffer[0];
   if (precision_size >= 8)
-    return precision_size - 7;
+    {
+      *precision = precision_size - 7;
+      return 1;
+    }
 
   precision_size++;
-  MPFR_ASSERTD (precision_size <= BUFFER_SIZE);
-
-  /* Read the precision in little-endian format. */
-  if (fread (buffer, precision_size, 1, fh) != 1)
+  used_size = precision_size + 1;
+  if (size < used_size)
     return 0;
 
+  /* The precision is stored in little-endian format. */
+  buffer++;
   while (precision_size > sizeof(mpfr_prec_t))
     {
       if (buffer[precision_size-1] != 0)
@@ -218,42 +219,55 @@ mpfr_fpif_read_precision_from_file (FILE *fh)
       buffer[precision_size-1] >= 0x80)
     return 0;  /* the read precision doesn't fit in a mpfr_prec_t */
 
-  precision = 0;  /* to pad with 0's if data_size < data_max_size */
+  prec = 0;  /* to pad with 0's if data_size < data_max_size */
 
   /* On big-endian machines, the data must be copied at the end of the
      precision object in the memory; thus data_max_size (3rd argument)
      must be sizeof(mpfr_prec_t). */
-  getLittleEndianData ((unsigned char *) &precision, buffer,
+  getLittleEndianData ((unsigned char *) &prec, buffer,
                        sizeof(mpfr_prec_t), precision_size);
 
-  return precision + (MPFR_MAX_EMBEDDED_PRECISION + 1);
+  if (prec > MPFR_PREC_MAX - (MPFR_MAX_EMBEDDED_PRECISION + 1))
+    return 0;  /* too large precision */
+
+  *precision = prec + (MPFR_MAX_EMBEDDED_PRECISION + 1);
+  return used_size;
 }
 
 /*
  * buffer : OUT : store the kind of the MPFR number x, its sign, the size of
- *                its exponent and its exponent value in a binary format,
- *                can be null (may be reallocated if too small)
- * buffer_size : IN/OUT : size of the buffer => size used in the buffer
+ *                its exponent and its exponent value in a binary format
  * x : IN : MPFR number
- * return pointer to a buffer storing the kind of the MPFR number x, its sign,
- *        the size of its exponent and its exponent value in a binary format,
+ * return the number of bytes written in the buffer
  */
 /* TODO
  *   exponents that use more than 16 bytes are not managed
 */
-static unsigned char*
-mpfr_fpif_store_exponent (unsigned char *buffer, size_t *buffer_size, mpfr_t x)
+static size_t
+mpfr_fpif_store_exponent (unsigned char *buffer, mpfr_srcptr x)
 {
-  unsigned char *result;
-  mpfr_exp_t exponent;
-  mpfr_uexp_t uexp;
   size_t exponent_size;
 
-  exponent = mpfr_get_exp (x);
   exponent_size = 0;
 
-  if (mpfr_regular_p (x))
+  if (MPFR_IS_SINGULAR (x))
     {
+      if (MPFR_IS_ZERO (x))
+        buffer[0] = MPFR_KIND_ZERO;
+      else if (MPFR_IS_INF (x))
+        buffer[0] = MPFR_KIND_INF;
+      else
+        {
+          MPFR_ASSERTD (MPFR_IS_NAN (x));
+          buffer[0] = MPFR_KIND_NAN;
+        }
+    }
+  else
+    {
+      mpfr_exp_t exponent;
+      mpfr_uexp_t uexp;
+
+      exponent = MPFR_GET_EXP (x);
       if (exponent > MPFR_MAX_EMBEDDED_EXPONENT ||
           exponent < -MPFR_MAX_EMBEDDED_EXPONENT)
         {
@@ -267,64 +281,43 @@ mpfr_fpif_store_exponent (unsigned char *buffer, size_t *buffer_size, mpfr_t x)
 
           if (exponent < 0)
             uexp |= (mpfr_uexp_t) 1 << (8 * exponent_size - 1);
-        }
-      else
-        uexp = exponent + MPFR_MAX_EMBEDDED_EXPONENT;
-    }
-
-  result = buffer;
-  ALLOC_RESULT(result, buffer_size, exponent_size + 1);
 
-  if (mpfr_regular_p (x))
-    {
-      if (exponent_size == 0)
-        result[0] = uexp;
-      else
-        {
-          result[0] = MPFR_EXTERNAL_EXPONENT + exponent_size;
-
-          putLittleEndianData (result + 1, (unsigned char *) &uexp,
+          buffer[0] = MPFR_EXTERNAL_EXPONENT + exponent_size;
+          putLittleEndianData (buffer + 1, (unsigned char *) &uexp,
                                sizeof(mpfr_exp_t), exponent_size);
         }
-    }
-  else if (mpfr_zero_p (x))
-    result[0] = MPFR_KIND_ZERO;
-  else if (mpfr_inf_p (x))
-    result[0] = MPFR_KIND_INF;
-  else
-    {
-      MPFR_ASSERTD (mpfr_nan_p (x));
-      result[0] = MPFR_KIND_NAN;
+      else
+        buffer[0] = exponent + MPFR_MAX_EMBEDDED_EXPONENT;
     }
 
   if (MPFR_IS_NEG (x))
-    result[0] |= 0x80;
+    buffer[0] |= 0x80;
 
-  return result;
+  return exponent_size + 1;
 }
 
 /*
- * x : OUT : MPFR number extracted from the binary buffer
- * fh : IN : file handler
- * return 0 if successful
+ * x : OUT : MPFR number whose kind, sign and exponent are extracted from
+ *           the binary buffer (for a regular number, the significand is
+ *           not set)
+ * buffer : IN : binary buffer
+ * size : IN : number of bytes available in the buffer
+ * return the number of bytes read from the buffer, 0 in case of error
  */
 /* TODO
  *   exponents that use more than 16 bytes are not managed
 */
-static int
-mpfr_fpif_read_exponent_from_file (mpfr_t x, FILE * fh)
+static size_t
+mpfr_fpif_read_exponent (mpfr_ptr x, const unsigned char *buffer,
+                         size_t size)
 {
   mpfr_exp_t exponent;
   mpfr_uexp_t uexp;
   size_t exponent_size;
   int sign;
-  unsigned char buffer[sizeof(mpfr_exp_t)];
 
-  if (fh == NULL)
-    return 1;
-
-  if (fread (buffer, 1, 1, fh) != 1)
-    return 1;
+  if (size < 1)
+    return 0;
 
   sign = (buffer[0] & 0x80) ? -1 : 1;
   exponent = buffer[0] & 0x7F;
@@ -336,14 +329,11 @@ mpfr_fpif_read_exponent_from_file (mpfr_t x, FILE * fh)
 
       exponent_size = exponent - MPFR_EXTERNAL_EXPONENT;
 
-      if (exponent_size > sizeof(mpfr_exp_t))
-        return 1;
-
-      if (fread (buffer, exponent_size, 1, fh) != 1)
-        return 1;
+      if (exponent_size > sizeof(mpfr_exp_t) || size < exponent_size + 1)
+        return 0;
 
       uexp = 0;
-      getLittleEndianData ((unsigned char *) &uexp, buffer,
+      getLittleEndianData ((unsigned char *) &uexp, buffer + 1,
                            sizeof(mpfr_exp_t), exponent_size);
 
       exponent_sign = uexp & ((mpfr_uexp_t) 1 << (8 * exponent_size - 1));
@@ -353,9 +343,8 @@ mpfr_fpif_read_exponent_from_file (mpfr_t x, FILE * fh)
 
       exponent = exponent_sign ? - (mpfr_exp_t) uexp : (mpfr_exp_t) uexp;
       if (! MPFR_EXP_IN_RANGE (exponent))
-        return 1;
+        return 0;
       MPFR_EXP (x) = exponent;
-
       MPFR_SET_SIGN (x, sign);
 
       exponent_size++;
@@ -366,97 +355,197 @@ mpfr_fpif_read_exponent_from_file (mpfr_t x, FILE * fh)
     mpfr_set_inf (x, sign);
   else if (exponent == MPFR_KIND_NAN)
     mpfr_set_nan (x);
-  else if (exponent < 95)
+  else if (exponent <= MPFR_EXTERNAL_EXPONENT)
     {
-      /* FIXME: no sign set. Is this normal? Check with a testcase. */
       exponent -= MPFR_MAX_EMBEDDED_EXPONENT;
       if (! MPFR_EXP_IN_RANGE (exponent))
-        return 1;
+        return 0;
       MPFR_EXP (x) = exponent;
+      MPFR_SET_SIGN (x, sign);
     }
   else
-    return 1;
+    return 0;
 
-  return 0;
+  return exponent_size;
 }
 
 /*
- * buffer : OUT : store the limb of the MPFR number x in a binary format,
- *                can be null (may be reallocated if too small)
- * buffer_size : IN/OUT : size of the buffer => size used in the buffer
+ * buffer : OUT : store the limb of the MPFR number x in a binary format
  * x : IN : MPFR number
- * return pointer to a buffer storing the limb of the MPFR number x in a binary
- *        format
+ * return the number of bytes written in the buffer
  */
-static unsigned char*
-mpfr_fpif_store_limbs (unsigned char *buffer, size_t *buffer_size, mpfr_t x)
+static size_t
+mpfr_fpif_store_limbs (unsigned char *buffer, mpfr_srcptr x)
 {
-  unsigned char *result;
   mpfr_prec_t precision;
   size_t nb_byte;
-  size_t nb_limb, mp_bytes_per_limb;
+  size_t mp_bytes_per_limb;
   size_t nb_partial_byte;
-  size_t i, j;
+  size_t j;
 
-  precision = mpfr_get_prec (x);
+  precision = MPFR_PREC (x);
   nb_byte = (precision + 7) >> 3;
   mp_bytes_per_limb = mp_bits_per_limb >> 3;
   nb_partial_byte = nb_byte % mp_bytes_per_limb;
-  nb_limb = (nb_byte + mp_bytes_per_limb - 1) / mp_bytes_per_limb;
-
-  result = buffer;
-  ALLOC_RESULT(result, buffer_size, nb_byte);
+  j = (nb_partial_byte == 0) ? 0 : 1;
 
-  putBigEndianData (result, (unsigned char*) MPFR_MANT(x),
+  putBigEndianData (buffer, (unsigned char*) MPFR_MANT(x),
                     sizeof(mp_limb_t), nb_partial_byte);
-  for (i = nb_partial_byte, j = (nb_partial_byte == 0) ? 0 : 1; j < nb_limb;
-       i += mp_bytes_per_limb, j++)
-    putLittleEndianData (result + i, (unsigned char*) (MPFR_MANT(x) + j),
-                         sizeof(mp_limb_t), sizeof(mp_limb_t));
+#if defined (HAVE_LITTLE_ENDIAN)
+  /* the full limbs have the same layout in memory and in the binary
+     format: copy them at once */
+  memcpy (buffer + nb_partial_byte, MPFR_MANT(x) + j,
+          nb_byte - nb_partial_byte);
+#else
+  {
+    size_t i, nb_limb;
+
+    nb_limb = (nb_byte + mp_bytes_per_limb - 1) / mp_bytes_per_limb;
+    for (i = nb_partial_byte; j < nb_limb; i += mp_bytes_per_limb, j++)
+      putLittleEndianData (buffer + i, (unsigned char*) (MPFR_MANT(x) + j),
+                           sizeof(mp_limb_t), sizeof(mp_limb_t));
+  }
+#endif
 
-  return result;
+  return nb_byte;
 }
 
 /*
- * x : OUT : MPFR number extracted from the binary buffer, should have the same
- *           precision than the number in the binary format
- * buffer : IN : limb of the MPFR number x in a binary format,
- * buffer_size : IN/OUT : size of the buffer => size used in the buffer
- * return 0 if successful
+ * x : IN/OUT : MPFR number whose significand is set from the limbs just
+ *              decoded in its top nb_limb limbs, the other limbs being zeroed
+ * precision : IN : precision of the number in the binary format, at most
+ *                  PREC(x)
+ * nb_limb : IN : number of limbs for precision
+ * return 0 if successful (the limbs form a normalized significand)
  */
 static int
-mpfr_fpif_read_limbs (mpfr_t x, unsigned char *buffer, size_t *buffer_size)
+mpfr_fpif_finish_limbs (mpfr_ptr x, mpfr_prec_t precision, size_t nb_limb)
 {
-  mpfr_prec_t precision;
+  mp_limb_t *mp;
+  size_t xn;
+
+  xn = MPFR_LIMB_SIZE (x);
+  mp = MPFR_MANT(x) + (xn - nb_limb);
+  /* ignore the bits after the precision */
+  mp[0] &= ~MPFR_LIMB_MASK (nb_limb * GMP_NUMB_BITS - precision);
+  if (xn > nb_limb)
+    MPN_ZERO (MPFR_MANT(x), xn - nb_limb);
+  return MPFR_LIMB_MSB (mp[nb_limb - 1]) == 0;
+}
+
+/*
+ * x : OUT : MPFR number extracted from the binary buffer, must have a
+ *           precision at least equal to the one of the number in the
+ *           binary format
+ * precision : IN : precision of the number in the binary format
+ * buffer : IN : limb of the MPFR number x in a binary format, of size
+ *               ceil(precision/8)
+ * return 0 if successful (the limbs form a normalized significand)
+ */
+static int
+mpfr_fpif_read_limbs (mpfr_ptr x, mpfr_prec_t precision,
+                      const unsigned char *buffer)
+{
+  mp_limb_t *mp;
   size_t nb_byte;
   size_t mp_bytes_per_limb;
   size_t nb_partial_byte;
-  size_t i, j;
+  size_t j, nb_limb;
 
-  precision = mpfr_get_prec (x);
+  MPFR_ASSERTD (precision <= MPFR_PREC (x));
   nb_byte = (precision + 7) >> 3;
   mp_bytes_per_limb = mp_bits_per_limb >> 3;
   nb_partial_byte = nb_byte % mp_bytes_per_limb;
+  nb_limb = (nb_byte + mp_bytes_per_limb - 1) / mp_bytes_per_limb;
+  j = (nb_partial_byte == 0) ? 0 : 1;
+  mp = MPFR_MANT(x) + (MPFR_LIMB_SIZE (x) - nb_limb);
 
-  if ((buffer == NULL) || (*buffer_size < nb_byte))
+  if (nb_partial_byte > 0)
     {
-      *buffer_size = 0;
-      return 1;
+      mp[0] = 0;
+      getBigEndianData ((unsigned char*) mp, buffer,
+                        sizeof(mp_limb_t), nb_partial_byte);
     }
-  *buffer_size = nb_byte;
+#if defined (HAVE_LITTLE_ENDIAN)
+  memcpy (mp + j, buffer + nb_partial_byte, nb_byte - nb_partial_byte);
+#else
+  {
+    size_t i;
+
+    for (i = nb_partial_byte; j < nb_limb; i += mp_bytes_per_limb, j++)
+      getLittleEndianData ((unsigned char*) (mp + j), buffer + i,
+                           sizeof(mp_limb_t), sizeof(mp_limb_t));
+  }
+#endif
+
+  return mpfr_fpif_finish_limbs (x, precision, nb_limb);
+}
+
+/*
+ * x : OUT : MPFR number extracted from the file, must have a precision at
+ *           least equal to the one of the number in the binary format
+ * precision : IN : precision of the number in the binary format
+ * fh : IN : file handler, positioned on the limbs of the number
+ * return 0 if successful
+ */
+static int
+mpfr_fpif_fread_limbs (mpfr_ptr x, mpfr_prec_t precision, FILE *fh)
+{
+  unsigned char partial[sizeof(mp_limb_t)];
+  mp_limb_t *mp;
+  size_t nb_byte;
+  size_t mp_bytes_per_limb;
+  size_t nb_partial_byte;
+  size_t j, nb_limb;
+
+  MPFR_ASSERTD (precision <= MPFR_PREC (x));
+  nb_byte = (precision + 7) >> 3;
+  mp_bytes_per_limb = mp_bits_per_limb >> 3;
+  nb_partial_byte = nb_byte % mp_bytes_per_limb;
+  nb_limb = (nb_byte + mp_bytes_per_limb - 1) / mp_bytes_per_limb;
+  j = (nb_partial_byte == 0) ? 0 : 1;
+  mp = MPFR_MANT(x) + (MPFR_LIMB_SIZE (x) - nb_limb);
 
   if (nb_partial_byte > 0)
     {
-      memset (MPFR_MANT(x), 0, sizeof(mp_limb_t));
-      getBigEndianData ((unsigned char*) MPFR_MANT(x), buffer,
+      if (fread (partial, nb_partial_byte, 1, fh) != 1)
+        return -1;
+      mp[0] = 0;
+      getBigEndianData ((unsigned char*) mp, partial,
                         sizeof(mp_limb_t), nb_partial_byte);
     }
-  for (i = nb_partial_byte, j = (nb_partial_byte == 0) ? 0 : 1; i < nb_byte;
-       i += mp_bytes_per_limb, j++)
-    getLittleEndianData ((unsigned char*) (MPFR_MANT(x) + j), buffer + i,
-                         sizeof(mp_limb_t), sizeof(mp_limb_t));
+  /* the full limbs are read directly in the significand */
+  if (j < nb_limb && fread (mp + j, sizeof(mp_limb_t), nb_limb - j, fh)
+      != nb_limb - j)
+    return -1;
+#if defined (HAVE_BIG_ENDIAN)
+  for (; j < nb_limb; j++)
+    {
+      memcpy (partial, mp + j, sizeof(mp_limb_t));
+      getLittleEndianData ((unsigned char*) (mp + j), partial,
+                           sizeof(mp_limb_t), sizeof(mp_limb_t));
+    }
+#endif
 
-  return 0;
+  return mpfr_fpif_finish_limbs (x, precision, nb_limb);
+}
+
+/*
+ * buffer : OUT : store the MPFR number x in the binary format, must have
+ *                at least mpfr_fpif_size(x) bytes
+ * x : IN : MPFR number
+ * return the number of bytes written in the buffer
+ */
+static size_t
+mpfr_fpif_write (unsigned char *buffer, mpfr_srcptr x)
+{
+  size_t used_size;
+
+  used_size = mpfr_fpif_store_precision (buffer, MPFR_PREC (x));
+  used_size += mpfr_fpif_store_exponent (buffer + used_size, x);
+  if (! MPFR_IS_SINGULAR (x))
+    used_size += mpfr_fpif_store_limbs (buffer + used_size, x);
+  return used_size;
 }
 
 /* External Function */
@@ -470,56 +559,80 @@ mpfr_fpif_export (FILE *fh, mpfr_t x)
 {
   int status;
   unsigned char *buf;
-  unsigned char *bufResult;
-  size_t used_size, buf_size;
+  size_t used_size;
+  MPFR_TMP_DECL (marker);
 
   if (fh == NULL)
     return -1;
 
-  buf_size = MAX_VARIABLE_STORAGE(sizeof(mpfr_exp_t), mpfr_get_prec (x));
-  buf = (unsigned char*) (*__gmp_allocate_func) (buf_size);
-  if (buf == NULL)
+  used_size = mpfr_fpif_size (x);
+  MPFR_TMP_MARK (marker);
+  buf = (unsigned char *) MPFR_TMP_ALLOC (used_size);
+  mpfr_fpif_write (buf, x);
+  status = fwrite (buf, used_size, 1, fh);
+  MPFR_TMP_FREE (marker);
+
+  return status == 1 ? 0 : -1;
+}
+
+/*
+ * x : IN/OUT : MPFR number extracted from the file
+ * fh : IN : file hander
+ * keep_prec : IN : if zero, the precision of x is reset to be able to hold
+ *                  the number; otherwise, it is kept and must be at least
+ *                  equal to the one of the number in the file, so that
+ *                  nothing is allocated
+ * Return 0 if the import was successful.
+ */
+static int
+mpfr_fpif_import_aux (mpfr_ptr x, FILE *fh, int keep_prec)
+{
+  mpfr_prec_t precision;
+  unsigned char buffer[9 + sizeof(mpfr_exp_t)];
+  size_t n;
+
+  if (fh == NULL)
     return -1;
 
-  used_size = buf_size;
-  buf = mpfr_fpif_store_precision (buf, &used_size, mpfr_get_prec (x));
-  used_size > buf_size ? buf_size = used_size : 0;
-  status = fwrite (buf, used_size, 1, fh);
-  if (status != 1)
-    {
-      (*__gmp_free_func) (buf, buf_size);
-      return -1;
-    }
-  used_size = buf_size;
-  bufResult = mpfr_fpif_store_exponent (buf, &used_size, x);
-  if (bufResult == NULL)
-    {
-      (*__gmp_free_func) (buf, buf_size);
-      return -1;
-    }
-  buf = bufResult;
-  used_size > buf_size ? buf_size = used_size : 0;
-  status = fwrite (buf, used_size, 1, fh);
-  if (status != 1)
+  /* Read the precision: a first byte, then its value if it is large. */
+  if (fread (buffer, 1, 1, fh) != 1)
+    return -1;
+  n = buffer[0] < 8 ? buffer[0] + 1 : 0;
+  if (n != 0 && fread (buffer + 1, n, 1, fh) != 1)
+    return -1;
+  if (mpfr_fpif_read_precision (&precision, buffer, n + 1) == 0)
+    return -1; /* error or precision > MPFR_PREC_MAX */
+  MPFR_STAT_STATIC_ASSERT (MPFR_PREC_MIN <= 8);
+  if (precision < MPFR_PREC_MIN)
+    precision = MPFR_PREC_MIN;
+  if (! keep_prec)
+    mpfr_set_prec (x, precision);
+  else if (precision > MPFR_PREC (x))
+    return -1;
+
+  /* Read the exponent: a first byte, then its value if it is large. */
+  if (fread (buffer, 1, 1, fh) != 1)
+    return -1;
+  n = buffer[0] & 0x7F;
+  n = (n > MPFR_EXTERNAL_EXPONENT && n < MPFR_KIND_ZERO) ?
+    n - MPFR_EXTERNAL_EXPONENT : 0;
+  if (n > sizeof(mpfr_exp_t) ||
+      (n != 0 && fread (buffer + 1, n, 1, fh) != 1) ||
+      mpfr_fpif_read_exponent (x, buffer, n + 1) == 0)
     {
-      (*__gmp_free_func) (buf, buf_size);
+      MPFR_SET_NAN (x);
       return -1;
     }
 
-  if (mpfr_regular_p (x))
+  if (MPFR_IS_SINGULAR (x))
+    return 0;
+
+  if (mpfr_fpif_fread_limbs (x, precision, fh) != 0)
     {
-      used_size = buf_size;
-      buf = mpfr_fpif_store_limbs (buf, &used_size, x);
-      used_size > buf_size ? buf_size = used_size : 0;
-      status = fwrite (buf, used_size, 1, fh);
-      if (status != 1)
-        {
-          (*__gmp_free_func) (buf, buf_size);
-          return -1;
-        }
+      MPFR_SET_NAN (x);
+      return -1;
     }
 
-  (*__gmp_free_func) (buf, buf_size);
   return 0;
 }
 
@@ -532,44 +645,165 @@ mpfr_fpif_export (FILE *fh, mpfr_t x)
 int
 mpfr_fpif_import (mpfr_t x, FILE *fh)
 {
-  int status;
-  mpfr_prec_t precision;
-  unsigned char *buffer;
+  return mpfr_fpif_import_aux (x, fh, 0);
+}
+
+/*
+ * x : IN/OUT : MPFR number extracted from the file, its precision is kept
+ *              (x may use a significand set up by mpfr_custom_init_set)
+ * fh : IN : file hander
+ * Return 0 if the import was successful.
+ */
+int
+mpfr_fpif_import_custom (mpfr_t x, FILE *fh)
+{
+  return mpfr_fpif_import_aux (x, fh, 1);
+}
+
+/*
+ * buf : OUT : buffer where x is stored in the binary format, if it has at
+ *             least size bytes (can be NULL if size is 0)
+ * size : IN : size of the buffer
+ * x : IN : MPFR number
+ * return the number of bytes needed to store x
+ */
+size_t
+mpfr_fpif_export_buffer (unsigned char *buf, size_t size, mpfr_srcptr x)
+{
   size_t used_size;
 
-  precision = mpfr_fpif_read_precision_from_file (fh);
-  if (precision == 0) /* precision = 0 means an error */
-    return -1;
-  if (precision > MPFR_PREC_MAX)
-    return -1;
+  used_size = mpfr_fpif_size (x);
+  if (used_size <= size)
+    mpfr_fpif_write (buf, x);
+  return used_size;
+}
+
+/*
+ * x : IN/OUT : MPFR number extracted from the buffer
+ * buf : IN : buffer
+ * size : IN : number of bytes available in the buffer
+ * keep_prec : IN : if zero, the precision of x is reset to be able to hold
+ *                  the number; otherwise, it is kept and must be at least
+ *                  equal to the one of the number in the buffer
+ * return the number of bytes read, 0 in case of error
+ */
+static size_t
+mpfr_fpif_import_buffer_aux (mpfr_ptr x, const unsigned char *buf,
+                             size_t size, int keep_prec)
+{
+  mpfr_prec_t precision;
+  size_t used_size, n;
+
+  used_size = mpfr_fpif_read_precision (&precision, buf, size);
+  if (used_size == 0)
+    return 0; /* error or precision > MPFR_PREC_MAX */
   MPFR_STAT_STATIC_ASSERT (MPFR_PREC_MIN <= 8);
   if (precision < MPFR_PREC_MIN)
     precision = MPFR_PREC_MIN;
-  mpfr_set_prec (x, precision);
+  if (! keep_prec)
+    /* does not reallocate if x has enough limbs */
+    mpfr_set_prec (x, precision);
+  else if (precision > MPFR_PREC (x))
+    return 0;
 
-  status = mpfr_fpif_read_exponent_from_file (x, fh);
-  if (status != 0)
-    return -1;
+  n = mpfr_fpif_read_exponent (x, buf + used_size, size - used_size);
+  if (n == 0)
+    {
+      MPFR_SET_NAN (x);
+      return 0;
+    }
+  used_size += n;
+
+  if (MPFR_IS_SINGULAR (x))
+    return used_size;
 
-  if (mpfr_regular_p (x))
+  n = (precision + 7) >> 3; /* ceil(precision/8) */
+  if (size - used_size < n ||
+      mpfr_fpif_read_limbs (x, precision, buf + used_size))
     {
-      used_size = (precision + 7) >> 3; /* ceil(precision/8) */
-      buffer = (unsigned char*) (*__gmp_allocate_func) (used_size);
-      if (buffer == NULL)
-        {
-          return -1;
-        }
-      status = fread (buffer, used_size, 1, fh);
-      if (status != 1)
-        {
-          (*__gmp_free_func) (buffer, used_size);
-          return -1;
-        }
-      status = mpfr_fpif_read_limbs (x, buffer, &used_size);
-      (*__gmp_free_func) (buffer, used_size);
-      if (status != 0)
-        return -1;
+      MPFR_SET_NAN (x);
+      return 0;
     }
 
-  return 0;
+  return used_size + n;
+}
+
+/*
+ * x : IN/OUT : MPFR number extracted from the buffer, its precision is reset
+ *              to be able to hold the number
+ * buf : IN : buffer
+ * size : IN : number of bytes available in the buffer
+ * return the number of bytes read, 0 in case of error
+ */
+size_t
+mpfr_fpif_import_buffer (mpfr_ptr x, const unsigned char *buf, size_t size)
+{
+  return mpfr_fpif_import_buffer_aux (x, buf, size, 0);
+}
+
+/*
+ * x : IN/OUT : MPFR number extracted from the buffer, its precision is kept
+ *              (x may use a significand set up by mpfr_custom_init_set)
+ * buf : IN : buffer
+ * size : IN : number of bytes available in the buffer
+ * return the number of bytes read, 0 in case of error
+ */
+size_t
+mpfr_fpif_import_custom_buffer (mpfr_ptr x, const unsigned char *buf,
+                                size_t size)
+{
+  return mpfr_fpif_import_buffer_aux (x, buf, size, 1);
+}
+
+/*
+ * buf : OUT : buffer where the n numbers of tab are stored one after the
+ *             other in the binary format, if it has at least size bytes
+ *             (can be NULL if size is 0)
+ * size : IN : size of the buffer
+ * tab : IN : array of n MPFR numbers
+ * return the number of bytes needed to store the n numbers
+ */
+size_t
+mpfr_fpif_export_array (unsigned char *buf, size_t size,
+                        mpfr_ptr *const tab, unsigned long n)
+{
+  size_t used_size;
+  unsigned long i;
+
+  used_size = 0;
+  for (i = 0; i < n; i++)
+    used_size += mpfr_fpif_size (tab[i]);
+
+  if (used_size <= size)
+    for (i = 0; i < n; i++)
+      buf += mpfr_fpif_write (buf, tab[i]);
+
+  return used_size;
+}
+
+/*
+ * tab : IN/OUT : array of n MPFR numbers extracted from the buffer, their
+ *                precisions are reset to be able to hold the numbers
+ * buf : IN : buffer
+ * size : IN : number of bytes available in the buffer
+ * return the number of bytes read, 0 in case of error
+ */
+size_t
+mpfr_fpif_import_array (mpfr_ptr *const tab, unsigned long n,
+                        const unsigned char *buf, size_t size)
+{
+  size_t used_size, k;
+  unsigned long i;
+
+  used_size = 0;
+  for (i = 0; i < n; i++)
+    {
+      k = mpfr_fpif_import_buffer (tab[i], buf + used_size,
+                                   size - used_size);
+      if (k == 0)
+        return 0;
+      used_size += k;
+    }
+
+  return used_size;
 }
@@ -20,47 +20,151 @@ along with the GNU MPFR Library; see the file COPYING.LESSER.  If not, see
 http://www.gnu.org/licenses/ or write to the Free Software Foundation, Inc.,
 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA. */
 
+#define MPFR_NEED_LONGLONG_H
 #include "mpfr-impl.h"
 
-/* Default value for the cache of mpz_t */
+/* Default value for the cache of mpz_t (the actual number of cached
+   mpz_t can be lowered at run time with mpfr_mpz_pool_set_depth) */
 #ifndef MPFR_MY_MPZ_INIT
 #  define MPFR_MY_MPZ_INIT 32
 #endif
 
+/* Number of size classes: the class c contains the mpz_t whose number of
+   allocated limbs is in [2^c, 2^(c+1)) (with 0 and 1 in class 0). Larger
+   mpz_t are not kept. */
+#ifndef MPFR_MY_MPZ_CLASSES
+#  define MPFR_MY_MPZ_CLASSES 16
+#endif
+
 /* If the number of value to cache is not zero */
 #if MPFR_MY_MPZ_INIT
 
-/* Index in the stack table of mpz_t and stack table of mpz_t */
+/* The cached mpz_t are stored in mpz_tab and linked into one stack per
+   size class (mpz_head) and a list of unused slots (mpz_free) through
+   mpz_next; the links are slot indices plus 1, 0 ending the lists. The
+   slots from n_slots on have never been used. */
+static MPFR_THREAD_ATTR int mpz_depth = MPFR_MY_MPZ_INIT;
 static MPFR_THREAD_ATTR int n_alloc = 0;
+static MPFR_THREAD_ATTR int n_slots = 0;
+static MPFR_THREAD_ATTR int mpz_free = 0;
+static MPFR_THREAD_ATTR int mpz_head[MPFR_MY_MPZ_CLASSES];
+static MPFR_THREAD_ATTR int mpz_next[MPFR_MY_MPZ_INIT];
 static MPFR_THREAD_ATTR __mpz_struct mpz_tab[MPFR_MY_MPZ_INIT];
+static MPFR_THREAD_ATTR mpfr_mpz_pool_stats_t mpz_stats;
+
+/* Return the size class of a mpz_t with n allocated limbs */
+static int
+mpz_class (mp_size_t n)
+{
+  int cnt;
+
+  if (n <= 1)
+    return 0;
+  count_leading_zeros (cnt, (mp_limb_t) n);
+  return GMP_NUMB_BITS - 1 - cnt;
+}
+
+/* Pop the top mpz_t of the class c into z */
+static void
+mpz_pop (mpz_ptr z, int c)
+{
+  int s = mpz_head[c] - 1;
+
+  MPFR_ASSERTD (s >= 0 && s < n_slots && n_alloc > 0);
+  mpz_head[c] = mpz_next[s];
+  memcpy (z, &mpz_tab[s], sizeof (mpz_t));
+  mpz_next[s] = mpz_free;
+  mpz_free = s + 1;
+  n_alloc--;
+}
 
 MPFR_HOT_FUNCTION_ATTR void
 mpfr_mpz_init (mpz_t z)
 {
+  int c;
+
+  /* Get a mpz_t from the MPFR stacks of previously used mpz_t.
+     It reduces memory pressure. Nothing is known about the use of z:
+     take one of the smallest class, so that the large ones are kept for
+     mpfr_mpz_init2, which needs them. */
   if (MPFR_LIKELY (n_alloc > 0))
+    for (c = 0; c < MPFR_MY_MPZ_CLASSES; c++)
+      if (mpz_head[c] != 0)
+        {
+          mpz_pop (z, c);
+          SIZ(z) = 0;
+          mpz_stats.hits++;
+          return;
+        }
+
+  /* Call real GMP function */
+  mpz_stats.misses++;
+  (__gmpz_init)(z);
+}
+
+MPFR_HOT_FUNCTION_ATTR void
+mpfr_mpz_init2 (mpz_t z, mp_bitcnt_t n)
+{
+  mp_size_t limbs;
+  int c, d;
+
+  limbs = n == 0 ? 1 : (n - 1) / GMP_NUMB_BITS + 1;
+  c = mpz_class (limbs);
+  if (MPFR_LIKELY (n_alloc > 0 && c < MPFR_MY_MPZ_CLASSES))
     {
-      /* Get a mpz_t from the MPFR stack of previously used mpz_t.
-         It reduces memory pressure, and it allows to reuse
-         a mpz_t which should be sufficiently big. */
-      MPFR_ASSERTD (n_alloc <= numberof (mpz_tab));
-      memcpy (z, &mpz_tab[--n_alloc], sizeof (mpz_t));
-      SIZ(z) = 0;
-    }
-  else
-    {
-      /* Call real GMP function */
-      (__gmpz_init)(z);
+      /* Take the smallest suitable mpz_t: the top of the class c if it
+         is large enough, otherwise one of a larger class, otherwise
+         the top of the class c after a reallocation. */
+      if (mpz_head[c] != 0 && ALLOC(&mpz_tab[mpz_head[c] - 1]) >= limbs)
+        d = c;
+      else
+        for (d = c + 1; d < MPFR_MY_MPZ_CLASSES && mpz_head[d] == 0; d++)
+          ;
+      if (d < MPFR_MY_MPZ_CLASSES)
+        {
+          mpz_pop (z, d);
+          SIZ(z) = 0;
+          mpz_stats.hits++;
+          return;
+        }
+      if (mpz_head[c] != 0)
+        {
+          mpz_pop (z, c);
+          SIZ(z) = 0;
+          mpz_realloc2 (z, n);
+          mpz_stats.hits++;
+          mpz_stats.reallocs++;
+          return;
+        }
     }
+
+  /* Call real GMP function */
+  mpz_stats.misses++;
+  (__gmpz_init2)(z, n);
 }
 
 MPFR_HOT_FUNCTION_ATTR void
 mpfr_mpz_clear (mpz_t z)
 {
-  if (MPFR_LIKELY (n_alloc < numberof (mpz_tab)))
+  int c = mpz_class (ALLOC(z));
+
+  if (MPFR_LIKELY (n_alloc < mpz_depth && c < MPFR_MY_MPZ_CLASSES))
     {
-      /* Push back the mpz_t inside the stack of the used mpz_t */
-      MPFR_ASSERTD (n_alloc >= 0);
-      memcpy (&mpz_tab[n_alloc++], z, sizeof (mpz_t));
+      /* Push back the mpz_t inside the stack of its class */
+      int s;
+
+      if (mpz_free != 0)
+        {
+          s = mpz_free - 1;
+          mpz_free = mpz_next[s];
+        }
+      else
+        s = n_slots++;
+      MPFR_ASSERTD (s < MPFR_MY_MPZ_INIT);
+      memcpy (&mpz_tab[s], z, sizeof (mpz_t));
+      mpz_next[s] = mpz_head[c];
+      mpz_head[c] = s + 1;
+      n_alloc++;
     }
   else
     {
@@ -69,6 +173,129 @@ mpfr_mpz_clear (mpz_t z)
     }
 }
 
+/* Free the cached mpz_t beyond the first depth ones, the largest first */
+static void
+mpz_trim (int depth)
+{
+  __mpz_struct z;
+  int c;
+
+  for (c = MPFR_MY_MPZ_CLASSES - 1; n_alloc > depth; c--)
+    while (n_alloc > depth && mpz_head[c] != 0)
+      {
+        mpz_pop (&z, c);
+        (__gmpz_clear)(&z);
+      }
+  if (n_alloc == 0)
+    {
+      n_slots = 0;
+      mpz_free = 0;
+    }
+}
+
+/* Set the maximal number of cached mpz_t (at most MPFR_MY_MPZ_INIT),
+   freeing those in excess, and return the old one. */
+int
+mpfr_mpz_pool_set_depth (int depth)
+{
+  int old = mpz_depth;
+
+  MPFR_ASSERTN (depth >= 0);
+  if (depth > MPFR_MY_MPZ_INIT)
+    depth = MPFR_MY_MPZ_INIT;
+  mpz_trim (depth);
+  mpz_depth = depth;
+  return old;
+}
+
+/* Get the statistics of the pool of the current thread: the numbers of
+   mpz_t taken from the pool (hits), allocated by GMP because the pool
+   had no suitable one (misses), and taken from the pool but reallocated
+   by mpfr_mpz_init2 to get the requested size (reallocs, which are also
+   counted in hits). */
+void
+mpfr_mpz_pool_get_stats (mpfr_mpz_pool_stats_t *stats)
+{
+  *stats = mpz_stats;
+}
+
+#else
+
+/* Without a pool, there is nothing to cache and nothing to count. */
+int
+mpfr_mpz_pool_set_depth (int depth)
+{
+  MPFR_ASSERTN (depth >= 0);
+  return 0;
+}
+
+void
+mpfr_mpz_pool_get_stats (mpfr_mpz_pool_stats_t *stats)
+{
+  stats->hits = stats->misses = stats->reallocs = 0;
+}
+
+#endif
+
+#if MPFR_MY_SIGNIFICAND_LIMBS
+
+/* Stacks of the cached significand blocks, indexed by their number of
+   limbs minus 1 (see MPFR_SIGNIFICAND_ALLOC in mpfr-impl.h). The blocks
+   have been allocated with sig_alloc_func and are freed with sig_free_func:
+   if the GMP memory functions are changed, the cache is flushed before the
+   blocks could be returned or freed with the new functions. */
+static MPFR_THREAD_ATTR int n_sig[MPFR_MY_SIGNIFICAND_LIMBS];
+static MPFR_THREAD_ATTR mpfr_limb_ptr
+  sig_tab[MPFR_MY_SIGNIFICAND_LIMBS][MPFR_MY_SIGNIFICAND_DEPTH];
+static MPFR_THREAD_ATTR void * (*sig_alloc_func) (size_t) = 0;
+static MPFR_THREAD_ATTR void (*sig_free_func) (void *, size_t) = 0;
+
+static void
+sig_flush (void)
+{
+  int i, j;
+
+  for (i = 0; i < MPFR_MY_SIGNIFICAND_LIMBS; i++)
+    {
+      MPFR_ASSERTD (n_sig[i] >= 0 && n_sig[i] <= MPFR_MY_SIGNIFICAND_DEPTH);
+      for (j = 0; j < n_sig[i]; j++)
+        (*sig_free_func) (sig_tab[i][j], MPFR_MALLOC_SIZE (i + 1));
+      n_sig[i] = 0;
+    }
+}
+
+MPFR_HOT_FUNCTION_ATTR mpfr_limb_ptr
+mpfr_significand_alloc (mp_size_t n)
+{
+  MPFR_ASSERTD (n > 0);
+  if (n <= MPFR_MY_SIGNIFICAND_LIMBS && n_sig[n - 1] > 0)
+    {
+      if (MPFR_LIKELY (sig_alloc_func == __gmp_allocate_func))
+        return sig_tab[n - 1][--n_sig[n - 1]];
+      sig_flush ();
+    }
+  return (mpfr_limb_ptr) (*__gmp_allocate_func) (MPFR_MALLOC_SIZE (n));
+}
+
+MPFR_HOT_FUNCTION_ATTR void
+mpfr_significand_free (mpfr_limb_ptr p, mp_size_t n)
+{
+  MPFR_ASSERTD (n > 0);
+  if (n <= MPFR_MY_SIGNIFICAND_LIMBS
+      && n_sig[n - 1] < MPFR_MY_SIGNIFICAND_DEPTH)
+    {
+      if (MPFR_UNLIKELY (sig_alloc_func != __gmp_allocate_func))
+        {
+          sig_flush ();
+          sig_alloc_func = __gmp_allocate_func;
+          sig_free_func = __gmp_free_func;
+        }
+      sig_tab[n - 1][n_sig[n - 1]++] = p;
+    }
+  else
+    (*__gmp_free_func) (p, MPFR_MALLOC_SIZE (n));
+}
+
 #endif
 
 /* Theses caches may be global to all threads or local to the current */
@@ -94,15 +321,21 @@ mpfr_free_local_cache (void)
 {
   /* Before mpz caching */
   mpfr_bernoulli_freecache();
+  mpfr_atan_freecache();
+  mpfr_scratch_free ();
 
 #if MPFR_MY_MPZ_INIT
-  { /* Avoid mixed declarations and code for ISO C90 support. */
-    int i;
-    MPFR_ASSERTD (n_alloc >= 0 && n_alloc <= numberof (mpz_tab));
-    for (i = 0; i < n_alloc; i++)
-      (__gmpz_clear)(&mpz_tab[i]);
-    n_alloc = 0;
-  }
+  mpz_trim (0);
+#endif
+}
+
+/* The significand cache is local to a thread, but must be freed last,
+   since freeing the other caches may fill it */
+static void
+mpfr_free_significand_cache (void)
+{
+#if MPFR_MY_SIGNIFICAND_LIMBS
+  sig_flush ();
 #endif
 }
 
@@ -111,22 +344,26 @@ mpfr_free_cache (void)
 {
   mpfr_free_local_cache();
   mpfr_free_const_caches ();
+  mpfr_free_significand_cache ();
 }
 
 void
 mpfr_free_cache2 (mpfr_free_cache_t way)
 {
-  if (way & MPFR_FREE_LOCAL_CACHE)
+  if (way & MPFR_FREE_GLOBAL_CACHE)
     {
-      mpfr_free_local_cache();
-#if !defined (WANT_SHARED_CACHE)
+#if defined (WANT_SHARED_CACHE)
       mpfr_free_const_caches ();
 #endif
     }
-  if (way & MPFR_FREE_GLOBAL_CACHE)
+  if (way & MPFR_FREE_LOCAL_CACHE)
     {
-#if defined (WANT_SHARED_CACHE)
+      mpfr_free_local_cache();
+#if !defined (WANT_SHARED_CACHE)
       mpfr_free_const_caches ();
 #endif
+      /* the significands freed above went to the cache of the current
+         thread, which is freed last */
+      mpfr_free_significand_cache ();
     }
 }
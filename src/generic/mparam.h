@@ -55,6 +55,14 @@ http://www.gnu.org/licenses/ or write to the Free Software Foundation, Inc.,
 # define MPFR_SINCOS_THRESHOLD 30000 /* bits */
 #endif
 
+#ifndef MPFR_ATAN_TABLE_THRESHOLD
+# define MPFR_ATAN_TABLE_THRESHOLD 1000 /* bits */
+#endif
+
+#ifndef MPFR_ROOT_THRESHOLD
+# define MPFR_ROOT_THRESHOLD 300000 /* compared to k^2*PREC(y) */
+#endif
+
 #ifndef MPFR_AI_THRESHOLD1
 # define MPFR_AI_THRESHOLD1 -13107 /* threshold for negative input of mpfr_ai */
 #endif
@@ -168,136 +168,161 @@ get_decimal64_max (int negative)
   return negative ? - DEC64_MAX : DEC64_MAX;
 }
 
-/* one-to-one conversion:
-   s is a decimal string representing a number x = m * 10^e which must be
-   exactly representable in the decimal64 format, i.e.
-   (a) the mantissa m has at most 16 decimal digits
-   (b1) -383 <= e <= 384 with m integer multiple of 10^(-15), |m| < 10
-   (b2) or -398 <= e <= 369 with m integer, |m| < 10^16.
-   Assumes s is neither NaN nor +Inf nor -Inf.
-*/
 #if _MPFR_IEEE_FLOATS
+/* Encode the number (-1)^negative * c * 10^(exp-398), where exp is the
+   biased exponent, 0 <= exp <= 767, and 0 <= c < 10^16 (c is destroyed). */
 static _Decimal64
-string_to_Decimal64 (char *s)
+encode_decimal64 (int negative, mpz_ptr c, long exp)
 {
-  long int exp = 0;
-  char m[17];
-  long n = 0; /* mantissa length */
-  char *endptr[1];
   union mpfr_ieee_double_extract x;
   union ieee_double_decimal64 y;
 #ifdef DPD_FORMAT
-  unsigned int G, d1, d2, d3, d4, d5;
+  unsigned int G, d0, d1, d2, d3, d4, d5;
+#else
+  unsigned long hi, lo;
 #endif
 
-  /* read sign */
-  if (*s == '-')
-    {
-      x.s.sig = 1;
-      s ++;
-    }
-  else
-    x.s.sig = 0;
-  /* read mantissa */
-  while (ISDIGIT (*s))
-    m[n++] = *s++;
-  exp = n;
-  if (*s == '.')
-    {
-      s ++;
-      while (ISDIGIT (*s))
-        m[n++] = *s++;
-    }
-  /* we have exp digits before decimal point, and a total of n digits */
-  exp -= n; /* we will consider an integer mantissa */
-  MPFR_ASSERTN(n <= 16);
-  if (*s == 'E' || *s == 'e')
-    exp += strtol (s + 1, endptr, 10);
-  else
-    *endptr = s;
-  MPFR_ASSERTN(**endptr == '\0');
-  MPFR_ASSERTN(-398 <= exp && exp <= (long) (385 - n));
-  while (n < 16)
-    {
-      m[n++] = '0';
-      exp --;
-    }
-  /* now n=16 and -398 <= exp <= 369 */
-  m[n] = '\0';
-
-  /* compute biased exponent */
-  exp += 398;
-
-  MPFR_ASSERTN(exp >= -15);
-  if (exp < 0)
-    {
-      int i;
-      n = -exp;
-      /* check the last n digits of the mantissa are zero */
-      for (i = 1; i <= n; i++)
-        MPFR_ASSERTN(m[16 - n] == '0');
-      /* shift the first (16-n) digits to the right */
-      for (i = 16 - n - 1; i >= 0; i--)
-        m[i + n] = m[i];
-      /* zero the first n digits */
-      for (i = 0; i < n; i ++)
-        m[i] = '0';
-      exp = 0;
-    }
-
-  /* now convert to DPD or BID */
+  MPFR_ASSERTD (0 <= exp && exp <= 767);
+  x.s.sig = negative != 0;
 #ifdef DPD_FORMAT
-#define CH(d) (d - '0')
-  if (m[0] >= '8')
-    G = (3 << 11) | ((exp & 768) << 1) | ((CH(m[0]) & 1) << 8);
+  d5 = T[mpz_tdiv_q_ui (c, c, 1000)]; /* 10-bit encoding */
+  d4 = T[mpz_tdiv_q_ui (c, c, 1000)];
+  d3 = T[mpz_tdiv_q_ui (c, c, 1000)];
+  d2 = T[mpz_tdiv_q_ui (c, c, 1000)];
+  d1 = T[mpz_tdiv_q_ui (c, c, 1000)];
+  d0 = mpz_get_ui (c);
+  if (d0 >= 8)
+    G = (3 << 11) | ((exp & 768) << 1) | ((d0 & 1) << 8);
   else
-    G = ((exp & 768) << 3) | (CH(m[0]) << 8);
+    G = ((exp & 768) << 3) | (d0 << 8);
   /* now the most 5 significant bits of G are filled */
   G |= exp & 255;
-  d1 = T[100 * CH(m[1]) + 10 * CH(m[2]) + CH(m[3])]; /* 10-bit encoding */
-  d2 = T[100 * CH(m[4]) + 10 * CH(m[5]) + CH(m[6])]; /* 10-bit encoding */
-  d3 = T[100 * CH(m[7]) + 10 * CH(m[8]) + CH(m[9])]; /* 10-bit encoding */
-  d4 = T[100 * CH(m[10]) + 10 * CH(m[11]) + CH(m[12])]; /* 10-bit encoding */
-  d5 = T[100 * CH(m[13]) + 10 * CH(m[14]) + CH(m[15])]; /* 10-bit encoding */
   x.s.exp = G >> 2;
   x.s.manh = ((G & 3) << 18) | (d1 << 8) | (d2 >> 2);
   x.s.manl = (d2 & 3) << 30;
   x.s.manl |= (d3 << 20) | (d4 << 10) | d5;
 #else /* BID format */
-  {
-    mp_size_t rn;
-    mp_limb_t rp[2];
-    int case_i = strcmp (m, "9007199254740992") < 0;
-
-    for (n = 0; n < 16; n++)
-      m[n] -= '0';
-    rn = mpn_set_str (rp, (unsigned char *) m, 16, 10);
-    if (rn == 1)
-      rp[1] = 0;
-#if GMP_NUMB_BITS > 32
-    rp[1] = rp[1] << (GMP_NUMB_BITS - 32);
-    rp[1] |= rp[0] >> 32;
-    rp[0] &= 4294967295UL;
+#if GMP_NUMB_BITS >= 64
+  lo = mpz_getlimbn (c, 0) & 4294967295UL;
+  hi = mpz_getlimbn (c, 0) >> 32;
+#else
+  lo = mpz_getlimbn (c, 0);
+  hi = mpz_getlimbn (c, 1);
 #endif
-    if (case_i)
-      {  /* s < 2^53: case i) */
-        x.s.exp = exp << 1;
-        x.s.manl = rp[0];           /* 32 bits */
-        x.s.manh = rp[1] & 1048575; /* 20 low bits */
-        x.s.exp |= rp[1] >> 20;     /* 1 bit */
-      }
-    else /* s >= 2^53: case ii) */
-      {
-        x.s.exp = 1536 | (exp >> 1);
-        x.s.manl = rp[0];
-        x.s.manh = (rp[1] ^ 2097152) | ((exp & 1) << 19);
-      }
-  }
+  if (hi < 2097152)
+    {  /* c < 2^53: case i) */
+      x.s.exp = (exp << 1) | (hi >> 20);
+      x.s.manl = lo;               /* 32 bits */
+      x.s.manh = hi & 1048575;     /* 20 low bits */
+    }
+  else /* c >= 2^53: case ii) */
+    {
+      x.s.exp = 1536 | (exp >> 1);
+      x.s.manl = lo;
+      x.s.manh = (hi ^ 2097152) | ((exp & 1) << 19);
+    }
 #endif /* DPD_FORMAT */
   y.d = x.d;
   return y.d64;
 }
+
+/* Return the decimal64 number obtained by rounding src in the direction
+   rnd_mode (not MPFR_RNDA), where src is a regular number with exponent
+   -1323 <= e <= 1279. The coefficient is computed with integer arithmetic
+   only: with q2 such that |src| / 10^q2 has 17 to 19 digits, we get
+   trunc(|src| / 10^q2) = trunc(m * 2^(f-q2) / 5^q2) plus a sticky bit with
+   a single multiplication or division by a power of 5, and then discard
+   the extra digits by divisions by 10. The variables m, c and d are used
+   as temporaries. */
+static _Decimal64
+get_decimal64_direct (mpfr_srcptr src, mpfr_rnd_t rnd_mode,
+                      mpz_ptr m, mpz_ptr c, mpz_ptr d)
+{
+  int negative = MPFR_IS_NEG (src);
+  mpfr_exp_t e = MPFR_GET_EXP (src), f;
+  long t, est, q2, q, s, k;
+  unsigned long digit;
+  int sticky;
+  double dc;
+
+  f = mpfr_get_z_2exp (m, src);
+  mpz_abs (m, m);
+
+  /* 2^(e-1) <= |src| < 2^e; est = floor((e-1)*log10(2)) up to +/-1, using
+     78913/2^18 ~ log10(2), thus floor(log10|src|) - est is -1, 0 or 1 */
+  t = (long) (e - 1) * 78913;
+  est = t >= 0 ? t >> 18 : - ((- t + 262143) >> 18);
+  q2 = est - 17;
+
+  /* c = trunc(|src| / 10^q2) = trunc(m * 2^s / 5^q2) */
+  s = (long) f - q2;
+  sticky = 0;
+  if (q2 <= 0)
+    {
+      mpz_ui_pow_ui (d, 5, - q2);
+      mpz_mul (m, m, d);
+      if (s >= 0)
+        mpz_mul_2exp (c, m, s);
+      else
+        {
+          sticky = mpz_scan1 (m, 0) < (mp_bitcnt_t) - s;
+          mpz_tdiv_q_2exp (c, m, - s);
+        }
+    }
+  else
+    {
+      mpz_ui_pow_ui (d, 5, q2);
+      if (s >= 0)
+        mpz_mul_2exp (m, m, s);
+      else
+        mpz_mul_2exp (d, d, - s);
+      mpz_tdiv_qr (c, m, m, d);
+      sticky = mpz_sgn (m) != 0;
+    }
+
+  /* c has 17, 18 or 19 digits; 10^17 and 10^18 are exact doubles and
+     the conversion of c truncates, so that the comparisons are exact */
+  dc = mpz_get_d (c);
+  MPFR_ASSERTD (1e16 <= dc && dc < 1e19);
+  q = q2 + (dc >= 1e18 ? 19 : dc >= 1e17 ? 18 : 17) - 16;
+  /* the exponent of the result cannot be below the subnormal one */
+  if (q < -398)
+    q = -398;
+
+  /* remove the q - q2 low digits of c, the last one being the round digit */
+  for (k = q - q2; k > 1; k--)
+    sticky |= mpz_tdiv_q_ui (c, c, 10) != 0;
+  digit = mpz_tdiv_q_ui (c, c, 10);
+
+  if (! MPFR_IS_LIKE_RNDZ (rnd_mode, negative) &&
+      (rnd_mode == MPFR_RNDN ?
+       digit > 5 || (digit == 5 && (sticky || mpz_odd_p (c))) :
+       digit != 0 || sticky))
+    {
+      mpz_add_ui (c, c, 1);
+      if (mpz_get_d (c) == 1e16)
+        {
+          mpz_divexact_ui (c, c, 10);
+          q ++;
+        }
+    }
+
+  /* the largest decimal64 number is (10^16-1) * 10^369 */
+  if (q > 369)
+    return MPFR_IS_LIKE_RNDZ (rnd_mode, negative) ?
+      get_decimal64_max (negative) : get_decimal64_inf (negative);
+
+  return encode_decimal64 (negative, c, q + 398);
+}
 #else
+/* one-to-one conversion:
+   s is a decimal string representing a number x = m * 10^e which must be
+   exactly representable in the decimal64 format, i.e.
+   (a) the mantissa m has at most 16 decimal digits
+   (b1) -383 <= e <= 384 with m integer multiple of 10^(-15), |m| < 10
+   (b2) or -398 <= e <= 369 with m integer, |m| < 10^16.
+   Assumes s is neither NaN nor +Inf nor -Inf.
+*/
 /* portable version */
 static _Decimal64
 string_to_Decimal64 (char *s)
@@ -491,8 +516,11 @@ string_to_Decimal64 (char *s)
 }
 #endif
 
-_Decimal64
-mpfr_get_decimal64 (mpfr_srcptr src, mpfr_rnd_t rnd_mode)
+/* Convert src to a decimal64 number. If tmp is not NULL, it points to
+   3 initialized integers used as temporaries (this avoids allocations in
+   mpfr_get_decimal64_array). */
+static _Decimal64
+get_decimal64_aux (mpfr_srcptr src, mpfr_rnd_t rnd_mode, mpz_t *tmp)
 {
   int negative;
   mpfr_exp_t e;
@@ -541,6 +569,21 @@ mpfr_get_decimal64 (mpfr_srcptr src, mpfr_rnd_t rnd_mode)
     }
   else
     {
+#if _MPFR_IEEE_FLOATS
+      mpz_t z[3];
+      _Decimal64 r;
+
+      if (tmp != NULL)
+        return get_decimal64_direct (src, rnd_mode, tmp[0], tmp[1], tmp[2]);
+      mpz_init (z[0]);
+      mpz_init (z[1]);
+      mpz_init (z[2]);
+      r = get_decimal64_direct (src, rnd_mode, z[0], z[1], z[2]);
+      mpz_clear (z[0]);
+      mpz_clear (z[1]);
+      mpz_clear (z[2]);
+      return r;
+#else
       /* we need to store the sign (1), the mantissa (16), and the terminating
          character, thus we need at least 18 characters in s */
       char s[23];
@@ -600,7 +643,33 @@ mpfr_get_decimal64 (mpfr_srcptr src, mpfr_rnd_t rnd_mode)
           sprintf (s + 17 + negative, "%ld", (long int)e - 16);
           return string_to_Decimal64 (s);
         }
+#endif
     }
 }
 
+_Decimal64
+mpfr_get_decimal64 (mpfr_srcptr src, mpfr_rnd_t rnd_mode)
+{
+  return get_decimal64_aux (src, rnd_mode, NULL);
+}
+
+/* Set d[i] to tab[i] rounded in the direction rnd_mode, for 0 <= i < n.
+   The temporaries are shared by all the conversions. */
+void
+mpfr_get_decimal64_array (_Decimal64 *d, mpfr_ptr *const tab,
+                          unsigned long n, mpfr_rnd_t rnd_mode)
+{
+  mpz_t tmp[3];
+  unsigned long i;
+
+  mpz_init (tmp[0]);
+  mpz_init (tmp[1]);
+  mpz_init (tmp[2]);
+  for (i = 0; i < n; i++)
+    d[i] = get_decimal64_aux (tab[i], rnd_mode, tmp);
+  mpz_clear (tmp[0]);
+  mpz_clear (tmp[1]);
+  mpz_clear (tmp[2]);
+}
+
 #endif /* MPFR_WANT_DECIMAL_FLOATS */
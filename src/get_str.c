@@ -2229,6 +2229,197 @@ mpfr_ceil_mul (mpfr_exp_t e, int beta, int i)
   return r;
 }
 
+/* Return the number of digits needed in base b for a number of precision
+   p, so that it can be read back exactly: 1 + ceil(p*log(2)/log(b)),
+   where p is replaced by p-1 if b is a power of 2 (the first digit then
+   contains at least one bit), but at least 2.
+   Note: this function should be called only in the extended exponent range.
+*/
+static size_t
+get_str_ndigits (mpfr_prec_t p, int b)
+{
+  size_t m;
+
+  m = 1 + mpfr_ceil_mul (IS_POW2(b) ? p - 1 : p, b, 1);
+  return m < 2 ? 2 : m;
+}
+
+/* Write in s the m digits of the regular number x in the base b, which is
+   not a power of 2, rounded with direction rnd (if x is negative, rnd must
+   already have been inverted, and the sign is not written), and the
+   corresponding exponent in e.
+   g = mpfr_ceil_mul (MPFR_GET_EXP (x) - 1, b, 1) and pm = mpfr_ceil_mul
+   (m, b, 0) are given by the caller, which may have them precomputed.
+   Must be called in the extended exponent range. */
+static void
+get_str_ziv (char *s, mpfr_exp_t *e, int b, size_t m, mpfr_srcptr x,
+             mpfr_rnd_t rnd, mpfr_exp_t g, mpfr_exp_t pm)
+{
+  int exact;                      /* exact result */
+  mpfr_exp_t exp;
+  mpfr_exp_t prec; /* precision of the computation */
+  long err;
+  mp_limb_t *a;
+  mpfr_exp_t exp_a;
+  mp_limb_t *result;
+  mp_limb_t *xp;
+  mp_limb_t *reste;
+  size_t nx, nx1;
+  size_t n;
+  int ret; /* return value of mpfr_get_str_aux */
+  MPFR_ZIV_DECL (loop);
+  MPFR_TMP_DECL (marker);
+
+  /* if exact = 1 then err is undefined */
+  /* otherwise err is such that |x*b^(m-g)-a*2^exp_a| < 2^(err+exp_a) */
+
+  xp = MPFR_MANT (x);
+
+  exact = 1;
+  prec = pm + 1;
+  exp = ((mpfr_exp_t) m < g) ? g - (mpfr_exp_t) m : (mpfr_exp_t) m - g;
+  prec += MPFR_INT_CEIL_LOG2 (prec); /* number of guard bits */
+  if (exp != 0) /* add maximal exponentiation error */
+    prec += 3 * (mpfr_exp_t) MPFR_INT_CEIL_LOG2 (exp);
+
+  MPFR_ZIV_INIT (loop, prec);
+  for (;;)
+    {
+      MPFR_TMP_MARK (marker);
+
+      exact = 1;
+
+      /* number of limbs */
+      n = MPFR_PREC2LIMBS (prec);
+
+      /* a will contain the approximation of the mantissa */
+      a = MPFR_TMP_LIMBS_ALLOC (n);
+
+      nx = MPFR_LIMB_SIZE (x);
+
+      if ((mpfr_exp_t) m == g) /* final exponent is 0, no multiplication or
+                                  division to perform */
+        {
+          if (nx > n)
+            exact = mpn_scan1 (xp, 0) >= (nx - n) * GMP_NUMB_BITS;
+          err = !exact;
+          MPN_COPY2 (a, n, xp, nx);
+          exp_a = MPFR_GET_EXP (x) - n * GMP_NUMB_BITS;
+        }
+      else if ((mpfr_exp_t) m > g) /* we have to multiply x by b^exp */
+        {
+          mp_limb_t *x1;
+
+          /* a2*2^exp_a =  b^e */
+          err = mpfr_mpn_exp (a, &exp_a, b, exp, n);
+          /* here, the error on a is at most 2^err ulps */
+          exact = (err == -1);
+
+          /* x = x1*2^(n*GMP_NUMB_BITS) */
+          x1 = (nx >= n) ? xp + nx - n : xp;
+          nx1 = (nx >= n) ? n : nx; /* nx1 = min(n, nx) */
+
+          /* test si exact */
+          if (nx > n)
+            exact = (exact &&
+                     ((mpn_scan1 (xp, 0) >= (nx - n) * GMP_NUMB_BITS)));
+
+          /* we loose one more bit in the multiplication,
+             except when err=0 where we loose two bits */
+          err = (err <= 0) ? 2 : err + 1;
+
+          /* result = a * x */
+          result = MPFR_TMP_LIMBS_ALLOC (n + nx1);
+          mpn_mul (result, a, n, x1, nx1);
+          exp_a += MPFR_GET_EXP (x);
+          if (mpn_scan1 (result, 0) < (nx1 * GMP_NUMB_BITS))
+            exact = 0;
+
+          /* normalize a and truncate */
+          if ((result[n + nx1 - 1] & MPFR_LIMB_HIGHBIT) == 0)
+            {
+              mpn_lshift (a, result + nx1, n , 1);
+              a[0] |= result[nx1 - 1] >> (GMP_NUMB_BITS - 1);
+              exp_a --;
+            }
+          else
+            MPN_COPY (a, result + nx1, n);
+        }
+      else
+        {
+          mp_limb_t *x1;
+
+          /* a2*2^exp_a =  b^e */
+          err = mpfr_mpn_exp (a, &exp_a, b, exp, n);
+          exact = (err == -1);
+
+          /* allocate memory for x1, result and reste */
+          x1 = MPFR_TMP_LIMBS_ALLOC (2 * n);
+          result = MPFR_TMP_LIMBS_ALLOC (n + 1);
+          reste = MPFR_TMP_LIMBS_ALLOC (n);
+
+          /* initialize x1 = x */
+          MPN_COPY2 (x1, 2 * n, xp, nx);
+          if ((exact) && (nx > 2 * n) &&
+              (mpn_scan1 (xp, 0) < (nx - 2 * n) * GMP_NUMB_BITS))
+            exact = 0;
+
+          /* result = x / a */
+          mpn_tdiv_qr (result, reste, 0, x1, 2 * n, a, n);
+          exp_a = MPFR_GET_EXP (x) - exp_a - 2 * n * GMP_NUMB_BITS;
+
+          /* test if division was exact */
+          if (exact)
+            exact = mpn_popcount (reste, n) == 0;
+
+          /* normalize the result and copy into a */
+          if (result[n] == 1)
+            {
+              mpn_rshift (a, result, n, 1);
+              a[n - 1] |= MPFR_LIMB_HIGHBIT;;
+              exp_a ++;
+            }
+          else
+            MPN_COPY (a, result, n);
+
+          err = (err == -1) ? 2 : err + 2;
+        }
+
+      /* check if rounding is possible */
+      if (exact)
+        err = -1;
+
+      ret = mpfr_get_str_aux (s, e, a, n, exp_a, err, b, m, rnd);
+
+      MPFR_TMP_FREE (marker);
+
+      if (ret == MPFR_ROUND_FAILED)
+        {
+          /* too large error: increment the working precision */
+          MPFR_ZIV_NEXT (loop, prec);
+        }
+      else if (ret == - MPFR_ROUND_FAILED)
+        {
+          /* too many digits in mantissa: exp = |m-g| */
+          if ((mpfr_exp_t) m > g) /* exp = m - g, multiply by b^exp */
+            {
+              g ++;
+              exp --;
+            }
+          else /* exp = g - m, divide by b^exp */
+            {
+              g ++;
+              exp ++;
+            }
+        }
+      else
+        break;
+    }
+  MPFR_ZIV_FREE (loop);
+
+  *e += g;
+}
+
 /* prints the mantissa of x in the string s, and writes the corresponding
    exponent in e.
    x is rounded with direction rnd, m is the number of digits of the mantissa,
@@ -2247,27 +2438,15 @@ mpfr_get_str (char *s, mpfr_exp_t *e, int b, size_t m, mpfr_srcptr x,
               mpfr_rnd_t rnd)
 {
   const char *num_to_text;
-  int exact;                      /* exact result */
-  mpfr_exp_t exp, g;
+  mpfr_exp_t g;
   mpfr_exp_t prec; /* precision of the computation */
-  long err;
-  mp_limb_t *a;
-  mpfr_exp_t exp_a;
-  mp_limb_t *result;
   mp_limb_t *xp;
-  mp_limb_t *reste;
-  size_t nx, nx1;
   size_t n, i;
   char *s0;
   int neg;
-  int ret; /* return value of mpfr_get_str_aux */
-  MPFR_ZIV_DECL (loop);
   MPFR_SAVE_EXPO_DECL (expo);
   MPFR_TMP_DECL (marker);
 
-  /* if exact = 1 then err is undefined */
-  /* otherwise err is such that |x*b^(m-g)-a*2^exp_a| < 2^(err+exp_a) */
-
   MPFR_LOG_FUNC
     (("b=%d m=%zu x[%Pu]=%.*Rg rnd=%d",
       b, m, mpfr_get_prec (x), mpfr_log_prec, x, rnd),
@@ -2313,10 +2492,7 @@ mpfr_get_str (char *s, mpfr_exp_t *e, int b, size_t m, mpfr_srcptr x,
          the first base-b digit contains only one bit, so we get
          1 + ceil((n-1)/k) = 2 + floor((n-2)/k) instead.
       */
-      m = 1 +
-        mpfr_ceil_mul (IS_POW2(b) ? MPFR_PREC(x) - 1 : MPFR_PREC(x), b, 1);
-      if (m < 2)
-        m = 2;
+      m = get_str_ndigits (MPFR_PREC(x), b);
     }
 
   MPFR_LOG_MSG (("m=%zu\n", m));
@@ -2418,154 +2594,446 @@ mpfr_get_str (char *s, mpfr_exp_t *e, int b, size_t m, mpfr_srcptr x,
     rnd = MPFR_INVERT_RND (rnd);
 
   g = mpfr_ceil_mul (MPFR_GET_EXP (x) - 1, b, 1);
-  exact = 1;
-  prec = mpfr_ceil_mul (m, b, 0) + 1;
-  exp = ((mpfr_exp_t) m < g) ? g - (mpfr_exp_t) m : (mpfr_exp_t) m - g;
-  prec += MPFR_INT_CEIL_LOG2 (prec); /* number of guard bits */
-  if (exp != 0) /* add maximal exponentiation error */
-    prec += 3 * (mpfr_exp_t) MPFR_INT_CEIL_LOG2 (exp);
+  get_str_ziv (s, e, b, m, x, rnd, g, mpfr_ceil_mul (m, b, 0));
 
-  MPFR_ZIV_INIT (loop, prec);
-  for (;;)
-    {
-      MPFR_TMP_MARK (marker);
+  MPFR_LOG_MSG (("e=%" MPFR_EXP_FSPEC "d\n", (mpfr_eexp_t) *e));
 
-      exact = 1;
+  MPFR_SAVE_EXPO_FREE (expo);
+  return s0;
+}
 
-      /* number of limbs */
-      n = MPFR_PREC2LIMBS (prec);
+/* Return non-zero iff the m-digit string t (without sign) with exponent e
+   in base b, read back with the precision of y and rounding to nearest,
+   gives ax > 0. Set y to the read value. buf must have room for m plus
+   the exponent part. */
+static int
+shortest_roundtrip (mpfr_ptr y, mpfr_srcptr ax, char *buf, const char *t,
+                    size_t m, mpfr_exp_t e, int b)
+{
+  memcpy (buf, t, m);
+  sprintf (buf + m, "@%" MPFR_EXP_FSPEC "d", (mpfr_eexp_t) e - (mpfr_eexp_t) m);
+  mpfr_strtofr (y, buf, NULL, b, MPFR_RNDN);
+  return mpfr_equal_p (y, ax);
+}
 
-      /* a will contain the approximation of the mantissa */
-      a = MPFR_TMP_LIMBS_ALLOC (n);
+/* The direct algorithm of mpfr_get_str_shortest is used in base 10, for a
+   precision from 5 to MPFR_SHORTEST_PREC and an exponent of absolute value
+   up to MPFR_SHORTEST_EMAX (the power of 5 it needs has about 2.3 times as
+   many bits as this exponent). Below 5 bits, the rounding interval may
+   contain both a power of 10 and a nearer one-digit number of the lower
+   decade, and the choice of the nearest string is left to the search. */
+#ifndef MPFR_SHORTEST_PREC
+# define MPFR_SHORTEST_PREC 64
+#endif
+#ifndef MPFR_SHORTEST_EMAX
+# define MPFR_SHORTEST_EMAX 16384
+#endif
+
+/* Digit removal of the Ryu algorithm (Ulf Adams, PLDI 2018), in its
+   general form: vm, vr and vp are the lower bound of the rounding interval,
+   the value and the upper bound, scaled by a power of 10 and truncated to
+   integers; vm_tz and vr_tz tell whether no nonzero digit was truncated
+   from vm and vr, and last is the last digit removed from vr. The digits
+   are removed while the interval contains a multiple of 10, then the
+   remaining value is rounded to nearest (or up if it is below the
+   interval). Return the digits of the result, the number of removed
+   digits being added to *removed. */
+static unsigned long
+shortest_digits_ui (unsigned long vm, unsigned long vr, unsigned long vp,
+                    int vm_tz, int vr_tz, int last, int accept,
+                    long *removed)
+{
+  while (vp / 10 > vm / 10)
+    {
+      vm_tz = vm_tz && vm % 10 == 0;
+      vr_tz = vr_tz && last == 0;
+      last = vr % 10;
+      vm /= 10;
+      vr /= 10;
+      vp /= 10;
+      (*removed) ++;
+    }
+  if (vm_tz) /* vm is in the interval */
+    while (vm % 10 == 0)
+      {
+        vr_tz = vr_tz && last == 0;
+        last = vr % 10;
+        vm /= 10;
+        vr /= 10;
+        vp /= 10;
+        (*removed) ++;
+      }
+  if (vr_tz && last == 5 && vr % 2 == 0)
+    last = 4; /* the value is a midpoint: round to even */
+  return vr + ((vr == vm && (!accept || !vm_tz)) || last >= 5);
+}
 
-      nx = MPFR_LIMB_SIZE (x);
+/* Same as shortest_digits_ui on v[0] = vm, v[1] = vr and v[2] = vp, with
+   last = 0 initially, the result being put in v[1]. As soon as vp fits in
+   an unsigned long, the work is finished by shortest_digits_ui. */
+static void
+shortest_digits_z (mpz_t *v, int vm_tz, int vr_tz, int accept, long *removed)
+{
+  mpz_t t, u;
+  int last = 0, vm_mod;
 
-      if ((mpfr_exp_t) m == g) /* final exponent is 0, no multiplication or
-                                  division to perform */
+  mpz_init (t);
+  mpz_init (u);
+  for (;;)
+    {
+      if (mpz_fits_ulong_p (v[2]))
         {
-          if (nx > n)
-            exact = mpn_scan1 (xp, 0) >= (nx - n) * GMP_NUMB_BITS;
-          err = !exact;
-          MPN_COPY2 (a, n, xp, nx);
-          exp_a = MPFR_GET_EXP (x) - n * GMP_NUMB_BITS;
+          mpz_set_ui (v[1], shortest_digits_ui (mpz_get_ui (v[0]),
+                                                mpz_get_ui (v[1]),
+                                                mpz_get_ui (v[2]), vm_tz,
+                                                vr_tz, last, accept,
+                                                removed));
+          goto end;
         }
-      else if ((mpfr_exp_t) m > g) /* we have to multiply x by b^exp */
+      mpz_tdiv_q_ui (t, v[2], 10);
+      vm_mod = mpz_tdiv_q_ui (u, v[0], 10);
+      if (mpz_cmp (t, u) <= 0)
+        break;
+      vm_tz = vm_tz && vm_mod == 0;
+      vr_tz = vr_tz && last == 0;
+      last = mpz_tdiv_q_ui (v[1], v[1], 10);
+      mpz_swap (v[0], u);
+      mpz_swap (v[2], t);
+      (*removed) ++;
+    }
+  if (vm_tz)
+    while (mpz_tdiv_ui (v[0], 10) == 0)
+      {
+        vr_tz = vr_tz && last == 0;
+        last = mpz_tdiv_q_ui (v[1], v[1], 10);
+        mpz_tdiv_q_ui (v[0], v[0], 10);
+        mpz_tdiv_q_ui (v[2], v[2], 10);
+        (*removed) ++;
+      }
+  if (vr_tz && last == 5 && mpz_even_p (v[1]))
+    last = 4;
+  if ((mpz_cmp (v[1], v[0]) == 0 && (!accept || !vm_tz)) || last >= 5)
+    mpz_add_ui (v[1], v[1], 1);
+ end:
+  mpz_clear (t);
+  mpz_clear (u);
+}
+
+/* Direct algorithm for mpfr_get_str_shortest in base 10, for ax > 0 of
+   precision p <= MPFR_SHORTEST_PREC: write the digits in t (of size n) and
+   the exponent in *e, and return the number of digits.
+
+   Let ax = m * 2^e2 with 2^(p-1) <= m < 2^p. The numbers that round to ax
+   are those of the interval of bounds (4m-2) 2^(e2-2) and (4m+2) 2^(e2-2)
+   (or (4m-1) 2^(e2-2) if m = 2^(p-1), the lower neighbor being closer),
+   the bounds being included iff m is even (round to nearest even). These
+   three values are multiplied by 10^(-q), where q is chosen so that the
+   width of the interval is between 75 and 1000: the integer parts are
+   exact operations on integers of about p + 10 bits in general, and the
+   interval contains a multiple of 10, which gives at least one digit to
+   remove. */
+static size_t
+shortest_direct (char *t, size_t n, mpfr_exp_t *e, mpfr_srcptr ax)
+{
+  mpz_t v[3], p5, r;
+  mpfr_exp_t e2, q, k, sh;
+  int exact[3], accept, i;
+  long removed = 0;
+  size_t l;
+
+  mpz_init (v[1]);
+  e2 = mpfr_get_z_2exp (v[1], ax); /* m */
+  accept = mpz_even_p (v[1]);
+  mpz_mul_2exp (v[1], v[1], 2);
+  mpz_init (v[0]);
+  mpz_init (v[2]);
+  mpz_sub_ui (v[0], v[1], mpfr_powerof2_raw (ax) ? 1 : 2);
+  mpz_add_ui (v[2], v[1], 2);
+
+  /* q = floor(e2 log10(2)) - 2, where floor(k log10(2)) is computed
+     exactly with 78913/2^18 for k <= 1650; above, 19728/2^16 gives it
+     within 1, and q may be smaller than wanted, but not larger (the
+     products fit in 32 bits) */
+  MPFR_STAT_STATIC_ASSERT (MPFR_SHORTEST_EMAX + MPFR_SHORTEST_PREC <= 16448);
+  k = e2 < 0 ? -e2 : e2;
+  q = k <= 1650 ? (k * 78913) >> 18 : ((k * 19728) >> 16) + (e2 < 0);
+  q = e2 < 0 ? - q - 3 : q - 2;
+
+  /* v[i] = floor(v[i] 2^(e2-2) 10^k) with k = -q */
+  k = -q;
+  sh = e2 - 2 + k;
+  mpz_init (p5);
+  mpz_init (r);
+  mpz_ui_pow_ui (p5, 5, (unsigned long) (k < 0 ? -k : k));
+  for (i = 0; i < 3; i++)
+    {
+      exact[i] = 1;
+      if (k > 0)
+        mpz_mul (v[i], v[i], p5);
+      if (sh > 0)
+        mpz_mul_2exp (v[i], v[i], sh);
+      else if (sh < 0)
         {
-          mp_limb_t *x1;
+          exact[i] = mpz_scan1 (v[i], 0) >= (unsigned long) -sh;
+          mpz_tdiv_q_2exp (v[i], v[i], -sh);
+        }
+      if (k < 0)
+        {
+          mpz_tdiv_qr (v[i], r, v[i], p5);
+          exact[i] = exact[i] && mpz_sgn (r) == 0;
+        }
+    }
+  mpz_clear (p5);
+  mpz_clear (r);
+
+  if (!accept && exact[2])
+    mpz_sub_ui (v[2], v[2], 1); /* the upper bound is excluded */
+  shortest_digits_z (v, accept && exact[0], exact[1], accept, &removed);
+
+  MPFR_ASSERTN (mpz_sizeinbase (v[1], 10) + 2 <= n);
+  mpz_get_str (t, 10, v[1]);
+  l = strlen (t);
+  *e = (mpfr_exp_t) l + q + removed;
+  mpz_clear (v[0]);
+  mpz_clear (v[1]);
+  mpz_clear (v[2]);
+  return l;
+}
 
-          /* a2*2^exp_a =  b^e */
-          err = mpfr_mpn_exp (a, &exp_a, b, exp, n);
-          /* here, the error on a is at most 2^err ulps */
-          exact = (err == -1);
+/* Shortest round-trip output: returns in s the shortest string of digits
+   in base b such that reading it back with the precision of x and rounding
+   to nearest gives x again; among the strings of that length, the one
+   nearest to x is chosen. The exponent is written in e with the same
+   convention as mpfr_get_str, and trailing zeros are removed.
+
+   In base 10, for a precision up to MPFR_SHORTEST_PREC, the digits are
+   computed directly by shortest_direct. Otherwise, since appending a zero
+   to a string does not change its value, the existence of a suitable
+   m-digit string is monotonic in m, thus we do a binary search between 1
+   (or 2 for a power of two base, as required by mpfr_get_str) and the
+   number of digits chosen by mpfr_get_str with n=0, which always
+   round-trips. Since the answer is most of the time one
+   of the two largest lengths, the first probe is at the largest but one.
+   For a given m, if some m-digit string round-trips, then the one nearest
+   to x does, except when x is a power of 2, where the rounding interval
+   of x is not symmetric: then the nearest string may be below x and out
+   of the interval, while the one above x is inside. */
+char *
+mpfr_get_str_shortest (char *s, mpfr_exp_t *e, int b, mpfr_srcptr x)
+{
+  mpfr_t ax, y;
+  char *best, *t, *buf, d[48];
+  mpfr_exp_t best_e, et;
+  size_t lo, hi, mid, l, buf_size;
+  int neg, pow2x;
+  mpfr_flags_t saved_flags;
 
-          /* x = x1*2^(n*GMP_NUMB_BITS) */
-          x1 = (nx >= n) ? xp + nx - n : xp;
-          nx1 = (nx >= n) ? n : nx; /* nx1 = min(n, nx) */
+  if (b < 2 || b > 62)
+    return NULL;
 
-          /* test si exact */
-          if (nx > n)
-            exact = (exact &&
-                     ((mpn_scan1 (xp, 0) >= (nx - n) * GMP_NUMB_BITS)));
+  if (MPFR_UNLIKELY (MPFR_IS_SINGULAR (x)))
+    {
+      if (!MPFR_IS_ZERO (x)) /* NaN or Inf */
+        return mpfr_get_str (s, e, b, 0, x, MPFR_RNDN);
+      neg = MPFR_IS_NEG (x);
+      if (s == NULL)
+        s = (char *) (*__gmp_allocate_func) (neg + 2);
+      strcpy (s, neg ? "-0" : "0");
+      *e = 0;
+      return s;
+    }
 
-          /* we loose one more bit in the multiplication,
-             except when err=0 where we loose two bits */
-          err = (err <= 0) ? 2 : err + 1;
+  neg = MPFR_IS_NEG (x);
+  MPFR_ALIAS (ax, x, MPFR_SIGN_POS, MPFR_EXP (x));
 
-          /* result = a * x */
-          result = MPFR_TMP_LIMBS_ALLOC (n + nx1);
-          mpn_mul (result, a, n, x1, nx1);
-          exp_a += MPFR_GET_EXP (x);
-          if (mpn_scan1 (result, 0) < (nx1 * GMP_NUMB_BITS))
-            exact = 0;
+  if (b == 10 && MPFR_PREC (x) >= 5 && MPFR_PREC (x) <= MPFR_SHORTEST_PREC
+      && MPFR_EXP (x) > __gmpfr_emin && MPFR_EXP (x) <= __gmpfr_emax
+      && MPFR_EXP (x) >= - MPFR_SHORTEST_EMAX
+      && MPFR_EXP (x) <= MPFR_SHORTEST_EMAX)
+    {
+      /* the lower bound of the rounding interval is different in the
+         smallest binade, excluded above */
+      hi = shortest_direct (d, sizeof (d), &best_e, ax);
+      best = d;
+      goto copy;
+    }
 
-          /* normalize a and truncate */
-          if ((result[n + nx1 - 1] & MPFR_LIMB_HIGHBIT) == 0)
-            {
-              mpn_lshift (a, result + nx1, n , 1);
-              a[0] |= result[nx1 - 1] >> (GMP_NUMB_BITS - 1);
-              exp_a --;
-            }
-          else
-            MPN_COPY (a, result + nx1, n);
+  saved_flags = __gmpfr_flags;
+  pow2x = mpfr_powerof2_raw (x);
+  mpfr_init2 (y, MPFR_PREC (x));
+
+  best = mpfr_get_str (NULL, &best_e, b, 0, ax, MPFR_RNDN);
+  hi = strlen (best);
+  lo = IS_POW2 (b) ? 2 : 1;
+  buf_size = hi + 32; /* room for the exponent part */
+  buf = (char *) (*__gmp_allocate_func) (buf_size);
+
+  /* for most inputs, the shortest string has hi or hi-1 digits: try
+     hi-1 first, before bisecting */
+  mid = hi - 1;
+  while (lo < hi)
+    {
+      t = mpfr_get_str (NULL, &et, b, mid, ax, MPFR_RNDN);
+      if (!shortest_roundtrip (y, ax, buf, t, mid, et, b)
+          && pow2x && mpfr_less_p (y, ax))
+        {
+          /* try the string just above x */
+          mpfr_free_str (t);
+          t = mpfr_get_str (NULL, &et, b, mid, ax, MPFR_RNDU);
+          shortest_roundtrip (y, ax, buf, t, mid, et, b);
+        }
+      if (mpfr_equal_p (y, ax))
+        {
+          mpfr_free_str (best);
+          best = t;
+          best_e = et;
+          hi = mid;
         }
       else
         {
-          mp_limb_t *x1;
+          mpfr_free_str (t);
+          lo = mid + 1;
+        }
+      mid = lo + (hi - lo) / 2;
+    }
 
-          /* a2*2^exp_a =  b^e */
-          err = mpfr_mpn_exp (a, &exp_a, b, exp, n);
-          exact = (err == -1);
+  (*__gmp_free_func) (buf, buf_size);
+  mpfr_clear (y);
+  __gmpfr_flags = saved_flags;
 
-          /* allocate memory for x1, result and reste */
-          x1 = MPFR_TMP_LIMBS_ALLOC (2 * n);
-          result = MPFR_TMP_LIMBS_ALLOC (n + 1);
-          reste = MPFR_TMP_LIMBS_ALLOC (n);
+ copy:
+  /* remove trailing zeros */
+  for (l = hi; l > 1 && best[l - 1] == '0'; l--)
+    ;
+  if (s == NULL)
+    s = (char *) (*__gmp_allocate_func) (neg + l + 1);
+  if (neg)
+    s[0] = '-';
+  memcpy (s + neg, best, l);
+  s[neg + l] = '\0';
+  *e = best_e;
+  if (best != d)
+    mpfr_free_str (best);
+
+  return s;
+}
 
-          /* initialize x1 = x */
-          MPN_COPY2 (x1, 2 * n, xp, nx);
-          if ((exact) && (nx > 2 * n) &&
-              (mpn_scan1 (xp, 0) < (nx - 2 * n) * GMP_NUMB_BITS))
-            exact = 0;
+/* Number of entries of the table of mpfr_get_str_array associating the
+   exponents of the input numbers with the corresponding exponents in the
+   output base (g in get_str_ziv). */
+#ifndef MPFR_GET_STR_ARRAY_MEMO
+# define MPFR_GET_STR_ARRAY_MEMO 64
+#endif
+
+/* Batch version of mpfr_get_str: write the strings of tab[0], ...,
+   tab[n-1] (with m digits in base b, m = 0 meaning the number of digits
+   needed to read them back, like in mpfr_get_str), each one followed by a
+   null character, one after the other in buf. The string of tab[i] starts
+   at buf + offsets[i], and its exponent is written in e[i].
+   If buf is NULL, nothing is written, and only the needed size is returned.
+   Return the total size of the strings, including the null characters,
+   or 0 if the base is invalid.
+
+   The cost of a single conversion being dominated by the setup for small
+   m, this setup is shared: the exponent range is extended once, the
+   number of digits is computed once per precision, the exponent in base
+   b once per exponent of the input (up to the size of the table), and
+   the powers of b are in the cache of mpfr_mpn_exp. */
+size_t
+mpfr_get_str_array (char *buf, size_t *offsets, mpfr_exp_t *e, int b,
+                    size_t m, mpfr_ptr *const tab, unsigned long n,
+                    mpfr_rnd_t rnd)
+{
+  struct {
+    mpfr_exp_t ex, g;
+  } memo[MPFR_GET_STR_ARRAY_MEMO];
+  mpfr_prec_t last_prec = 0;
+  size_t last_m = 0, pm_m = 0, mi, pos = 0;
+  mpfr_exp_t pm = 0;
+  unsigned long i;
+  MPFR_SAVE_EXPO_DECL (expo);
 
-          /* result = x / a */
-          mpn_tdiv_qr (result, reste, 0, x1, 2 * n, a, n);
-          exp_a = MPFR_GET_EXP (x) - exp_a - 2 * n * GMP_NUMB_BITS;
+  if (b < 2 || b > 62)
+    return 0;
 
-          /* test if division was exact */
-          if (exact)
-            exact = mpn_popcount (reste, n) == 0;
+  for (i = 0; i < MPFR_GET_STR_ARRAY_MEMO; i++)
+    memo[i].ex = MPFR_EXP_INVALID;
 
-          /* normalize the result and copy into a */
-          if (result[n] == 1)
+  MPFR_SAVE_EXPO_MARK (expo);
+  for (i = 0; i < n; i++)
+    {
+      mpfr_srcptr x = tab[i];
+      int neg = MPFR_IS_NEG (x);
+      char *s;
+
+      if (MPFR_UNLIKELY (MPFR_IS_NAN (x)))
+        {
+          if (buf != NULL)
             {
-              mpn_rshift (a, result, n, 1);
-              a[n - 1] |= MPFR_LIMB_HIGHBIT;;
-              exp_a ++;
+              offsets[i] = pos;
+              strcpy (buf + pos, "@NaN@");
             }
-          else
-            MPN_COPY (a, result, n);
-
-          err = (err == -1) ? 2 : err + 2;
+          MPFR_SAVE_EXPO_UPDATE_FLAGS (expo, MPFR_FLAGS_NAN);
+          pos += 6;
+          continue;
+        }
+      if (MPFR_UNLIKELY (MPFR_IS_INF (x)))
+        {
+          if (buf != NULL)
+            {
+              offsets[i] = pos;
+              strcpy (buf + pos, neg ? "-@Inf@" : "@Inf@");
+            }
+          pos += neg + 6;
+          continue;
         }
 
-      /* check if rounding is possible */
-      if (exact)
-        err = -1;
-
-      ret = mpfr_get_str_aux (s, e, a, n, exp_a, err, b, m, rnd);
-
-      MPFR_TMP_FREE (marker);
+      if (m != 0)
+        mi = m;
+      else
+        {
+          if (MPFR_PREC (x) != last_prec)
+            {
+              last_prec = MPFR_PREC (x);
+              last_m = get_str_ndigits (last_prec, b);
+            }
+          mi = last_m;
+        }
 
-      if (ret == MPFR_ROUND_FAILED)
+      if (buf == NULL)
         {
-          /* too large error: increment the working precision */
-          MPFR_ZIV_NEXT (loop, prec);
+          pos += neg + mi + 1;
+          continue;
         }
-      else if (ret == - MPFR_ROUND_FAILED)
+      offsets[i] = pos;
+      s = buf + pos;
+      pos += neg + mi + 1;
+
+      if (IS_POW2 (b) || MPFR_IS_ZERO (x))
+        mpfr_get_str (s, e + i, b, mi, x, rnd);
+      else
         {
-          /* too many digits in mantissa: exp = |m-g| */
-          if ((mpfr_exp_t) m > g) /* exp = m - g, multiply by b^exp */
+          mpfr_exp_t ex = MPFR_GET_EXP (x);
+          int k = (mpfr_uexp_t) ex % MPFR_GET_STR_ARRAY_MEMO;
+
+          if (memo[k].ex != ex)
             {
-              g ++;
-              exp --;
+              memo[k].ex = ex;
+              memo[k].g = mpfr_ceil_mul (ex - 1, b, 1);
             }
-          else /* exp = g - m, divide by b^exp */
+          if (mi != pm_m)
             {
-              g ++;
-              exp ++;
+              pm_m = mi;
+              pm = mpfr_ceil_mul (mi, b, 0);
             }
+          if (neg)
+            *s++ = '-';
+          get_str_ziv (s, e + i, b, mi, x, neg ? MPFR_INVERT_RND (rnd) : rnd,
+                       memo[k].g, pm);
         }
-      else
-        break;
     }
-  MPFR_ZIV_FREE (loop);
-
-  *e += g;
-
-  MPFR_LOG_MSG (("e=%" MPFR_EXP_FSPEC "d\n", (mpfr_eexp_t) *e));
-
   MPFR_SAVE_EXPO_FREE (expo);
-  return s0;
+  return pos;
 }
 
 void mpfr_free_str (char *str)
@@ -59,8 +59,10 @@ mpfr_get_z_2exp (mpz_ptr z, mpfr_srcptr f)
      probably be handled like infinities. */
   MPFR_ASSERTN (fn <= INT_MAX);  /* due to SIZ(z) being an int */
 
-  /* check whether allocated space for z is enough */
-  mpz_realloc2 (z, (mp_bitcnt_t) fn * GMP_NUMB_BITS);
+  /* check whether allocated space for z is enough (do not shrink it, as
+     z may be a temporary from the mpz_t pool) */
+  if (ALLOC (z) < fn)
+    mpz_realloc2 (z, (mp_bitcnt_t) fn * GMP_NUMB_BITS);
 
   MPFR_UNSIGNED_MINUS_MODULO (sh, MPFR_PREC (f));
   if (MPFR_LIKELY (sh))
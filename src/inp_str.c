@@ -28,21 +28,434 @@ http://www.gnu.org/licenses/ or write to the Free Software Foundation, Inc.,
 /* The original version of this function came from GMP's mpf/inp_str.c;
    it has been adapted for MPFR. */
 
+/* The word read from the stream is stored in a string, which is then
+   parsed by mpfr_set_str. So that huge numbers can be read in bounded
+   memory, this string is compressed while it is read:
+   - only the first leading zero of the integer part and of the fractional
+     part of the significand is stored, the following ones being taken
+     into account in the exponent;
+   - at most max_digits significant digits are stored: the characters of
+     the significand that follow form the tail of the word; the digits of
+     the integer part in the tail are taken into account in the exponent,
+     and if some digits of the tail are non-zero, a sticky digit 1 is
+     stored after the last stored digit.
+   Thus the string represents the number that was read when no non-zero
+   digit was dropped, and otherwise a number between the truncated number
+   and the truncated number plus one unit in the last stored digit.
+   Whether this is enough to round correctly depends on the exponent, which
+   is read after the tail. When it is not, more digits of the tail are
+   stored: they are read again from the stream if it is seekable, and
+   otherwise from a temporary file to which the tail has been copied. */
+struct inp_token {
+  char  *str;        /* compressed word, null-terminated */
+  size_t size;       /* length of str */
+  size_t alloc;      /* allocation size of str */
+  size_t mant;       /* start of the digits of the significand in str */
+  size_t mant_end;   /* end of the stored digits (before the sticky digit) */
+  size_t exp;        /* start of the exponent part in str */
+  int    base;       /* base of the significand (0 is replaced) */
+  int    sticky;     /* non-zero iff a non-zero digit was not stored */
+  int    point_stored;/* non-zero iff the point is stored in str */
+  size_t nsig;       /* number of significant digits stored */
+  size_t max_digits; /* maximum value of nsig */
+  long   shift;      /* exponent (in base) due to the leading zeros */
+  int    marker;     /* exponent marker, 0 if none */
+  long   e;          /* value of the exponent, saturated like strtol */
+  int    bad;        /* non-zero iff the word has an invalid exponent part */
+  FILE  *spill;      /* temporary file with the tail, or NULL */
+  FILE  *stream;     /* stream the tail is read again from */
+  long   tail_pos;   /* position of the 2nd character of the tail in it */
+  int    tail_first; /* first character of the tail */
+  int    tail_error; /* non-zero iff the tail could not be written */
+  size_t tail_len;   /* number of characters of the tail */
+  size_t tail_int;   /* number of digits of the integer part in the tail */
+  size_t tail_nz;    /* 1 + index of the last non-zero digit of the tail */
+  size_t tail_done;  /* number of characters of the tail stored in str */
+};
+
+static void
+token_add (struct inp_token *t, int c)
+{
+  /* keep room for the terminating null character */
+  if (t->size + 1 >= t->alloc)
+    {
+      size_t old_alloc = t->alloc;
+      t->alloc = t->alloc * 3 / 2;
+      t->str = (char *) (*__gmp_reallocate_func) (t->str, old_alloc,
+                                                  t->alloc);
+    }
+  t->str[t->size++] = (char) c;
+  t->str[t->size] = '\0';
+}
+
+/* Same convention as in strtofr.c. */
+static int
+digit_value_in_base (int c, int base)
+{
+  int digit;
+
+  MPFR_ASSERTD (base > 0 && base <= 62);
+
+  if (c >= '0' && c <= '9')
+    digit = c - '0';
+  else if (c >= 'a' && c <= 'z')
+    digit = (base >= 37) ? c - 'a' + 36 : c - 'a' + 10;
+  else if (c >= 'A' && c <= 'Z')
+    digit = c - 'A' + 10;
+  else
+    return -1;
+
+  return MPFR_LIKELY (digit < base) ? digit : -1;
+}
+
+/* Inverse of digit_value_in_base. */
+static int
+digit_in_base (int digit, int base)
+{
+  if (digit < 10)
+    return '0' + digit;
+  else if (base <= 36 || digit < 36)
+    return (base <= 36 ? 'a' : 'A') + digit - 10;
+  else
+    return 'a' + digit - 36;
+}
+
+/* Return a + b, saturated like strtol. */
+static long
+add_long (long a, long b)
+{
+  if (b > 0 && a > LONG_MAX - b)
+    return LONG_MAX;
+  if (b < 0 && a < LONG_MIN - b)
+    return LONG_MIN;
+  return a + b;
+}
+
+/* Append the character c of the significand, of digit value d (-1 for the
+   point), to the tail of t, the point having been read iff point is
+   non-zero. Return 0 if the tail cannot be kept, in which case all the
+   digits must be stored. */
+static int
+token_tail (struct inp_token *t, int c, int d, int point)
+{
+  if (t->tail_len == 0)
+    {
+      t->tail_first = c;
+      t->tail_pos = ftell (t->stream);
+      if (t->tail_pos < 0)
+        {
+          /* not seekable: the tail is copied to a temporary file */
+          t->spill = tmpfile ();
+          if (t->spill == NULL)
+            {
+              t->max_digits = (size_t) -1;
+              return 0;
+            }
+          t->tail_pos = 0;
+        }
+    }
+  else if (t->spill != NULL && putc (c, t->spill) == EOF)
+    t->tail_error = 1;
+  t->tail_len++;
+  if (d >= 0 && ! point)
+    t->tail_int++;
+  if (d > 0)
+    t->tail_nz = t->tail_len;
+  return 1;
+}
+
+/* Rewrite the end of t after the stored digits: the sticky digit and the
+   exponent, taking into account the digits of the tail not stored. */
+static void
+token_finish (struct inp_token *t)
+{
+  char buf[4 + 3 * sizeof (long)];
+  size_t i;
+  long shift, e;
+
+  t->size = t->mant_end;
+  t->str[t->size] = '\0';
+  t->sticky = t->tail_nz > t->tail_done;
+  if (t->sticky)
+    {
+      if (! t->point_stored)
+        token_add (t, '.');
+      token_add (t, '1');
+    }
+  t->exp = t->size;
+
+  i = t->tail_int > t->tail_done ? t->tail_int - t->tail_done : 0;
+  shift = add_long (t->shift, i > LONG_MAX ? LONG_MAX : (long) i);
+  buf[0] = '\0';
+  if (t->marker != 0)
+    {
+      /* a binary exponent is scaled by log2(base) */
+      e = t->e;
+      i = (t->marker == 'p' || t->marker == 'P') && t->base == 16 ? 4 : 1;
+      for (; i > 0; i--)
+        e = add_long (e, shift);
+      sprintf (buf, "%c%ld", t->marker, e);
+    }
+  else if (shift != 0)
+    sprintf (buf, "@%ld", shift);
+  for (i = 0; buf[i] != '\0'; i++)
+    token_add (t, buf[i]);
+}
+
+/* Read the word starting with the character c (already read) from stream
+   into t (see above). Set *last to the character following the word, which
+   is read but not pushed back, and return the number of characters of the
+   word. */
+static size_t
+read_token (struct inp_token *t, FILE *stream, int c, int base, int *last)
+{
+  size_t n, rest;
+  int point, zero_stored, fzero_stored;
+  int decimal_point, d, neg, digit, empty;
+
+  decimal_point = (unsigned char) MPFR_DECIMAL_POINT;
+  t->size = 0;
+  t->str[0] = '\0';
+  t->stream = stream;
+  t->spill = NULL;
+  t->tail_error = 0;
+  t->tail_len = t->tail_int = t->tail_nz = t->tail_done = 0;
+  n = 0;
+
+  /* An optional sign, then an optional 0x or 0b prefix, like in
+     mpfr_strtofr. */
+  if (c == '+' || c == '-')
+    {
+      token_add (t, c);
+      n++;
+      c = getc (stream);
+    }
+  if (c == '0' && (base == 0 || base == 16 || base == 2))
+    {
+      int c2 = getc (stream);
+
+      if (((c2 == 'x' || c2 == 'X') && base != 2)
+          || ((c2 == 'b' || c2 == 'B') && base != 16))
+        {
+          token_add (t, c);
+          token_add (t, c2);
+          n += 2;
+          base = (c2 == 'x' || c2 == 'X') ? 16 : 2;
+          c = getc (stream);
+        }
+      else
+        ungetc (c2, stream); /* c is a digit of the significand */
+    }
+  if (base == 0)
+    base = 10;
+  t->base = base;
+
+  /* The significand. */
+  t->mant = t->size;
+  t->nsig = 0;
+  t->shift = 0;
+  t->point_stored = point = zero_stored = fzero_stored = 0;
+  for (;;)
+    {
+      if (c == '.' || c == decimal_point)
+        {
+          if (point)
+            break;
+          point = 1;
+          if (t->tail_len == 0)
+            {
+              token_add (t, c);
+              t->point_stored = 1;
+            }
+          else
+            token_tail (t, c, -1, 0);
+        }
+      else if ((d = digit_value_in_base (c, base)) < 0)
+        break;
+      else if (t->nsig == 0 && d == 0)
+        {
+          if (! point && ! zero_stored)
+            {
+              token_add (t, c);
+              zero_stored = 1;
+            }
+          else if (point && ! fzero_stored)
+            {
+              token_add (t, c);
+              fzero_stored = 1;
+            }
+          else if (point)
+            t->shift = add_long (t->shift, -1);
+        }
+      else if (t->nsig < t->max_digits || ! token_tail (t, c, d, point))
+        {
+          token_add (t, c);
+          t->nsig++;
+        }
+      n++;
+      c = getc (stream);
+    }
+  t->mant_end = t->size;
+
+  /* The rest of the word, which must be empty or an exponent for the
+     word to be valid. The exponent is read like strtol does. */
+  t->marker = c;
+  t->bad = ! (c == '@' || ((c == 'e' || c == 'E') && base <= 10)
+              || ((c == 'p' || c == 'P') && (base == 2 || base == 16)));
+  neg = digit = 0;
+  empty = t->mant_end == t->mant;
+  t->e = 0;
+  for (rest = 0; c != EOF && ! isspace (c); rest++)
+    {
+      digit = rest >= 1 && c >= '0' && c <= '9';
+      if (rest == 1 && (c == '+' || c == '-'))
+        neg = c == '-';
+      else if (digit)
+        {
+          d = c - '0';
+          if (neg)
+            t->e = t->e < (LONG_MIN + d) / 10 ? LONG_MIN : t->e * 10 - d;
+          else
+            t->e = t->e > (LONG_MAX - d) / 10 ? LONG_MAX : t->e * 10 + d;
+        }
+      else if (rest >= 1)
+        t->bad = 1;
+      /* a word without a significand is stored entirely, as it can be a
+         special value such as @nan@ */
+      if (empty)
+        token_add (t, c);
+      n++;
+      c = getc (stream);
+    }
+  if (rest == 0 || empty)
+    t->bad = 0;
+  else if (! digit)
+    t->bad = 1;
+  if (rest == 0 || empty || t->bad)
+    t->marker = 0;
+  t->mant_end = t->size;
+  *last = c;
+
+  token_finish (t);
+  return n;
+}
+
+/* Store more digits of the tail of t, up to t->max_digits significant
+   digits. Return 0 if the tail cannot be read again. */
+static int
+token_extend (struct inp_token *t)
+{
+  FILE *f;
+  int c;
+
+  f = t->spill != NULL ? t->spill : t->stream;
+  if (t->tail_error || t->tail_pos < 0
+      || fseek (f, t->tail_pos, SEEK_SET) != 0)
+    return 0;
+  t->size = t->mant_end;
+  while (t->tail_done < t->tail_len && t->nsig < t->max_digits)
+    {
+      c = t->tail_done == 0 ? t->tail_first : getc (f);
+      if (c == EOF)
+        return 0;
+      t->tail_done++;
+      if (c == '.' || c == (unsigned char) MPFR_DECIMAL_POINT)
+        {
+          /* all the integer digits are now stored */
+          token_add (t, c);
+          t->point_stored = 1;
+        }
+      else
+        {
+          token_add (t, c);
+          t->nsig++;
+        }
+    }
+  t->tail_pos = ftell (f);
+  t->mant_end = t->size;
+  token_finish (t);
+  return 1;
+}
+
+/* Return non-zero if the rounding of the number read in t (which has a
+   sticky digit) to prec bits is decided, i.e., if there is no number of
+   prec + 1 bits (which includes the rounding boundaries of all the
+   rounding modes) strictly between the truncated number D and D + u,
+   u being one unit in the last stored digit. */
+static int
+token_decided (struct inp_token *t, mpfr_prec_t prec)
+{
+  char *lo, *hi;
+  size_t start, pre, len, exp_len, i;
+  mpfr_t x, y;
+  int decimal_point, d, decided;
+  MPFR_SAVE_EXPO_DECL (expo);
+  MPFR_TMP_DECL (marker);
+
+  if (prec >= MPFR_PREC_MAX)
+    return 0;
+
+  decimal_point = (unsigned char) MPFR_DECIMAL_POINT;
+  /* the sign is ignored, the prefix is kept */
+  start = t->str[0] == '+' || t->str[0] == '-';
+  pre = t->mant - start;
+  len = t->mant_end - t->mant;
+  exp_len = t->size - t->exp;
+
+  MPFR_TMP_MARK (marker);
+  lo = (char *) MPFR_TMP_ALLOC (pre + len + exp_len + 1);
+  hi = (char *) MPFR_TMP_ALLOC (pre + len + exp_len + 2);
+  /* lo = D */
+  memcpy (lo, t->str + start, pre + len);
+  memcpy (lo + pre + len, t->str + t->exp, exp_len + 1);
+  /* hi = D + u, with a leading zero for the carry */
+  memcpy (hi, t->str + start, pre);
+  hi[pre] = '0';
+  memcpy (hi + pre + 1, t->str + t->mant, len);
+  memcpy (hi + pre + 1 + len, t->str + t->exp, exp_len + 1);
+  for (i = pre + len; ; i--)
+    {
+      if (hi[i] == '.' || hi[i] == decimal_point)
+        continue;
+      d = digit_value_in_base ((unsigned char) hi[i], t->base) + 1;
+      if (d < t->base)
+        {
+          hi[i] = (char) digit_in_base (d, t->base);
+          break;
+        }
+      hi[i] = '0';
+    }
+
+  MPFR_SAVE_EXPO_MARK (expo);
+  mpfr_init2 (x, prec + 1);
+  mpfr_init2 (y, prec + 1);
+  mpfr_strtofr (x, lo, NULL, t->base, MPFR_RNDD);
+  if (mpfr_strtofr (y, hi, NULL, t->base, MPFR_RNDD) == 0)
+    mpfr_nextbelow (y);
+  decided = mpfr_equal_p (x, y);
+  mpfr_clear (x);
+  mpfr_clear (y);
+  MPFR_SAVE_EXPO_FREE (expo);
+  MPFR_TMP_FREE (marker);
+
+  return decided;
+}
+
 size_t
 mpfr_inp_str (mpfr_ptr rop, FILE *stream, int base, mpfr_rnd_t rnd_mode)
 {
-  unsigned char *str;
-  size_t alloc_size, str_size;
-  int c;
+  struct inp_token t;
+  size_t token_size;
+  long end;
+  int c, ok;
   int retval;
   size_t nread;
 
   if (stream == NULL)
     stream = stdin;
 
-  alloc_size = 100;
-  str = (unsigned char *) (*__gmp_allocate_func) (alloc_size);
-  str_size = 0;
+  t.alloc = 100;
+  t.str = (char *) (*__gmp_allocate_func) (t.alloc);
   nread = 0;
 
   /* Skip whitespace.  */
@@ -55,35 +468,36 @@ mpfr_inp_str (mpfr_ptr rop, FILE *stream, int base, mpfr_rnd_t rnd_mode)
 
   /* number of characters read is nread */
 
-  for (;;)
+  /* Only the significant digits needed for the precision of rop, plus a
+     large margin, are stored. In the rare cases where this is not enough
+     to decide the rounding, twice as many digits are stored, and so on. */
+  t.max_digits = (size_t) MPFR_PREC (rop) + 1024;
+  token_size = read_token (&t, stream, c, base, &c);
+  ok = 1;
+  if (t.sticky && ! token_decided (&t, MPFR_PREC (rop)))
     {
-      if (str_size >= alloc_size)
+      end = t.spill != NULL ? 0 : ftell (stream);
+      do
         {
-          size_t old_alloc_size = alloc_size;
-          alloc_size = alloc_size * 3 / 2;
-          str = (unsigned char *)
-            (*__gmp_reallocate_func) (str, old_alloc_size, alloc_size);
+          t.max_digits = t.max_digits <= (size_t) -1 / 2 ?
+            2 * t.max_digits : (size_t) -1;
+          ok = end >= 0 && token_extend (&t);
         }
-      if (c == EOF || isspace (c))
-        break;
-      str[str_size++] = (unsigned char) c;
-      c = getc (stream);
+      while (ok && t.sticky && ! token_decided (&t, MPFR_PREC (rop)));
+      if (t.spill == NULL && end >= 0 && fseek (stream, end, SEEK_SET) != 0)
+        ok = 0;
     }
+  if (t.spill != NULL)
+    fclose (t.spill);
   ungetc (c, stream);
 
-  /* number of characters read is nread + str_size - 1 */
-
-  /* we can exit the for loop only by the break instruction,
-     then necessarily str_size >= alloc_size was checked, so
-     now str_size < alloc_size */
-
-  str[str_size] = '\0';
+  /* number of characters read is nread + token_size - 1 */
 
-  retval = mpfr_set_str (rop, (char *) str, base, rnd_mode);
-  (*__gmp_free_func) (str, alloc_size);
+  retval = ok ? mpfr_set_str (rop, t.str, base, rnd_mode) : -1;
+  (*__gmp_free_func) (t.str, t.alloc);
 
-  if (retval == -1)
+  if (retval == -1 || t.bad)
     return 0;                   /* error */
 
- return str_size + nread - 1;
+  return token_size + nread - 1;
 }
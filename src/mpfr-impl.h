@@ -1078,6 +1078,11 @@ typedef union { mp_size_t s; mp_limb_t l; } mpfr_size_limb_t;
   (MPFR_MANT(x) = (mp_limb_t *) ((mpfr_size_limb_t *) (p) + 1))
 #define MPFR_GET_REAL_PTR(x) \
   ((mp_limb_t *) ((mpfr_size_limb_t *) MPFR_MANT(x) - 1))
+/* The significand of a number initialized by mpfr_init2_arena belongs to
+   the arena, which is marked by a negative allocation size: mpfr_clear
+   does not free it, and mpfr_set_prec and mpfr_prec_round move it to the
+   heap when they need more limbs. */
+#define MPFR_IS_ARENA_ALLOC(x) (MPFR_GET_ALLOC_SIZE(x) < 0)
 
 /* Temporary memory handling */
 #ifndef TMP_SALLOC
@@ -1919,9 +1924,19 @@ __MPFR_DECLSPEC extern mpfr_prec_t mpfr_log_prec;
 # define MPFR_GROUP_STATIC_SIZE 16
 #endif
 
+/* Above MPFR_GROUP_STATIC_SIZE limbs, the significands are allocated in
+   the per-thread scratch stack (see src/scratch.c), which is kept from one
+   call to another; the groups must thus be cleared in the reverse order
+   of their first allocation. */
+typedef struct {
+  void  *chunk;
+  size_t used;
+} mpfr_scratch_mark_t;
+
 struct mpfr_group_t {
   size_t     alloc;
   mp_limb_t *mant;
+  mpfr_scratch_mark_t mark;
   mp_limb_t  tab[MPFR_GROUP_STATIC_SIZE];
 };
 
@@ -1932,7 +1947,7 @@ struct mpfr_group_t {
                 (unsigned long) (g).alloc));                     \
  if ((g).alloc != 0) {                                           \
    MPFR_ASSERTD ((g).mant != (g).tab);                           \
-   (*__gmp_free_func) ((g).mant, (g).alloc);                     \
+   mpfr_scratch_release (&(g).mark);                             \
  }} while (0)
 
 #define MPFR_GROUP_INIT_TEMPLATE(g, prec, num, handler) do {            \
@@ -1945,7 +1960,8 @@ struct mpfr_group_t {
  if (_size * (num) > MPFR_GROUP_STATIC_SIZE)                            \
    {                                                                    \
      (g).alloc = (num) * _size * sizeof (mp_limb_t);                    \
-     (g).mant = (mp_limb_t *) (*__gmp_allocate_func) ((g).alloc);       \
+     mpfr_scratch_mark (&(g).mark);                                     \
+     (g).mant = mpfr_scratch_alloc ((num) * _size);                     \
    }                                                                    \
  else                                                                   \
    {                                                                    \
@@ -1994,11 +2010,10 @@ struct mpfr_group_t {
    mpfr_abort_prec_max ();                                              \
  _size = MPFR_PREC2LIMBS (_prec);                                       \
  (g).alloc = (num) * _size * sizeof (mp_limb_t);                        \
- if (_oalloc == 0)                                                      \
-   (g).mant = (mp_limb_t *) (*__gmp_allocate_func) ((g).alloc);         \
- else                                                                   \
-   (g).mant = (mp_limb_t *)                                             \
-     (*__gmp_reallocate_func) ((g).mant, _oalloc, (g).alloc);           \
+ if (_oalloc != 0)                                                      \
+   mpfr_scratch_release (&(g).mark);                                    \
+ mpfr_scratch_mark (&(g).mark);                                         \
+ (g).mant = mpfr_scratch_alloc ((num) * _size);                         \
  MPFR_LOG_MSG (("GROUP_REPREC: newptr = 0x%lX, newsize = %lu\n",        \
                 (unsigned long) (g).mant, (unsigned long) (g).alloc));  \
  handler;                                                               \
@@ -2081,6 +2096,20 @@ __MPFR_DECLSPEC long mpfr_mpn_exp (mp_limb_t *, mpfr_exp_t *, int,
 #ifdef _MPFR_H_HAVE_FILE
 __MPFR_DECLSPEC void mpfr_fprint_binary (FILE *, mpfr_srcptr);
 #endif
+
+#ifdef _MPFR_H_HAVE_VA_LIST
+__MPFR_DECLSPEC int mpfr_vasnprintf_aux (char **, char *, size_t,
+                                         const char *, va_list);
+__MPFR_DECLSPEC int mpfr_vsnprintf_compiled_aux (char *, size_t,
+                                                 mpfr_printf_format_t,
+                                                 va_list);
+#endif
+#ifdef _MPFR_H_HAVE_VA_LIST_FILE
+__MPFR_DECLSPEC int mpfr_vfprintf_aux (FILE *, const char *, va_list);
+__MPFR_DECLSPEC int mpfr_vfprintf_compiled_aux (FILE *,
+                                                mpfr_printf_format_t,
+                                                va_list);
+#endif
 __MPFR_DECLSPEC void mpfr_print_binary (mpfr_srcptr);
 __MPFR_DECLSPEC void mpfr_print_mant_binary (const char*,
                                           const mp_limb_t*, mpfr_prec_t);
@@ -2145,6 +2174,8 @@ __MPFR_DECLSPEC void mpfr_rand_raw (mpfr_limb_ptr, gmp_randstate_t,
 __MPFR_DECLSPEC mpz_srcptr mpfr_bernoulli_cache (unsigned long);
 __MPFR_DECLSPEC void mpfr_bernoulli_freecache (void);
 
+__MPFR_DECLSPEC void mpfr_atan_freecache (void);
+
 __MPFR_DECLSPEC int mpfr_sincos_fast (mpfr_t, mpfr_t,
                                       mpfr_srcptr, mpfr_rnd_t);
 
@@ -2156,9 +2187,18 @@ __MPFR_DECLSPEC void mpfr_div_ui2 (mpfr_ptr, mpfr_srcptr,
 
 __MPFR_DECLSPEC void mpfr_gamma_one_and_two_third (mpfr_ptr, mpfr_ptr, mpfr_prec_t);
 
+__MPFR_DECLSPEC void mpfr_scratch_mark (mpfr_scratch_mark_t *);
+__MPFR_DECLSPEC mp_limb_t *mpfr_scratch_alloc (size_t);
+__MPFR_DECLSPEC void mpfr_scratch_release (mpfr_scratch_mark_t *);
+__MPFR_DECLSPEC void mpfr_scratch_free (void);
+
 __MPFR_DECLSPEC void mpfr_mpz_init (mpz_ptr);
+__MPFR_DECLSPEC void mpfr_mpz_init2 (mpz_ptr, mp_bitcnt_t);
 __MPFR_DECLSPEC void mpfr_mpz_clear (mpz_ptr);
 
+__MPFR_DECLSPEC mpfr_limb_ptr mpfr_significand_alloc (mp_size_t);
+__MPFR_DECLSPEC void mpfr_significand_free (mpfr_limb_ptr, mp_size_t);
+
 #if defined (__cplusplus)
 }
 #endif
@@ -2183,6 +2223,8 @@ __MPFR_DECLSPEC void mpfr_mpz_clear (mpz_ptr);
 # undef mpz_clear
 # define mpz_init mpfr_mpz_init
 # define mpz_clear mpfr_mpz_clear
+# undef mpz_init2
+# define mpz_init2 mpfr_mpz_init2
 # undef mpz_init_set_ui
 # define mpz_init_set_ui(a,b) do { mpz_init (a); mpz_set_ui (a, b); } while (0)
 # undef mpz_init_set
@@ -2190,6 +2232,35 @@ __MPFR_DECLSPEC void mpfr_mpz_clear (mpz_ptr);
 #endif
 
 
+/******************************************************
+ ************  Internal significand caching  **********
+ ******************************************************/
+
+/* The significands of at most MPFR_MY_SIGNIFICAND_LIMBS limbs freed by
+   mpfr_clear are kept in a per-thread cache (MPFR_MY_SIGNIFICAND_DEPTH
+   blocks for each size), from which mpfr_init2 and mpfr_set_prec take
+   them back (see src/free_cache.c). Define MPFR_MY_SIGNIFICAND_LIMBS
+   to 0 to disable this cache. */
+#ifndef MPFR_MY_SIGNIFICAND_LIMBS
+# define MPFR_MY_SIGNIFICAND_LIMBS 16
+#endif
+#ifndef MPFR_MY_SIGNIFICAND_DEPTH
+# define MPFR_MY_SIGNIFICAND_DEPTH 8
+#endif
+
+/* Allocate or free the block of a heap significand of n limbs (including
+   the mpfr_size_limb_t header, see MPFR_MALLOC_SIZE) */
+#if MPFR_MY_SIGNIFICAND_LIMBS != 0
+# define MPFR_SIGNIFICAND_ALLOC(n) mpfr_significand_alloc (n)
+# define MPFR_SIGNIFICAND_FREE(p,n) mpfr_significand_free (p, n)
+#else
+# define MPFR_SIGNIFICAND_ALLOC(n) \
+  ((mpfr_limb_ptr) (*__gmp_allocate_func) (MPFR_MALLOC_SIZE (n)))
+# define MPFR_SIGNIFICAND_FREE(p,n) \
+  ((*__gmp_free_func) (p, MPFR_MALLOC_SIZE (n)))
+#endif
+
+
 /******************************************************
  ********  Compute LOG2(LOG2(MPFR_PREC_MAX))  *********
  ******************************************************/
@@ -253,6 +253,51 @@ typedef enum {
   MPFR_FREE_GLOBAL_CACHE = 2
 } mpfr_free_cache_t;
 
+/* Statistics of the internal pool of mpz_t (mpfr_mpz_pool_get_stats) */
+typedef struct {
+  unsigned long hits, misses, reallocs;
+} mpfr_mpz_pool_stats_t;
+
+/* Base prepared for repeated powers (mpfr_pow_prepared) */
+typedef struct {
+  __mpfr_struct _mpfr_x;     /* the base x */
+  __mpfr_struct _mpfr_log2;  /* lower bound on |log2|x|| (53 bits) */
+  __mpfr_struct _mpfr_logs;  /* upper bound on |log|x|| (16 bits) */
+  __mpfr_struct _mpfr_logd;  /* log|x| rounded toward -inf */
+  __mpfr_struct _mpfr_logu;  /* log|x| rounded toward +inf */
+} __mpfr_pow_prepared_struct;
+
+typedef __mpfr_pow_prepared_struct mpfr_pow_prepared_t[1];
+typedef __mpfr_pow_prepared_struct *mpfr_pow_prepared_ptr;
+
+/* Format string compiled for repeated use (mpfr_printf_compile) */
+typedef struct __mpfr_printf_format *mpfr_printf_format_t;
+
+/* Arena of significands (mpfr_init2_arena) */
+typedef struct {
+  mpfr_void   *_mpfr_chunk;  /* last chunk, NULL if none */
+  mpfr_size_t  _mpfr_used;   /* number of bytes used in the last chunk */
+  mpfr_size_t  _mpfr_size;   /* size of the last chunk */
+} __mpfr_arena_struct;
+
+typedef __mpfr_arena_struct mpfr_arena_t[1];
+typedef __mpfr_arena_struct *mpfr_arena_ptr;
+
+/* Number with its significand stored in the variable itself, for a
+   precision up to MPFR_SMALL_PREC_MAX (mpfr_small_init2). The allocation
+   size before the limbs has the layout of the one used by mpfr_init2. */
+#define MPFR_SMALL_LIMBS 4
+#define MPFR_SMALL_PREC_MAX ((mpfr_prec_t) MPFR_SMALL_LIMBS * GMP_NUMB_BITS)
+
+typedef struct {
+  __mpfr_struct _mpfr_x;
+  union { mp_size_t _mpfr_s; mp_limb_t _mpfr_l; } _mpfr_alloc;
+  mp_limb_t _mpfr_d[MPFR_SMALL_LIMBS];
+} __mpfr_small_struct;
+
+typedef __mpfr_small_struct mpfr_small_t[1];
+typedef __mpfr_small_struct *mpfr_small_ptr;
+
 /* GMP defines:
     + size_t:                Standard size_t
     + __GMP_NOTHROW          For C++: can't throw .
@@ -385,6 +430,16 @@ __MPFR_DECLSPEC void mpfr_init2 (mpfr_ptr, mpfr_prec_t);
 __MPFR_DECLSPEC void mpfr_init (mpfr_ptr);
 __MPFR_DECLSPEC void mpfr_clear (mpfr_ptr);
 
+__MPFR_DECLSPEC void mpfr_arena_init (mpfr_arena_ptr, size_t);
+__MPFR_DECLSPEC void mpfr_arena_reset (mpfr_arena_ptr);
+__MPFR_DECLSPEC void mpfr_arena_clear (mpfr_arena_ptr);
+__MPFR_DECLSPEC void mpfr_init2_arena (mpfr_ptr, mpfr_prec_t,
+                                       mpfr_arena_ptr);
+__MPFR_DECLSPEC void mpfr_array_init2 (mpfr_ptr, size_t, mpfr_prec_t);
+__MPFR_DECLSPEC void mpfr_array_set_prec (mpfr_ptr, size_t, mpfr_prec_t);
+__MPFR_DECLSPEC void mpfr_array_clear (mpfr_ptr, size_t);
+__MPFR_DECLSPEC mpfr_ptr mpfr_small_init2 (mpfr_small_ptr, mpfr_prec_t);
+
 __MPFR_DECLSPEC void
   mpfr_inits2 (mpfr_prec_t, mpfr_ptr, ...) __MPFR_SENTINEL_ATTR;
 __MPFR_DECLSPEC void
@@ -414,6 +469,9 @@ __MPFR_DECLSPEC int mpfr_set_flt (mpfr_ptr, float, mpfr_rnd_t);
    cf https://gcc.gnu.org/bugzilla/show_bug.cgi?id=51364 */
 __MPFR_DECLSPEC int mpfr_set_decimal64 (mpfr_ptr, _Decimal64,
                                         mpfr_rnd_t);
+__MPFR_DECLSPEC int mpfr_set_decimal64_array (mpfr_ptr *const,
+                                              const _Decimal64 *,
+                                              unsigned long, mpfr_rnd_t);
 #endif
 __MPFR_DECLSPEC int
   mpfr_set_ld (mpfr_ptr, long double, mpfr_rnd_t);
@@ -484,6 +542,9 @@ __MPFR_DECLSPEC double mpfr_get_d (mpfr_srcptr, mpfr_rnd_t);
 #ifdef MPFR_WANT_DECIMAL_FLOATS
 __MPFR_DECLSPEC _Decimal64 mpfr_get_decimal64 (mpfr_srcptr,
                                                mpfr_rnd_t);
+__MPFR_DECLSPEC void mpfr_get_decimal64_array (_Decimal64 *,
+                                               mpfr_ptr *const,
+                                               unsigned long, mpfr_rnd_t);
 #endif
 __MPFR_DECLSPEC long double mpfr_get_ld (mpfr_srcptr,
                                          mpfr_rnd_t);
@@ -499,11 +560,29 @@ __MPFR_DECLSPEC unsigned long mpfr_get_ui (mpfr_srcptr,
                                            mpfr_rnd_t);
 __MPFR_DECLSPEC char*mpfr_get_str (char*, mpfr_exp_t*, int, size_t,
                                    mpfr_srcptr, mpfr_rnd_t);
+__MPFR_DECLSPEC char*mpfr_get_str_shortest (char*, mpfr_exp_t*, int,
+                                            mpfr_srcptr);
+__MPFR_DECLSPEC size_t mpfr_get_str_array (char*, size_t*, mpfr_exp_t*,
+                                          int, size_t, mpfr_ptr *const,
+                                          unsigned long, mpfr_rnd_t);
 __MPFR_DECLSPEC int mpfr_get_z (mpz_ptr z, mpfr_srcptr f,
                                 mpfr_rnd_t);
 
 __MPFR_DECLSPEC void mpfr_free_str (char *);
 
+__MPFR_DECLSPEC size_t mpfr_fpif_export_buffer (unsigned char*, size_t,
+                                                mpfr_srcptr);
+__MPFR_DECLSPEC size_t mpfr_fpif_import_buffer (mpfr_ptr,
+                                                const unsigned char*, size_t);
+__MPFR_DECLSPEC size_t mpfr_fpif_import_custom_buffer (mpfr_ptr,
+                                                       const unsigned char*,
+                                                       size_t);
+__MPFR_DECLSPEC size_t mpfr_fpif_export_array (unsigned char*, size_t,
+                                               mpfr_ptr *const,
+                                               unsigned long);
+__MPFR_DECLSPEC size_t mpfr_fpif_import_array (mpfr_ptr *const, unsigned long,
+                                               const unsigned char*, size_t);
+
 __MPFR_DECLSPEC int mpfr_urandom (mpfr_ptr, gmp_randstate_t,
                                   mpfr_rnd_t);
 __MPFR_DECLSPEC int mpfr_grandom (mpfr_ptr, mpfr_ptr, gmp_randstate_t,
@@ -526,6 +605,11 @@ __MPFR_DECLSPEC int mpfr_sprintf (char*, const char*,
                                   ...);
 __MPFR_DECLSPEC int mpfr_snprintf (char*, size_t,
                                    const char*, ...);
+__MPFR_DECLSPEC mpfr_printf_format_t mpfr_printf_compile (const char*);
+__MPFR_DECLSPEC void mpfr_printf_free_compiled (mpfr_printf_format_t);
+__MPFR_DECLSPEC int mpfr_printf_compiled (mpfr_printf_format_t, ...);
+__MPFR_DECLSPEC int mpfr_snprintf_compiled (char*, size_t,
+                                            mpfr_printf_format_t, ...);
 #endif
 
 __MPFR_DECLSPEC int mpfr_pow (mpfr_ptr, mpfr_srcptr,
@@ -540,6 +624,11 @@ __MPFR_DECLSPEC int mpfr_ui_pow (mpfr_ptr, unsigned long int,
                                  mpfr_srcptr, mpfr_rnd_t);
 __MPFR_DECLSPEC int mpfr_pow_z (mpfr_ptr, mpfr_srcptr,
                                 mpz_srcptr, mpfr_rnd_t);
+__MPFR_DECLSPEC void mpfr_pow_prepared_init (mpfr_pow_prepared_ptr,
+                                             mpfr_srcptr);
+__MPFR_DECLSPEC void mpfr_pow_prepared_clear (mpfr_pow_prepared_ptr);
+__MPFR_DECLSPEC int mpfr_pow_prepared (mpfr_ptr, mpfr_pow_prepared_ptr,
+                                       mpfr_srcptr, mpfr_rnd_t);
 
 __MPFR_DECLSPEC int mpfr_sqrt (mpfr_ptr, mpfr_srcptr,
                                mpfr_rnd_t);
@@ -801,6 +890,8 @@ __MPFR_DECLSPEC int mpfr_sum (mpfr_ptr, mpfr_ptr *const,
 
 __MPFR_DECLSPEC void mpfr_free_cache (void);
 __MPFR_DECLSPEC void mpfr_free_cache2 (mpfr_free_cache_t);
+__MPFR_DECLSPEC int mpfr_mpz_pool_set_depth (int);
+__MPFR_DECLSPEC void mpfr_mpz_pool_get_stats (mpfr_mpz_pool_stats_t *);
 
 __MPFR_DECLSPEC int  mpfr_subnormalize (mpfr_ptr, int,
                                         mpfr_rnd_t);
@@ -819,6 +910,16 @@ __MPFR_DECLSPEC void   mpfr_custom_move       (mpfr_ptr, void *);
 __MPFR_DECLSPEC void   mpfr_custom_init_set   (mpfr_ptr, int,
                                              mpfr_exp_t, mpfr_prec_t, void *);
 __MPFR_DECLSPEC int    mpfr_custom_get_kind   (mpfr_srcptr);
+__MPFR_DECLSPEC size_t mpfr_custom_table_size (mpfr_prec_t, unsigned long);
+__MPFR_DECLSPEC void   mpfr_custom_table_init (void *, mpfr_prec_t,
+                                               unsigned long);
+__MPFR_DECLSPEC int    mpfr_custom_table_check (const void *, size_t,
+                                                mpfr_prec_t *,
+                                                unsigned long *);
+__MPFR_DECLSPEC void   mpfr_custom_table_get  (mpfr_ptr, void *,
+                                               unsigned long);
+__MPFR_DECLSPEC int    mpfr_custom_table_set  (void *, unsigned long,
+                                               mpfr_srcptr, mpfr_rnd_t);
 
 #if defined (__cplusplus)
 }
@@ -840,6 +941,14 @@ __MPFR_DECLSPEC int    mpfr_custom_get_kind   (mpfr_srcptr);
   MPFR_EXTENSION mp_limb_t __gmpfr_local_tab_##_x[((_p)-1)/GMP_NUMB_BITS+1]; \
   MPFR_EXTENSION mpfr_t _x = {{(_p),1,__MPFR_EXP_NAN,__gmpfr_local_tab_##_x}}
 
+/* Same as MPFR_DECL_INIT, but _x is a pointer to a mpfr_small_t, which
+   supports all the functions (mpfr_set_prec, mpfr_clear...). */
+#define MPFR_DECL_SMALL(_x, _p)                                       \
+  mpfr_small_t __gmpfr_small_##_x;                                    \
+  mpfr_ptr _x = mpfr_small_init2 (__gmpfr_small_##_x, (_p))
+
+#define MPFR_SMALL_PTR(_x) (&(_x)->_mpfr_x)
+
 #if MPFR_USE_C99_FEATURE
 /* C99 & C11 version: functions with multiple inputs supported */
 #define mpfr_round_nearest_away(func, rop, ...)                         \
@@ -1156,8 +1265,10 @@ __MPFR_DECLSPEC int mpfr_fprintf (FILE*, const char*,
 #endif
 #define mpfr_fpif_export __gmpfr_fpif_export
 #define mpfr_fpif_import __gmpfr_fpif_import
+#define mpfr_fpif_import_custom __gmpfr_fpif_import_custom
 __MPFR_DECLSPEC int    mpfr_fpif_export (FILE*, mpfr_ptr);
 __MPFR_DECLSPEC int    mpfr_fpif_import (mpfr_ptr, FILE*);
+__MPFR_DECLSPEC int    mpfr_fpif_import_custom (mpfr_ptr, FILE*);
 
 #if defined (__cplusplus)
 }
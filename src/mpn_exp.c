@@ -36,8 +36,9 @@ http://www.gnu.org/licenses/ or write to the Free Software Foundation, Inc.,
    Return -2 if an overflow occurred in the computation of exp_r.
 */
 
-long
-mpfr_mpn_exp (mp_limb_t *a, mpfr_exp_t *exp_r, int b, mpfr_exp_t e, size_t n)
+static long
+mpfr_mpn_exp_aux (mp_limb_t *a, mpfr_exp_t *exp_r, int b, mpfr_exp_t e,
+                  size_t n)
 {
   mp_limb_t *c, B;
   mpfr_exp_t f, h;
@@ -174,3 +175,72 @@ mpfr_mpn_exp (mp_limb_t *a, mpfr_exp_t *exp_r, int b, mpfr_exp_t e, size_t n)
       return error;
     }
 }
+
+/* Number of entries and maximal number of limbs of the cache of the
+   results of mpfr_mpn_exp. When printing or parsing many numbers of the
+   same precision and of similar magnitudes, mpfr_get_str and mpfr_strtofr
+   call mpfr_mpn_exp many times with the same arguments.
+   Like the emin/emax bounds cache of exp.c, it uses a fixed size for the
+   limbs, so there is no dynamic allocation, and no need to free it.
+   Set MPFR_MPN_EXP_CACHE_LIMBS to 0 to disable the cache. */
+#ifndef MPFR_MPN_EXP_CACHE_SIZE
+# define MPFR_MPN_EXP_CACHE_SIZE 16
+#endif
+#ifndef MPFR_MPN_EXP_CACHE_LIMBS
+# define MPFR_MPN_EXP_CACHE_LIMBS ((512 - 1) / GMP_NUMB_BITS + 1)
+#endif
+
+#if MPFR_MPN_EXP_CACHE_LIMBS > 0
+
+typedef struct {
+  int b;                /* base, 0 for an unused entry */
+  mpfr_exp_t e;         /* exponent */
+  size_t n;             /* number of limbs */
+  mpfr_exp_t exp_r;     /* exponent of the result */
+  long err;             /* value returned by mpfr_mpn_exp_aux */
+  mp_limb_t a[MPFR_MPN_EXP_CACHE_LIMBS];
+} mpfr_mpn_exp_entry;
+
+static MPFR_THREAD_ATTR mpfr_mpn_exp_entry
+  mpn_exp_cache[MPFR_MPN_EXP_CACHE_SIZE];
+
+long
+mpfr_mpn_exp (mp_limb_t *a, mpfr_exp_t *exp_r, int b, mpfr_exp_t e, size_t n)
+{
+  mpfr_mpn_exp_entry *c;
+  long err;
+
+  if (MPFR_UNLIKELY (n > MPFR_MPN_EXP_CACHE_LIMBS))
+    return mpfr_mpn_exp_aux (a, exp_r, b, e, n);
+
+  c = mpn_exp_cache + ((mpfr_uexp_t) e * 61 + (unsigned int) b * 7 + n)
+    % MPFR_MPN_EXP_CACHE_SIZE;
+  if (c->b == b && c->e == e && c->n == n)
+    {
+      MPN_COPY (a, c->a, n);
+      *exp_r = c->exp_r;
+      return c->err;
+    }
+
+  err = mpfr_mpn_exp_aux (a, exp_r, b, e, n);
+  if (err != -2) /* in case of overflow, {a, n} and exp_r are undefined */
+    {
+      c->b = b;
+      c->e = e;
+      c->n = n;
+      c->exp_r = *exp_r;
+      c->err = err;
+      MPN_COPY (c->a, a, n);
+    }
+  return err;
+}
+
+#else
+
+long
+mpfr_mpn_exp (mp_limb_t *a, mpfr_exp_t *exp_r, int b, mpfr_exp_t e, size_t n)
+{
+  return mpfr_mpn_exp_aux (a, exp_r, b, e, n);
+}
+
+#endif
@@ -154,11 +154,50 @@ is_odd (mpfr_srcptr y)
   return 1;
 }
 
+/* Set t to log|x| rounded toward -inf if down is non-zero, toward +inf
+   otherwise, where absx = |x|. If p is not NULL, the value is taken from
+   the cache of the prepared base p, which is recomputed (with a precision
+   increase of at least 10%) when it is not accurate enough. Since both
+   roundings are done in the same direction, rounding the cached value to
+   the precision of t gives the same result as a direct call to mpfr_log. */
+static void
+mpfr_pow_log (mpfr_ptr t, mpfr_srcptr absx, int down,
+              mpfr_pow_prepared_ptr p)
+{
+  mpfr_rnd_t rnd = down ? MPFR_RNDD : MPFR_RNDU;
+  mpfr_ptr c;
+
+  if (p == NULL)
+    {
+      mpfr_log (t, absx, rnd);
+      return;
+    }
+
+  c = down ? &p->_mpfr_logd : &p->_mpfr_logu;
+  if (MPFR_PREC (c) < MPFR_PREC (t))
+    {
+      mpfr_prec_t prec = MPFR_PREC (t);
+
+      if (MPFR_PREC (c) == 0)
+        mpfr_init2 (c, prec);
+      else
+        {
+          if (prec < MPFR_PREC (c) + MPFR_PREC (c) / 10)
+            prec = MPFR_PREC (c) + MPFR_PREC (c) / 10;
+          mpfr_set_prec (c, prec);
+        }
+      mpfr_log (c, absx, rnd);
+    }
+  mpfr_set (t, c, rnd);
+}
+
 /* Assumes that the exponent range has already been extended and if y is
-   an integer, then the result is not exact in unbounded exponent range. */
-int
-mpfr_pow_general (mpfr_ptr z, mpfr_srcptr x, mpfr_srcptr y,
-                  mpfr_rnd_t rnd_mode, int y_is_integer, mpfr_save_expo_t *expo)
+   an integer, then the result is not exact in unbounded exponent range.
+   If p is not NULL, x is the base of p, and log|x| is taken from p. */
+static int
+mpfr_pow_general_aux (mpfr_ptr z, mpfr_srcptr x, mpfr_srcptr y,
+                      mpfr_rnd_t rnd_mode, int y_is_integer,
+                      mpfr_save_expo_t *expo, mpfr_pow_prepared_ptr p)
 {
   mpfr_t t, u, k, absx;
   int neg_result = 0;
@@ -205,7 +244,7 @@ mpfr_pow_general (mpfr_ptr z, mpfr_srcptr x, mpfr_srcptr y,
 
       /* compute exp(y*ln|x|), using MPFR_RNDU to get an upper bound, so
          that we can detect underflows. */
-      mpfr_log (t, absx, MPFR_IS_NEG (y) ? MPFR_RNDD : MPFR_RNDU); /* ln|x| */
+      mpfr_pow_log (t, absx, MPFR_IS_NEG (y), p);               /* ln|x| */
       mpfr_mul (t, y, t, MPFR_RNDU);                              /* y*ln|x| */
       if (k_non_zero)
         {
@@ -260,7 +299,7 @@ mpfr_pow_general (mpfr_ptr z, mpfr_srcptr x, mpfr_srcptr y,
           if (MPFR_IS_INF (t))
             {
               /* Note: we can probably use a low precision for this test. */
-              mpfr_log (t, absx, MPFR_IS_NEG (y) ? MPFR_RNDU : MPFR_RNDD);
+              mpfr_pow_log (t, absx, MPFR_IS_POS (y), p);
               mpfr_mul (t, y, t, MPFR_RNDD);            /* y * ln|x| */
               MPFR_BLOCK (flags2, mpfr_exp (t, t, MPFR_RNDD));
               /* t = lower bound on exp(y * ln|x|) */
@@ -402,6 +441,43 @@ mpfr_pow_general (mpfr_ptr z, mpfr_srcptr x, mpfr_srcptr y,
   return inexact;
 }
 
+int
+mpfr_pow_general (mpfr_ptr z, mpfr_srcptr x, mpfr_srcptr y,
+                  mpfr_rnd_t rnd_mode, int y_is_integer, mpfr_save_expo_t *expo)
+{
+  return mpfr_pow_general_aux (z, x, y, rnd_mode, y_is_integer, expo, NULL);
+}
+
+/* Set t to a lower bound on |log2|x||, where cmp_x_1 = cmpabs(x,1). */
+static void
+mpfr_pow_log2_lower (mpfr_ptr t, mpfr_srcptr x, int cmp_x_1)
+{
+  /* (i) if x > 0, it suffices to round log2(x) toward zero;
+     (ii) if x < 0, we first compute t = o(-x), with rounding toward 1,
+          and then follow as in case (i). */
+  if (MPFR_IS_POS (x))
+    mpfr_log2 (t, x, MPFR_RNDZ);
+  else
+    {
+      mpfr_neg (t, x, (cmp_x_1 > 0) ? MPFR_RNDZ : MPFR_RNDU);
+      mpfr_log2 (t, t, MPFR_RNDZ);
+    }
+}
+
+/* Set t to an upper bound on |log|x||. */
+static void
+mpfr_pow_log_upper (mpfr_ptr t, mpfr_srcptr x, int cmp_x_1)
+{
+  if (MPFR_IS_POS(x))
+    mpfr_log (t, x, cmp_x_1 < 0 ? MPFR_RNDD : MPFR_RNDU); /* away from 0 */
+  else
+    {
+      /* if x < -1, round to +Inf, else round to zero */
+      mpfr_neg (t, x, (mpfr_cmp_si (x, -1) < 0) ? MPFR_RNDU : MPFR_RNDD);
+      mpfr_log (t, t, (mpfr_cmp_ui (t, 1) < 0) ? MPFR_RNDD : MPFR_RNDU);
+    }
+}
+
 /* The computation of z = pow(x,y) is done by
    z = exp(y * log(x)) = x^y
    For the special cases, see Section F.9.4.4 of the C standard:
@@ -422,9 +498,12 @@ mpfr_pow_general (mpfr_ptr z, mpfr_srcptr x, mpfr_srcptr y,
      _ pow(-inf, y) = -inf for y an odd integer > 0.
      _ pow(-inf, y) = +inf for y > 0 and not an odd integer.
      _ pow(+inf, y) = +0 for y < 0.
-     _ pow(+inf, y) = +inf for y > 0. */
-int
-mpfr_pow (mpfr_ptr z, mpfr_srcptr x, mpfr_srcptr y, mpfr_rnd_t rnd_mode)
+     _ pow(+inf, y) = +inf for y > 0.
+   If p is not NULL, x is the base of p, and the approximations of log|x|
+   are taken from p (and computed only the first time they are needed). */
+static int
+mpfr_pow_aux (mpfr_ptr z, mpfr_srcptr x, mpfr_srcptr y, mpfr_rnd_t rnd_mode,
+              mpfr_pow_prepared_ptr p)
 {
   int inexact;
   int cmp_x_1;
@@ -570,19 +649,22 @@ mpfr_pow (mpfr_ptr z, mpfr_srcptr x, mpfr_srcptr y, mpfr_rnd_t rnd_mode)
 
       MPFR_SAVE_EXPO_MARK (expo);
       mpfr_init2 (t, 53);
-      /* we want a lower bound on y*log2|x|:
-         (i) if x > 0, it suffices to round log2(x) toward zero, and
-             to round y*o(log2(x)) toward zero too;
-         (ii) if x < 0, we first compute t = o(-x), with rounding toward 1,
-              and then follow as in case (1). */
-      if (MPFR_IS_POS (x))
-        mpfr_log2 (t, x, MPFR_RNDZ);
+      /* we want a lower bound on y*log2|x|: it suffices to round log2|x|
+         toward zero, and to round y*o(log2|x|) toward zero too. */
+      if (p == NULL)
+        {
+          mpfr_pow_log2_lower (t, x, cmp_x_1);
+          mpfr_mul (t, t, y, MPFR_RNDZ);
+        }
       else
         {
-          mpfr_neg (t, x, (cmp_x_1 > 0) ? MPFR_RNDZ : MPFR_RNDU);
-          mpfr_log2 (t, t, MPFR_RNDZ);
+          if (MPFR_PREC (&p->_mpfr_log2) == 0)
+            {
+              mpfr_init2 (&p->_mpfr_log2, 53);
+              mpfr_pow_log2_lower (&p->_mpfr_log2, x, cmp_x_1);
+            }
+          mpfr_mul (t, &p->_mpfr_log2, y, MPFR_RNDZ);
         }
-      mpfr_mul (t, t, y, MPFR_RNDZ);
       overflow = mpfr_cmp_si (t, __gmpfr_emax) > 0;
       mpfr_clear (t);
       MPFR_SAVE_EXPO_FREE (expo);
@@ -702,18 +784,24 @@ mpfr_pow (mpfr_ptr z, mpfr_srcptr x, mpfr_srcptr y, mpfr_rnd_t rnd_mode)
     mpfr_exp_t err;
 
     /* We need an upper bound on the exponent of y * log(x). */
-    mpfr_init2 (t, 16);
-    if (MPFR_IS_POS(x))
-      mpfr_log (t, x, cmp_x_1 < 0 ? MPFR_RNDD : MPFR_RNDU); /* away from 0 */
+    if (p == NULL)
+      {
+        mpfr_init2 (t, 16);
+        mpfr_pow_log_upper (t, x, cmp_x_1);
+        MPFR_ASSERTN (MPFR_IS_PURE_FP (t));
+        err = MPFR_GET_EXP (y) + MPFR_GET_EXP (t);
+        mpfr_clear (t);
+      }
     else
       {
-        /* if x < -1, round to +Inf, else round to zero */
-        mpfr_neg (t, x, (mpfr_cmp_si (x, -1) < 0) ? MPFR_RNDU : MPFR_RNDD);
-        mpfr_log (t, t, (mpfr_cmp_ui (t, 1) < 0) ? MPFR_RNDD : MPFR_RNDU);
+        if (MPFR_PREC (&p->_mpfr_logs) == 0)
+          {
+            mpfr_init2 (&p->_mpfr_logs, 16);
+            mpfr_pow_log_upper (&p->_mpfr_logs, x, cmp_x_1);
+          }
+        MPFR_ASSERTN (MPFR_IS_PURE_FP (&p->_mpfr_logs));
+        err = MPFR_GET_EXP (y) + MPFR_GET_EXP (&p->_mpfr_logs);
       }
-    MPFR_ASSERTN (MPFR_IS_PURE_FP (t));
-    err = MPFR_GET_EXP (y) + MPFR_GET_EXP (t);
-    mpfr_clear (t);
     MPFR_CLEAR_FLAGS ();
     MPFR_SMALL_INPUT_AFTER_SAVE_EXPO (z, __gmpfr_one, - err, 0,
                                       (MPFR_IS_POS (y)) ^ (cmp_x_1 < 0),
@@ -721,8 +809,52 @@ mpfr_pow (mpfr_ptr z, mpfr_srcptr x, mpfr_srcptr y, mpfr_rnd_t rnd_mode)
   }
 
   /* General case */
-  inexact = mpfr_pow_general (z, x, y, rnd_mode, y_is_integer, &expo);
+  inexact = mpfr_pow_general_aux (z, x, y, rnd_mode, y_is_integer, &expo, p);
 
   MPFR_SAVE_EXPO_FREE (expo);
   return mpfr_check_range (z, inexact, rnd_mode);
 }
+
+int
+mpfr_pow (mpfr_ptr z, mpfr_srcptr x, mpfr_srcptr y, mpfr_rnd_t rnd_mode)
+{
+  return mpfr_pow_aux (z, x, y, rnd_mode, NULL);
+}
+
+/* Prepared base: p holds a copy of x, and the approximations of log|x|
+   needed by mpfr_pow_aux, computed lazily (a zero precision means that
+   the corresponding value has not been computed yet). */
+void
+mpfr_pow_prepared_init (mpfr_pow_prepared_ptr p, mpfr_srcptr x)
+{
+  mpfr_init2 (&p->_mpfr_x, MPFR_PREC (x));
+  if (MPFR_IS_NAN (x))
+    MPFR_SET_NAN (&p->_mpfr_x);  /* avoid setting the NaN flag */
+  else
+    mpfr_set (&p->_mpfr_x, x, MPFR_RNDN);  /* exact */
+  MPFR_PREC (&p->_mpfr_log2) = 0;
+  MPFR_PREC (&p->_mpfr_logs) = 0;
+  MPFR_PREC (&p->_mpfr_logd) = 0;
+  MPFR_PREC (&p->_mpfr_logu) = 0;
+}
+
+void
+mpfr_pow_prepared_clear (mpfr_pow_prepared_ptr p)
+{
+  mpfr_clear (&p->_mpfr_x);
+  if (MPFR_PREC (&p->_mpfr_log2) != 0)
+    mpfr_clear (&p->_mpfr_log2);
+  if (MPFR_PREC (&p->_mpfr_logs) != 0)
+    mpfr_clear (&p->_mpfr_logs);
+  if (MPFR_PREC (&p->_mpfr_logd) != 0)
+    mpfr_clear (&p->_mpfr_logd);
+  if (MPFR_PREC (&p->_mpfr_logu) != 0)
+    mpfr_clear (&p->_mpfr_logu);
+}
+
+int
+mpfr_pow_prepared (mpfr_ptr z, mpfr_pow_prepared_ptr p, mpfr_srcptr y,
+                   mpfr_rnd_t rnd_mode)
+{
+  return mpfr_pow_aux (z, &p->_mpfr_x, y, rnd_mode, p);
+}
@@ -44,92 +44,63 @@ http://www.gnu.org/licenses/ or write to the Free Software Foundation, Inc.,
 #include <errno.h>
 #include "mpfr-impl.h"
 
-#ifdef _MPFR_H_HAVE_FILE
+/* The printf-like functions write the formatted string directly to their
+   destination with mpfr_vfprintf_aux or mpfr_vasnprintf_aux (see
+   vasprintf.c), which
+   - return the number of characters of the formatted string excluding the
+   terminating null;
+   - return -1 and set the erange flag if the number of produced characters
+   exceeds INT_MAX (in that case, also set errno to EOVERFLOW in POSIX
+   systems), or in case of output error. */
 
-/* Each printf-like function calls mpfr_vasprintf which
-   - returns the number of characters in the returned string excluding the
-   terminating null
-   - returns -1 and sets the erange flag if the number of produced characters
-   exceeds INT_MAX (in that case, also sets errno to EOVERFLOW in POSIX
-   systems) */
-
-#define GET_STR_VA(sz, str, fmt, ap)            \
-  do                                            \
-    {                                           \
-      sz = mpfr_vasprintf (&(str), fmt, ap);    \
-      if (sz < 0)                               \
-        {                                       \
-          if (str)                              \
-            mpfr_free_str (str);                \
-          return -1;                            \
-        }                                       \
-    } while (0)
-
-#define GET_STR(sz, str, fmt)                   \
-  do                                            \
-    {                                           \
-      va_list ap;                               \
-      va_start(ap, fmt);                        \
-      sz = mpfr_vasprintf (&(str), fmt, ap);    \
-      va_end (ap);                              \
-      if (sz < 0)                               \
-        {                                       \
-          if (str)                              \
-            mpfr_free_str (str);                \
-          return -1;                            \
-        }                                       \
-    } while (0)
+#ifdef _MPFR_H_HAVE_FILE
 
 int
 mpfr_printf (const char *fmt, ...)
 {
-  char *str;
+  va_list ap;
   int ret;
 
-  GET_STR (ret, str, fmt);
-  ret = printf ("%s", str);
-
-  mpfr_free_str (str);
+  va_start (ap, fmt);
+  ret = mpfr_vfprintf_aux (stdout, fmt, ap);
+  va_end (ap);
   return ret;
 }
 
 int
 mpfr_vprintf (const char *fmt, va_list ap)
 {
-  char *str;
-  int ret;
-
-  GET_STR_VA (ret, str, fmt, ap);
-  ret = printf ("%s", str);
-
-  mpfr_free_str (str);
-  return ret;
+  return mpfr_vfprintf_aux (stdout, fmt, ap);
 }
 
 
 int
 mpfr_fprintf (FILE *fp, const char *fmt, ...)
 {
-  char *str;
+  va_list ap;
   int ret;
 
-  GET_STR (ret, str, fmt);
-  ret = fprintf (fp, "%s", str);
-
-  mpfr_free_str (str);
+  va_start (ap, fmt);
+  ret = mpfr_vfprintf_aux (fp, fmt, ap);
+  va_end (ap);
   return ret;
 }
 
 int
 mpfr_vfprintf (FILE *fp, const char *fmt, va_list ap)
 {
-  char *str;
-  int ret;
+  return mpfr_vfprintf_aux (fp, fmt, ap);
+}
 
-  GET_STR_VA (ret, str, fmt, ap);
-  ret = fprintf (fp, "%s", str);
+int
+mpfr_printf_compiled (mpfr_printf_format_t f, ...)
+{
+  va_list ap;
+  int ret;
 
-  mpfr_free_str (str);
+  va_start (ap, f);
+  ret = mpfr_vfprintf_compiled_aux (stdout, f, ap);
+  va_end (ap);
   return ret;
 }
 
@@ -138,80 +109,66 @@ mpfr_vfprintf (FILE *fp, const char *fmt, va_list ap)
 int
 mpfr_sprintf (char *buf, const char *fmt, ...)
 {
-  char *str;
+  va_list ap;
   int ret;
 
-  GET_STR (ret, str, fmt);
-  ret = sprintf (buf, "%s", str);
-
-  mpfr_free_str (str);
+  va_start (ap, fmt);
+  ret = mpfr_vasnprintf_aux (NULL, buf, (size_t) -1, fmt, ap);
+  va_end (ap);
   return ret;
 }
 
 int
 mpfr_vsprintf (char *buf, const char *fmt, va_list ap)
 {
-  char *str;
-  int ret;
-
-  GET_STR_VA (ret, str, fmt, ap);
-  ret = sprintf (buf, "%s", str);
-
-  mpfr_free_str (str);
-  return ret;
+  return mpfr_vasnprintf_aux (NULL, buf, (size_t) -1, fmt, ap);
 }
 
 int
 mpfr_snprintf (char *buf, size_t size, const char *fmt, ...)
 {
-  char *str;
+  va_list ap;
   int ret;
-  size_t min_size;
-
-  GET_STR (ret, str, fmt);
 
   /* C99 allows SIZE to be zero */
-  if (size != 0)
-    {
-      MPFR_ASSERTN (buf != NULL);
-      min_size = (size_t)ret < size ? (size_t)ret : size - 1;
-      strncpy (buf, str, min_size);
-      buf[min_size] = '\0';
-    }
-
-  mpfr_free_str (str);
+  MPFR_ASSERTN (size == 0 || buf != NULL);
+  va_start (ap, fmt);
+  ret = mpfr_vasnprintf_aux (NULL, buf, size, fmt, ap);
+  va_end (ap);
   return ret;
 }
 
 int
 mpfr_vsnprintf (char *buf, size_t size, const char *fmt, va_list ap)
 {
-  char *str;
-  int ret;
-  int min_size;
+  /* C99 allows SIZE to be zero */
+  MPFR_ASSERTN (size == 0 || buf != NULL);
+  return mpfr_vasnprintf_aux (NULL, buf, size, fmt, ap);
+}
 
-  GET_STR_VA (ret, str, fmt, ap);
+int
+mpfr_snprintf_compiled (char *buf, size_t size, mpfr_printf_format_t f, ...)
+{
+  va_list ap;
+  int ret;
 
   /* C99 allows SIZE to be zero */
-  if (size != 0)
-    {
-      MPFR_ASSERTN (buf != NULL);
-      min_size = (size_t)ret < size ? (size_t)ret : size - 1;
-      strncpy (buf, str, min_size);
-      buf[min_size] = '\0';
-    }
-
-  mpfr_free_str (str);
+  MPFR_ASSERTN (size == 0 || buf != NULL);
+  va_start (ap, f);
+  ret = mpfr_vsnprintf_compiled_aux (buf, size, f, ap);
+  va_end (ap);
   return ret;
 }
 
 int
 mpfr_asprintf (char **pp, const char *fmt, ...)
 {
+  va_list ap;
   int ret;
 
-  GET_STR (ret, *pp, fmt);
-
+  va_start (ap, fmt);
+  ret = mpfr_vasnprintf_aux (pp, NULL, 0, fmt, ap);
+  va_end (ap);
   return ret;
 }
 
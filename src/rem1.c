@@ -157,8 +157,34 @@ mpfr_rem1 (mpfr_ptr rem, long *quo, mpfr_rnd_t rnd_q,
            which is obtained by dividing by 2Y. */
         mpz_mul_2exp (my, my, 1);       /* 2Y */
 
+      /* reduce mx first, so that the product below has the size of my
+         whatever the precision of x */
+      if (mpz_cmp (mx, my) >= 0)
+        mpz_mod (mx, mx, my);
       mpz_set_ui (r, 2);
-      mpz_powm_ui (r, r, ex - ey, my);  /* 2^(ex-ey) mod my */
+      if (MPFR_LIKELY ((mpfr_uexp_t) (ex - ey) <= ULONG_MAX))
+        mpz_powm_ui (r, r, ex - ey, my);  /* 2^(ex-ey) mod my */
+      else
+        {
+          /* the exponent gap does not fit in an unsigned long, which may
+             happen when mpfr_exp_t is larger than long (e.g., with
+             _MPFR_EXP_FORMAT=4 and a 32-bit long): build it exactly in an
+             mpz from its two halves, without any MPFR arithmetic, which
+             would be done in the exponent range of the user and could
+             overflow, and use mpz_powm */
+          mpfr_uexp_t g = (mpfr_uexp_t) (ex - ey);
+          int h = sizeof (unsigned long) * CHAR_BIT / 2;
+          mpz_t e;
+
+          MPFR_STAT_STATIC_ASSERT (sizeof (mpfr_uexp_t)
+                                   <= 2 * sizeof (unsigned long));
+          mpz_init (e);
+          mpz_set_ui (e, (unsigned long) ((g >> h) >> h));
+          mpz_mul_2exp (e, e, 2 * h);
+          mpz_add_ui (e, e, (unsigned long) g);
+          mpz_powm (r, r, e, my);       /* 2^(ex-ey) mod my */
+          mpz_clear (e);
+        }
       mpz_mul (r, r, mx);
       mpz_mod (r, r, my);
 
@@ -44,6 +44,162 @@ static int
 mpfr_root_aux (mpfr_ptr y, mpfr_srcptr x, unsigned long k,
                mpfr_rnd_t rnd_mode);
 
+/* Compute y <- x^(1/k) with a Newton iteration for the reciprocal root,
+   for 2 <= k <= 100 and PREC(y) > 2*GMP_NUMB_BITS.
+   Assume x > 0, or x < 0 and k odd.
+
+   Write |x| = a * 2^(k*e) with 1/2 <= a < 2^(k-1), and let R = a^(1/k).
+   We start from an approximation of 1/R to at most 2*GMP_NUMB_BITS bits,
+   obtained with mpfr_root in that precision (thus with mpz_root). Then
+   each step z <- z + z * (1 - a*z^k) / k doubles the number of correct
+   bits (minus g guard bits), the precision being doubled too. Since
+   1 - a*z^k is small, the correction is computed in a reduced precision.
+
+   The last step, in the working precision w, directly gives R: with
+   q = z^(k-1), u = 1 - a*z^k and m = (k-1)/k, we have R = a*q*(1-u)^(-m),
+   and we take t = a*q + a*q*m*u. For |u| <= 1/4, the mathematical error
+   of this formula is |(1-u)^(-m) - 1 - m*u| <= 4*u^2. The roundings give:
+     q = z^(k-1)*(1+t1), r = o(a*q) = a*z^(k-1)*(1+t1)*(1+t2),
+     u = 1 - r*z*(1+t3) (the subtraction is exact by Sterbenz's lemma),
+     thus |u - u_exact| <= 4*2^(-w) where u_exact = 1 - a*z^k,
+     c = r*m*u*(1+d)^3 computed in precision pc with |u|*2^(-pc) <= 2^(-w-1),
+     t = o(r+c) = (r+c)*(1+t4),
+   where |ti| <= 2^(-w) and |d| <= 2^(-pc). If |u| < 2^(-ceil(w/2)-1), then
+   4*u_exact^2 < 1.1*2^(-w), and t/R = (1+t1)*(1+t2)*(1+t4)*(1+eta) with
+   |eta| < 7*2^(-w), thus |t - R| < 10*2^(-w)*R < 2^(EXP(t)-w+6).
+   Note that z has only about w/2 bits, so that the computation of q and
+   the product r*z are cheaper than full multiplications.
+   If |u| is larger (the previous steps did not converge as expected),
+   we use a larger working precision. As usual, exact roots (and midpoints
+   for MPFR_RNDN) are detected when rounding fails. */
+static int
+mpfr_root_newton (mpfr_ptr y, mpfr_srcptr x, unsigned long k,
+                  mpfr_rnd_t rnd_mode)
+{
+  mpfr_exp_t ex, e;
+  mpfr_prec_t n, w, p, pz, g;
+  mpfr_prec_t precs[MPFR_PREC_BITS];
+  int i, nsteps, inexact, exact_root = 0;
+  mpfr_t a, z, q, u, c, t;
+  MPFR_ZIV_DECL (loop);
+  MPFR_SAVE_EXPO_DECL (expo);
+
+  MPFR_LOG_FUNC
+    (("x[%Pu]=%.*Rg k=%lu rnd=%d",
+      mpfr_get_prec (x), mpfr_log_prec, x, k, rnd_mode),
+     ("y[%Pu]=%.*Rg inexact=%d",
+      mpfr_get_prec (y), mpfr_log_prec, y, inexact));
+
+  MPFR_ASSERTD (MPFR_IS_PURE_FP (x));
+  MPFR_ASSERTD (2 <= k && k <= 100);
+  MPFR_ASSERTD (MPFR_PREC (y) > 2 * GMP_NUMB_BITS);
+  MPFR_ASSERTD (MPFR_IS_POS (x) || (k % 2) != 0);
+
+  /* |x| = a * 2^(k*e) with e = floor(EXP(x)/k), thus 0 <= EXP(a) < k */
+  ex = MPFR_GET_EXP (x);
+  e = ex >= 0 ? ex / (mpfr_exp_t) k
+    : - ((- ex + (mpfr_exp_t) k - 1) / (mpfr_exp_t) k);
+  MPFR_ALIAS (a, x, 1, ex - (mpfr_exp_t) k * e);
+
+  n = MPFR_PREC (y);
+  g = MPFR_INT_CEIL_LOG2 (k) + 4;      /* guard bits in each step */
+  w = n + MPFR_INT_CEIL_LOG2 (n) + 10;
+
+  MPFR_SAVE_EXPO_MARK (expo);
+  mpfr_init2 (z, 2 * GMP_NUMB_BITS);
+  mpfr_init2 (q, w);
+  mpfr_init2 (u, 2 * GMP_NUMB_BITS);
+  mpfr_init2 (c, 2 * GMP_NUMB_BITS);
+  mpfr_init2 (t, w);
+
+  MPFR_ZIV_INIT (loop, w);
+  for (;;)
+    {
+      /* precisions of the Newton steps, the last one being w */
+      nsteps = 0;
+      for (p = w; p > 2 * GMP_NUMB_BITS; p = p / 2 + g)
+        precs[nsteps++] = p;
+      if (nsteps == 0)
+        precs[nsteps++] = w;
+
+      /* initial approximation z ~ 1/R to about p bits */
+      mpfr_set_prec (z, p);
+      mpfr_set (z, a, MPFR_RNDN);
+      mpfr_root (z, z, k, MPFR_RNDN);
+      mpfr_ui_div (z, 1, z, MPFR_RNDN);
+      pz = p;
+
+      for (i = nsteps - 1; i >= 1; i--)
+        {
+          p = precs[i];
+          mpfr_prec_round (z, p, MPFR_RNDN);       /* exact */
+          mpfr_set_prec (u, p);
+          mpfr_pow_ui (u, z, k, MPFR_RNDN);
+          mpfr_mul (u, u, a, MPFR_RNDN);
+          mpfr_ui_sub (u, 1, u, MPFR_RNDN);        /* 1 - a*z^k */
+          if (MPFR_NOTZERO (u))
+            {
+              /* |u| is about 2^(-pz), thus we only need p-pz+g bits */
+              mpfr_set_prec (c, p - pz + g);
+              mpfr_mul (c, u, z, MPFR_RNDN);
+              mpfr_div_ui (c, c, k, MPFR_RNDN);
+              mpfr_add (z, z, c, MPFR_RNDN);
+            }
+          pz = p;
+        }
+
+      /* last step, see the error analysis above */
+      mpfr_set_prec (u, w);
+      mpfr_pow_ui (q, z, k - 1, MPFR_RNDN);      /* q = z^(k-1) */
+      mpfr_mul (t, q, a, MPFR_RNDN);             /* r = a*q */
+      mpfr_mul (u, t, z, MPFR_RNDN);             /* r*z ~ a*z^k */
+      mpfr_ui_sub (u, 1, u, MPFR_RNDN);          /* u = 1 - r*z, exact */
+      if (MPFR_NOTZERO (u))
+        {
+          mpfr_prec_t pc;
+
+          if (MPFR_GET_EXP (u) > - ((w + 1) / 2) - 1)
+            goto next_w;  /* |u| >= 2^(-ceil(w/2)-1) */
+          pc = w + MPFR_GET_EXP (u) + 1;
+          mpfr_set_prec (c, MAX (pc, MPFR_PREC_MIN));
+          mpfr_mul (c, t, u, MPFR_RNDN);
+          mpfr_mul_ui (c, c, k - 1, MPFR_RNDN);
+          mpfr_div_ui (c, c, k, MPFR_RNDN);
+          mpfr_add (t, t, c, MPFR_RNDN);
+        }
+      if (MPFR_LIKELY (MPFR_CAN_ROUND (t, w - 6, n, rnd_mode)))
+        break;
+
+      /* If we fail to round correctly, check for an exact result or a
+         midpoint result with MPFR_RNDN (see mpfr_root_aux). */
+      mpfr_set_prec (c, n + (rnd_mode == MPFR_RNDN));
+      mpfr_set_prec (u, MPFR_PREC (x));
+      mpfr_set (c, t, MPFR_RNDN);
+      inexact = mpfr_pow_ui (u, c, k, MPFR_RNDN);
+      exact_root = !inexact && mpfr_equal_p (u, a);
+      if (exact_root)
+        {
+          inexact = mpfr_set4 (y, c, rnd_mode, MPFR_SIGN (x));
+          break;
+        }
+
+    next_w:
+      MPFR_ZIV_NEXT (loop, w);
+      mpfr_set_prec (q, w);
+      mpfr_set_prec (t, w);
+    }
+  MPFR_ZIV_FREE (loop);
+
+  if (!exact_root)
+    inexact = mpfr_set4 (y, t, rnd_mode, MPFR_SIGN (x));
+  /* the exponent range is extended, thus this cannot overflow */
+  MPFR_SET_EXP (y, MPFR_GET_EXP (y) + e);
+
+  mpfr_clears (z, q, u, c, t, (mpfr_ptr) 0);
+  MPFR_SAVE_EXPO_FREE (expo);
+  return mpfr_check_range (y, inexact, rnd_mode);
+}
+
 int
 mpfr_root (mpfr_ptr y, mpfr_srcptr x, unsigned long k, mpfr_rnd_t rnd_mode)
 {
@@ -114,6 +270,16 @@ mpfr_root (mpfr_ptr y, mpfr_srcptr x, unsigned long k, mpfr_rnd_t rnd_mode)
   if (k > 100)
     return mpfr_root_aux (y, x, k, rnd_mode);
 
+  /* The integer root extraction below works on about k*PREC(y) bits,
+     while the cost of the Newton iteration grows only like log(k).
+     Timings show that the latter is faster when k^2*PREC(y) is large,
+     except for k = 3, for which mpz_root remains faster. The condition
+     PREC(y) > 2*GMP_NUMB_BITS ensures that the initial approximation
+     in mpfr_root_newton is computed by the code below. */
+  if (k > 3 && MPFR_PREC (y) > MPFR_ROOT_THRESHOLD / (k * k)
+      && MPFR_PREC (y) > 2 * GMP_NUMB_BITS)
+    return mpfr_root_newton (y, x, k, rnd_mode);
+
   MPFR_SAVE_EXPO_MARK (expo);
   mpz_init (m);
 
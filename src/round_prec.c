@@ -69,7 +69,16 @@ mpfr_prec_round (mpfr_ptr x, mpfr_prec_t prec, mpfr_rnd_t rnd_mode)
       /* FIXME: Variable can't be created using custom allocation,
          MPFR_DECL_INIT or GROUP_ALLOC: How to detect? */
       ow = MPFR_GET_ALLOC_SIZE(x);
-      if (nw > ow)
+      if (ow < 0 && nw > -ow)
+       {
+         /* The significand belongs to an arena: move it to the heap */
+         mpfr_limb_ptr tmpx = MPFR_SIGNIFICAND_ALLOC (nw);
+         MPN_COPY ((mp_limb_t *) ((mpfr_size_limb_t *) tmpx + 1),
+                   MPFR_MANT(x), MPFR_LIMB_SIZE (x));
+         MPFR_SET_MANT_PTR(x, tmpx);
+         MPFR_SET_ALLOC_SIZE(x, nw);
+       }
+      else if (ow >= 0 && nw > ow)
        {
          /* Realloc significand */
          mpfr_limb_ptr tmpx = (mpfr_limb_ptr) (*__gmp_reallocate_func)
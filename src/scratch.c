@@ -0,0 +1,169 @@
+/* mpfr_scratch_mark, mpfr_scratch_alloc, mpfr_scratch_release --
+   per-thread stack of temporary limbs
+
+Copyright 2016 Free Software Foundation, Inc.
+Contributed by the AriC and Caramba projects, INRIA.
+
+This file is part of the GNU MPFR Library.
+
+The GNU MPFR Library is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+The GNU MPFR Library is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with the GNU MPFR Library; see the file COPYING.LESSER.  If not, see
+http://www.gnu.org/licenses/ or write to the Free Software Foundation, Inc.,
+51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA. */
+
+#include "mpfr-impl.h"
+
+/* The scratch stack is a list of chunks, kept from one call to another.
+   Only the current chunk (scratch_cur) is used for new allocations, from
+   its first scratch_used limbs on; the previous chunks are in use and the
+   next ones are free. mpfr_scratch_release goes back to a mark taken by
+   mpfr_scratch_mark, so that the allocations must be released in the
+   reverse order (as done by MPFR_GROUP_INIT and MPFR_GROUP_CLEAR). When
+   the whole stack is released, its chunks are merged into a single one,
+   so that the same computation does not need to allocate memory again. */
+
+/* Size of the first chunk, in limbs */
+#ifndef MPFR_SCRATCH_SIZE
+# define MPFR_SCRATCH_SIZE 512
+#endif
+
+/* Maximal size kept when the stack is released, in limbs */
+#ifndef MPFR_SCRATCH_KEEP
+# define MPFR_SCRATCH_KEEP 65536
+#endif
+
+typedef union mpfr_scratch_chunk_u {
+  struct {
+    union mpfr_scratch_chunk_u *prev, *next;
+    size_t size;  /* number of limbs after the header */
+  } h;
+  mp_limb_t align;
+} mpfr_scratch_chunk_t;
+
+#define CHUNK_LIMBS(c) ((mp_limb_t *) ((c) + 1))
+#define CHUNK_BYTES(n) \
+  (sizeof (mpfr_scratch_chunk_t) + (n) * sizeof (mp_limb_t))
+
+static MPFR_THREAD_ATTR mpfr_scratch_chunk_t *scratch_cur = NULL;
+static MPFR_THREAD_ATTR size_t scratch_used = 0;
+
+/* Free c and the chunks after it, and return their total size in limbs */
+static size_t
+scratch_free_from (mpfr_scratch_chunk_t *c)
+{
+  size_t n = 0;
+
+  while (c != NULL)
+    {
+      mpfr_scratch_chunk_t *next = c->h.next;
+
+      n += c->h.size;
+      (*__gmp_free_func) (c, CHUNK_BYTES (c->h.size));
+      c = next;
+    }
+  return n;
+}
+
+static mpfr_scratch_chunk_t *
+scratch_new (mpfr_scratch_chunk_t *prev, size_t n)
+{
+  mpfr_scratch_chunk_t *c;
+
+  c = (mpfr_scratch_chunk_t *) (*__gmp_allocate_func) (CHUNK_BYTES (n));
+  c->h.prev = prev;
+  c->h.next = NULL;
+  c->h.size = n;
+  if (prev != NULL)
+    prev->h.next = c;
+  return c;
+}
+
+void
+mpfr_scratch_mark (mpfr_scratch_mark_t *m)
+{
+  m->chunk = scratch_cur;
+  m->used = scratch_used;
+}
+
+MPFR_HOT_FUNCTION_ATTR mp_limb_t *
+mpfr_scratch_alloc (size_t n)
+{
+  mpfr_scratch_chunk_t *c = scratch_cur;
+  mp_limb_t *p;
+
+  if (MPFR_UNLIKELY (c == NULL || c->h.size - scratch_used < n))
+    {
+      /* Go to the next chunk if it is large enough, otherwise replace
+         it (and the following ones, which are free) by a new chunk. */
+      mpfr_scratch_chunk_t *next = c == NULL ? NULL : c->h.next;
+
+      if (next == NULL || next->h.size < n)
+        {
+          size_t size = c == NULL ? MPFR_SCRATCH_SIZE : 2 * c->h.size;
+
+          if (c != NULL)
+            c->h.next = NULL;
+          scratch_free_from (next);
+          next = scratch_new (c, size < n ? n : size);
+        }
+      scratch_cur = c = next;
+      scratch_used = 0;
+    }
+  p = CHUNK_LIMBS (c) + scratch_used;
+  scratch_used += n;
+  return p;
+}
+
+MPFR_HOT_FUNCTION_ATTR void
+mpfr_scratch_release (mpfr_scratch_mark_t *m)
+{
+  mpfr_scratch_chunk_t *c;
+  size_t n;
+
+  c = m->chunk;
+  if (c == NULL)
+    {
+      /* the mark was taken before the first allocation */
+      c = scratch_cur;
+      if (c == NULL)
+        return;
+      while (c->h.prev != NULL)
+        c = c->h.prev;
+      scratch_used = 0;
+    }
+  else
+    scratch_used = m->used;
+  scratch_cur = c;
+
+  if (scratch_used == 0 && c->h.prev == NULL
+      && (c->h.next != NULL || c->h.size > MPFR_SCRATCH_KEEP))
+    {
+      /* The whole stack is free: merge the chunks, or free them if they
+         are too large. */
+      n = scratch_free_from (c);
+      scratch_cur = n <= MPFR_SCRATCH_KEEP ? scratch_new (NULL, n) : NULL;
+    }
+}
+
+/* Free the scratch stack if it is not in use */
+void
+mpfr_scratch_free (void)
+{
+  mpfr_scratch_chunk_t *c = scratch_cur;
+
+  if (c != NULL && scratch_used == 0 && c->h.prev == NULL)
+    {
+      scratch_free_from (c);
+      scratch_cur = NULL;
+    }
+}
@@ -103,50 +103,62 @@ static unsigned int T[1024] = {
 #endif
 
 #if _MPFR_IEEE_FLOATS
-/* Convert d to a decimal string (one-to-one correspondence, no rounding).
-   The string s needs to have at least 25 characters (with the final '\0'):
-   * 1 for the sign '-'
-   * 2 for the leading '0.'
-   * 16 for the significand
-   * 5 for the exponent (for example 'E-100')
-   * 1 for the final '\0'
- */
-static void
-decimal64_to_string (char *s, _Decimal64 d)
+/* Set *p to 5^k and return 1 if it fits in an unsigned long,
+   otherwise return 0. */
+static int
+pow5_ui (unsigned long *p, int k)
+{
+  unsigned long v = 1;
+
+  while (k-- > 0)
+    {
+      if (v > ULONG_MAX / 5)
+        return 0;
+      v *= 5;
+    }
+  *p = v;
+  return 1;
+}
+
+/* Set r to d rounded in the direction rnd_mode, and return the ternary
+   value. The finite number d = c * 10^q is decoded from its BID or DPD
+   encoding, the coefficient c < 10^16 is put exactly into a 64-bit number,
+   then r is obtained with a single correctly rounded multiplication or
+   division by 5^|q| and an exact multiplication by 2^q. If z is not NULL,
+   it is an initialized integer used to hold 5^|q| when it does not fit in
+   an unsigned long (this avoids allocations in mpfr_set_decimal64_array). */
+static int
+set_decimal64_aux (mpfr_ptr r, _Decimal64 d, mpfr_rnd_t rnd_mode, mpz_ptr z)
 {
   union mpfr_ieee_double_extract x;
   union ieee_double_decimal64 y;
-  char *t;
   unsigned int Gh; /* most 5 significant bits from combination field */
   int exp; /* exponent */
-  mp_limb_t rp[2];
-  mp_size_t rn = 2;
-  unsigned int i;
+  unsigned long hi, lo, p5;
+  mpfr_t t;
+  mp_limb_t tp[(64 - 1) / GMP_NUMB_BITS + 1];
+  int inex;
+  MPFR_SAVE_EXPO_DECL (expo);
 #ifdef DPD_FORMAT
   unsigned int d0, d1, d2, d3, d4, d5;
 #endif
 
-  /* now convert BID or DPD to string */
   y.d64 = d;
   x.d = y.d;
   Gh = x.s.exp >> 6;
   if (Gh == 31)
     {
-      sprintf (s, "NaN");
-      return;
+      MPFR_SET_NAN (r);
+      MPFR_RET_NAN;
     }
   else if (Gh == 30)
     {
-      if (x.s.sig == 0)
-        sprintf (s, "Inf");
-      else
-        sprintf (s, "-Inf");
-      return;
+      MPFR_SET_INF (r);
+      MPFR_SET_SIGN (r, x.s.sig ? MPFR_SIGN_NEG : MPFR_SIGN_POS);
+      MPFR_RET (0);
     }
-  t = s;
-  if (x.s.sig)
-    *t++ = '-';
 
+  /* the coefficient is c = hi * 10^9 + lo (DPD) or hi * 2^32 + lo (BID) */
 #ifdef DPD_FORMAT
   if (Gh < 24)
     {
@@ -165,12 +177,8 @@ decimal64_to_string (char *s, _Decimal64 d)
   d3 = (x.s.manl >> 20) & 1023;
   d4 = (x.s.manl >> 10) & 1023;
   d5 = x.s.manl & 1023;
-  sprintf (t, "%1u%3u%3u%3u%3u%3u", d0, T[d1], T[d2], T[d3], T[d4], T[d5]);
-  /* Warning: some characters may be blank */
-  for (i = 0; i < 16; i++)
-    if (t[i] == ' ')
-      t[i] = '0';
-  t += 16;
+  hi = (d0 * 1000 + T[d1]) * 1000 + T[d2];
+  lo = (T[d3] * 1000 + T[d4]) * 1000 + T[d5];
 #else /* BID */
   if (Gh < 24)
     {
@@ -178,40 +186,85 @@ decimal64_to_string (char *s, _Decimal64 d)
          significand from bits G[10] through the end of the decoding */
       exp = x.s.exp >> 1;
       /* manh has 20 bits, manl has 32 bits */
-      rp[1] = ((x.s.exp & 1) << 20) | x.s.manh;
-      rp[0] = x.s.manl;
+      hi = ((x.s.exp & 1) << 20) | x.s.manh;
     }
   else
     {
       /* the biased exponent is formed from G[2] to G[11] */
-      exp = (x.s.exp & 511) << 1;
-      rp[1] = x.s.manh;
-      rp[0] = x.s.manl;
-      exp |= rp[1] >> 19;
-      rp[1] &= 524287; /* 2^19-1: cancel G[11] */
-      rp[1] |= 2097152; /* add 2^21 */
+      exp = ((x.s.exp & 511) << 1) | (x.s.manh >> 19);
+      hi = (x.s.manh & 524287) | 2097152; /* cancel G[11], add 2^21 */
     }
-#if GMP_NUMB_BITS >= 54
-  rp[0] |= rp[1] << 32;
-  rn = 1;
-#endif
-  while (rn > 0 && rp[rn - 1] == 0)
-    rn --;
-  if (rn == 0)
+  lo = x.s.manl;
+  /* a coefficient larger than 10^16-1 = 2386F26FC0FFFF is non-canonical,
+     and is interpreted as zero */
+  if (hi > 0x2386F2 || (hi == 0x2386F2 && lo > 0x6FC0FFFF))
+    hi = lo = 0;
+#endif /* DPD or BID */
+
+  if (hi == 0 && lo == 0)
     {
-      *t = 0;
-      i = 1;
+      MPFR_SET_ZERO (r);
+      MPFR_SET_SIGN (r, x.s.sig ? MPFR_SIGN_NEG : MPFR_SIGN_POS);
+      MPFR_RET (0);
     }
+
+  exp -= 398; /* unbiased exponent */
+
+  MPFR_TMP_INIT1 (tp, t, 64);
+  MPFR_SAVE_EXPO_MARK (expo);
+#if GMP_NUMB_BITS >= 64
+  {
+    mp_limb_t v;
+    int cnt;
+
+#ifdef DPD_FORMAT
+    v = (mp_limb_t) hi * 1000000000 + lo;
+#else
+    v = ((mp_limb_t) hi << 32) | lo;
+#endif
+    count_leading_zeros (cnt, v);
+    tp[0] = v << cnt;
+    MPFR_SET_POS (t);
+    MPFR_SET_EXP (t, GMP_NUMB_BITS - cnt);
+  }
+#else
+  /* exact since c < 2^54 */
+  mpfr_set_ui (t, hi, MPFR_RNDN);
+#ifdef DPD_FORMAT
+  mpfr_mul_ui (t, t, 1000000000, MPFR_RNDN);
+#else
+  mpfr_mul_2ui (t, t, 32, MPFR_RNDN);
+#endif
+  mpfr_add_ui (t, t, lo, MPFR_RNDN);
+#endif
+  if (x.s.sig)
+    MPFR_SET_NEG (t);
+
+  /* r = c * 5^exp * 2^exp */
+  if (exp == 0)
+    inex = mpfr_set (r, t, rnd_mode);
+  else if (pow5_ui (&p5, exp > 0 ? exp : - exp))
+    inex = exp > 0 ? mpfr_mul_ui (r, t, p5, rnd_mode)
+      : mpfr_div_ui (r, t, p5, rnd_mode);
   else
     {
-      i = mpn_get_str ((unsigned char*)t, 10, rp, rn);
-    }
-  while (i-- > 0)
-    *t++ += '0';
-#endif /* DPD or BID */
+      mpz_t zz;
 
-  exp -= 398; /* unbiased exponent */
-  sprintf (t, "E%d", exp);
+      if (z == NULL)
+        {
+          mpz_init (zz);
+          z = zz;
+        }
+      mpz_ui_pow_ui (z, 5, exp > 0 ? exp : - exp);
+      inex = exp > 0 ? mpfr_mul_z (r, t, z, rnd_mode)
+        : mpfr_div_z (r, t, z, rnd_mode);
+      if (z == zz)
+        mpz_clear (zz);
+    }
+  /* exact in the extended exponent range */
+  mpfr_mul_2si (r, r, exp, MPFR_RNDN);
+  MPFR_SAVE_EXPO_FREE (expo);
+  return mpfr_check_range (r, inex, rnd_mode);
 }
 #else
 /* portable version */
@@ -417,6 +470,9 @@ decimal64_to_string (char *s, _Decimal64 d)
 int
 mpfr_set_decimal64 (mpfr_ptr r, _Decimal64 d, mpfr_rnd_t rnd_mode)
 {
+#if _MPFR_IEEE_FLOATS
+  return set_decimal64_aux (r, d, rnd_mode, NULL);
+#else
   char s[25]; /* need 1 character for sign,
                       2 characters for '0.'
                      16 characters for significand,
@@ -425,7 +481,31 @@ mpfr_set_decimal64 (mpfr_ptr r, _Decimal64 d, mpfr_rnd_t rnd_mode)
                       1 character for terminating \0. */
 
   decimal64_to_string (s, d);
-  return mpfr_set_str (r, s, 10, rnd_mode);
+  return mpfr_strtofr (r, s, NULL, 10, rnd_mode);
+#endif
+}
+
+/* Set tab[i] to d[i] rounded in the direction rnd_mode, for 0 <= i < n.
+   Return 0 if all the conversions are exact, and a non-zero value
+   otherwise. */
+int
+mpfr_set_decimal64_array (mpfr_ptr *const tab, const _Decimal64 *d,
+                          unsigned long n, mpfr_rnd_t rnd_mode)
+{
+  unsigned long i;
+  int inex = 0;
+#if _MPFR_IEEE_FLOATS
+  mpz_t z;
+
+  mpz_init (z);
+  for (i = 0; i < n; i++)
+    inex |= set_decimal64_aux (tab[i], d[i], rnd_mode, z);
+  mpz_clear (z);
+#else
+  for (i = 0; i < n; i++)
+    inex |= mpfr_set_decimal64 (tab[i], d[i], rnd_mode);
+#endif
+  return inex;
 }
 
 #endif /* MPFR_WANT_DECIMAL_FLOATS */
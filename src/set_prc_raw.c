@@ -26,6 +26,8 @@ void
 mpfr_set_prec_raw (mpfr_ptr x, mpfr_prec_t p)
 {
   MPFR_ASSERTN (MPFR_PREC_COND (p));
-  MPFR_ASSERTN (p <= (mpfr_prec_t) MPFR_GET_ALLOC_SIZE(x) * GMP_NUMB_BITS);
+  MPFR_ASSERTN (p <= (mpfr_prec_t) (MPFR_IS_ARENA_ALLOC (x) ?
+                                     - MPFR_GET_ALLOC_SIZE(x) :
+                                     MPFR_GET_ALLOC_SIZE(x)) * GMP_NUMB_BITS);
   MPFR_PREC(x) = p;
 }
@@ -38,10 +38,30 @@ mpfr_set_prec (mpfr_ptr x, mpfr_prec_t p)
   xoldsize = MPFR_GET_ALLOC_SIZE (x);
   if (xsize > xoldsize)
     {
-      tmp = (mpfr_limb_ptr) (*__gmp_reallocate_func)
-        (MPFR_GET_REAL_PTR(x), MPFR_MALLOC_SIZE(xoldsize), MPFR_MALLOC_SIZE(xsize));
-      MPFR_SET_MANT_PTR(x, tmp);
-      MPFR_SET_ALLOC_SIZE(x, xsize);
+      if (MPFR_LIKELY (xoldsize >= 0))
+        {
+#if MPFR_MY_SIGNIFICAND_LIMBS
+          if (xsize <= MPFR_MY_SIGNIFICAND_LIMBS)
+            {
+              /* the value is lost: exchange the block with a cached one */
+              mpfr_significand_free (MPFR_GET_REAL_PTR(x), xoldsize);
+              tmp = mpfr_significand_alloc (xsize);
+            }
+          else
+#endif
+            tmp = (mpfr_limb_ptr) (*__gmp_reallocate_func)
+              (MPFR_GET_REAL_PTR(x), MPFR_MALLOC_SIZE(xoldsize),
+               MPFR_MALLOC_SIZE(xsize));
+          MPFR_SET_MANT_PTR(x, tmp);
+          MPFR_SET_ALLOC_SIZE(x, xsize);
+        }
+      else if (xsize > -xoldsize)
+        {
+          /* the significand belongs to an arena: move it to the heap */
+          tmp = MPFR_SIGNIFICAND_ALLOC (xsize);
+          MPFR_SET_MANT_PTR(x, tmp);
+          MPFR_SET_ALLOC_SIZE(x, xsize);
+        }
     }
   MPFR_PREC (x) = p;
   MPFR_SET_NAN (x); /* initializes to NaN */
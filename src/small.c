@@ -0,0 +1,55 @@
+/* mpfr_small_init2 -- initialize a number with its significand stored in
+   the variable itself
+
+Copyright 2016 Free Software Foundation, Inc.
+Contributed by the AriC and Caramba projects, INRIA.
+
+This file is part of the GNU MPFR Library.
+
+The GNU MPFR Library is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+The GNU MPFR Library is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with the GNU MPFR Library; see the file COPYING.LESSER.  If not, see
+http://www.gnu.org/licenses/ or write to the Free Software Foundation, Inc.,
+51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA. */
+
+#include "mpfr-impl.h"
+
+/* The significand of x->_mpfr_x is x->_mpfr_d, preceded by its allocation
+   size x->_mpfr_alloc, as for mpfr_init2. As for an arena, this size is
+   stored negated, so that mpfr_clear ignores the significand and that
+   mpfr_set_prec moves it to the heap when a larger one is needed (see
+   MPFR_IS_ARENA_ALLOC). */
+
+mpfr_ptr
+mpfr_small_init2 (mpfr_small_ptr x, mpfr_prec_t p)
+{
+  mpfr_ptr y = MPFR_SMALL_PTR (x);
+
+  MPFR_STAT_STATIC_ASSERT (sizeof (x->_mpfr_alloc)
+                           == sizeof (mpfr_size_limb_t));
+
+  if (MPFR_UNLIKELY (p > MPFR_SMALL_PREC_MAX))
+    {
+      /* the significand does not fit: allocate it as usual */
+      mpfr_init2 (y, p);
+      return y;
+    }
+
+  MPFR_ASSERTN (MPFR_PREC_COND (p));
+  MPFR_PREC (y) = p;
+  MPFR_EXP (y) = MPFR_EXP_INVALID;
+  MPFR_SET_POS (y);
+  MPFR_MANT (y) = x->_mpfr_d;
+  MPFR_SET_ALLOC_SIZE (y, - (mp_size_t) MPFR_SMALL_LIMBS);
+  MPFR_SET_NAN (y);
+  return y;
+}
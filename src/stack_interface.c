@@ -102,3 +102,201 @@ mpfr_custom_get_kind (mpfr_srcptr x)
   return (int) MPFR_ZERO_KIND * MPFR_INT_SIGN (x);
 }
 
+
+/* Tables of numbers of the same precision, in a fixed layout which can
+   be stored in a file and mapped into memory (e.g. with mmap), then used
+   in place via the custom interface. The layout is:
+   * a header of MPFR_TABLE_HEADER bytes: the magic string "MPFRTBL1",
+     the sizes in bytes of mp_limb_t, mpfr_exp_t and mpfr_prec_t, the
+     byte order ('L' or 'B'), then at offset 16 the precision, in the
+     native format, and at offset 24 the number n of elements, as an
+     unsigned integer of 8 bytes in this byte order (so that the layout
+     does not depend on the size of unsigned long);
+   * the exponent column: n values of type mpfr_exp_t;
+   * the kind column: n signed bytes, with the values of
+     mpfr_custom_get_kind (thus the sign too);
+   * the limb column, aligned on a limb: n significands of
+     mpfr_custom_get_size(prec) bytes each.
+   Nothing depends on the contents of the limb column until an element is
+   accessed, so that the pages of a mapped file are read only on demand. */
+
+#define MPFR_TABLE_HEADER 32
+
+static unsigned char
+mpfr_table_byte_order (void)
+{
+  union { mp_limb_t l; unsigned char c[sizeof (mp_limb_t)]; } u;
+
+  u.l = 1;
+  return u.c[0] == 1 ? 'L' : 'B';
+}
+
+/* store n in the 8-byte field of the header h */
+static void
+mpfr_table_set_n (unsigned char *h, unsigned long n)
+{
+  int j, big = mpfr_table_byte_order () == 'B';
+
+  for (j = 0; j < 8; j++)
+    {
+      h[24 + (big ? 7 - j : j)] = (unsigned char) (n & 0xff);
+      n >>= 8;
+    }
+}
+
+/* return the number of elements of the table of header h, or return 0
+   and set *ok to 0 if it does not fit in an unsigned long */
+static unsigned long
+mpfr_table_get_n (const unsigned char *h, int *ok)
+{
+  unsigned long n = 0;
+  int j, big = mpfr_table_byte_order () == 'B';
+
+  for (j = 7; j >= 0; j--)
+    {
+      if (n > ULONG_MAX >> 8)
+        {
+          *ok = 0;
+          return 0;
+        }
+      n = (n << 8) | h[24 + (big ? 7 - j : j)];
+    }
+  return n;
+}
+
+/* offset of the limb column */
+static size_t
+mpfr_table_limbs (unsigned long n)
+{
+  size_t off;
+
+  off = MPFR_TABLE_HEADER + (size_t) n * (sizeof (mpfr_exp_t) + 1);
+  return (off + MPFR_BYTES_PER_MP_LIMB - 1)
+    / MPFR_BYTES_PER_MP_LIMB * MPFR_BYTES_PER_MP_LIMB;
+}
+
+size_t
+mpfr_custom_table_size (mpfr_prec_t prec, unsigned long n)
+{
+  return mpfr_table_limbs (n)
+    + (size_t) n * MPFR_PREC2LIMBS (prec) * MPFR_BYTES_PER_MP_LIMB;
+}
+
+void
+mpfr_custom_table_init (void *table, mpfr_prec_t prec, unsigned long n)
+{
+  unsigned char *h = (unsigned char *) table;
+
+  MPFR_ASSERTN (MPFR_PREC_COND (prec));
+  MPFR_STAT_STATIC_ASSERT (sizeof (mpfr_prec_t) <= 8);
+
+  memset (h, 0, MPFR_TABLE_HEADER);
+  memcpy (h, "MPFRTBL1", 8);
+  h[8] = sizeof (mp_limb_t);
+  h[9] = sizeof (mpfr_exp_t);
+  h[10] = sizeof (mpfr_prec_t);
+  h[11] = mpfr_table_byte_order ();
+  memcpy (h + 16, &prec, sizeof (mpfr_prec_t));
+  mpfr_table_set_n (h, n);
+
+  /* all the elements are NaN (MPFR_NAN_KIND is 0); the limb column is
+     not touched */
+  MPFR_STAT_STATIC_ASSERT (MPFR_NAN_KIND == 0);
+  memset (h + MPFR_TABLE_HEADER, 0, (size_t) n * (sizeof (mpfr_exp_t) + 1));
+}
+
+int
+mpfr_custom_table_check (const void *table, size_t size,
+                         mpfr_prec_t *prec, unsigned long *n)
+{
+  const unsigned char *h = (const unsigned char *) table;
+  mpfr_prec_t p;
+  unsigned long m;
+  int ok = 1;
+
+  if (size < MPFR_TABLE_HEADER || memcmp (h, "MPFRTBL1", 8) != 0
+      || h[8] != sizeof (mp_limb_t) || h[9] != sizeof (mpfr_exp_t)
+      || h[10] != sizeof (mpfr_prec_t) || h[11] != mpfr_table_byte_order ())
+    return -1;
+
+  memcpy (&p, h + 16, sizeof (mpfr_prec_t));
+  m = mpfr_table_get_n (h, &ok);
+  if (! ok || ! MPFR_PREC_COND (p))
+    return -1;
+  /* check that the table fits in size bytes, avoiding overflows */
+  if (m > (size - MPFR_TABLE_HEADER) / (sizeof (mpfr_exp_t) + 1 +
+                MPFR_PREC2LIMBS (p) * MPFR_BYTES_PER_MP_LIMB)
+      || mpfr_custom_table_size (p, m) > size)
+    return -1;
+
+  if (prec != NULL)
+    *prec = p;
+  if (n != NULL)
+    *n = m;
+  return 0;
+}
+
+void
+mpfr_custom_table_get (mpfr_ptr x, void *table, unsigned long i)
+{
+  unsigned char *h = (unsigned char *) table;
+  mpfr_prec_t prec;
+  unsigned long n;
+  mpfr_exp_t e;
+  mp_size_t xn;
+  mp_limb_t *xp;
+  int kind, sh, ok = 1;
+
+  memcpy (&prec, h + 16, sizeof (mpfr_prec_t));
+  n = mpfr_table_get_n (h, &ok);
+  MPFR_ASSERTN (ok && i < n);
+
+  xn = MPFR_PREC2LIMBS (prec);
+  xp = (mp_limb_t *) (h + mpfr_table_limbs (n)
+                      + i * xn * MPFR_BYTES_PER_MP_LIMB);
+  e = ((mpfr_exp_t *) (h + MPFR_TABLE_HEADER))[i];
+  kind = ((signed char *) (h + MPFR_TABLE_HEADER + n * sizeof (mpfr_exp_t)))[i];
+  /* invalid data give NaN: for a regular number, the exponent must be in
+     the current range and the significand must be normalized, with its
+     trailing bits set to zero (see mpfr_check) */
+  MPFR_UNSIGNED_MINUS_MODULO (sh, prec);
+  if (kind < - (int) MPFR_REGULAR_KIND || kind > (int) MPFR_REGULAR_KIND
+      || ((kind == MPFR_REGULAR_KIND || kind == - (int) MPFR_REGULAR_KIND)
+          && (! MPFR_EXP_IN_RANGE (e) || ! MPFR_LIMB_MSB (xp[xn - 1])
+              || (xp[0] & MPFR_LIMB_MASK (sh)) != 0)))
+    kind = MPFR_NAN_KIND;
+
+  mpfr_custom_init_set (x, kind, e, prec, xp);
+}
+
+int
+mpfr_custom_table_set (void *table, unsigned long i, mpfr_srcptr x,
+                       mpfr_rnd_t rnd_mode)
+{
+  unsigned char *h = (unsigned char *) table;
+  unsigned long n;
+  mpfr_t y;
+  mpfr_srcptr z;
+  int inex, ok = 1;
+
+  n = mpfr_table_get_n (h, &ok);
+  mpfr_custom_table_get (y, table, i);
+  /* if x is a view of element i (e.g. modified in place), only its kind
+     and its exponent need to be stored */
+  if (MPFR_MANT (x) == MPFR_MANT (y) && MPFR_PREC (x) == MPFR_PREC (y))
+    {
+      z = x;
+      inex = 0;
+    }
+  else
+    {
+      z = y;
+      inex = mpfr_set (y, x, rnd_mode);
+    }
+
+  ((mpfr_exp_t *) (h + MPFR_TABLE_HEADER))[i] =
+    MPFR_IS_SINGULAR (z) ? 0 : MPFR_EXP (z);
+  ((signed char *) (h + MPFR_TABLE_HEADER + n * sizeof (mpfr_exp_t)))[i] =
+    mpfr_custom_get_kind (z);
+  return inex;
+}
@@ -321,8 +321,28 @@ parse_string (mpfr_t x, struct parsed_string *pstr,
     base = 10;
   pstr->base = base;
 
-  /* Alloc mantissa */
-  pstr->alloc = (size_t) strlen (str) + 1;
+  /* Alloc mantissa. Its size is given by the number of digits (which
+     the loop below will read), not by the length of the whole string:
+     the string may be a large buffer containing many numbers (e.g.,
+     CSV data), and each call must not cost its length. */
+  {
+    const char *s;
+    int point_seen = 0;
+
+    for (s = str; ; s++)
+      {
+        int c = (unsigned char) *s;
+        if (c == '.' || c == decimal_point)
+          {
+            if (point_seen)
+              break;
+            point_seen = 1;
+          }
+        else if (digit_value_in_base (c, base) == -1)
+          break;
+      }
+    pstr->alloc = (size_t) (s - str) + 1;
+  }
   pstr->mantissa = (unsigned char*) (*__gmp_allocate_func) (pstr->alloc);
 
   /* Read mantissa digits */
@@ -807,6 +827,393 @@ free_parsed_string (struct parsed_string *pstr)
   (*__gmp_free_func) (pstr->mantissa, pstr->alloc);
 }
 
+/* Maximal number of significant digits and maximal |exponent| for the
+   fast path of mpfr_strtofr, such that 10^digits and 5^exponent fit in
+   a limb. */
+#if GMP_NUMB_BITS >= 64
+# define MPFR_STRTOFR_FAST_DIGITS 19  /* 10^19 < 2^64 */
+# define MPFR_STRTOFR_FAST_POW5 27    /* 5^27 < 2^64 */
+#elif GMP_NUMB_BITS >= 32
+# define MPFR_STRTOFR_FAST_DIGITS 9   /* 10^9 < 2^32 */
+# define MPFR_STRTOFR_FAST_POW5 13    /* 5^13 < 2^32 */
+#else
+# define MPFR_STRTOFR_FAST_DIGITS 0   /* no fast path */
+# define MPFR_STRTOFR_FAST_POW5 0
+#endif
+
+/* Fast path for decimal strings with few significant digits and a small
+   exponent, such as "3.14159" or "-1.2345678901234567e-5": such a string
+   represents w*10^q = (w*5^q)*2^q, or (w/5^(-q))*2^q if q < 0, where w
+   and 5^|q| both fit in a limb. Thus the value can be obtained by one
+   correctly rounded multiplication or division of two exact one-limb
+   numbers, followed by an exact scaling, without any allocation, any
+   conversion with mpn_set_str and any Ziv loop.
+   Return 1 if the string could be handled, in which case x, *string and
+   *res (ternary value) are set; return 0 if the general code must be used.
+   The string is scanned with exactly the same syntax rules as parse_string
+   (in particular for the exponent part and the end of the number); all
+   the unusual cases (hexadecimal prefix, NaN, Inf, '@' exponent, too many
+   digits or too large exponents, ...) are left to the general code. */
+static int
+strtofr_fast (mpfr_t x, const char **string, int base, mpfr_rnd_t rnd,
+              int *res)
+{
+  const char *str = *string;
+  mp_limb_t w = 0, f = 1;
+  mp_limb_t wm[1], fm[1];
+  mpfr_t W, F;
+  int neg, c, cnt, decimal_point;
+  int point = 0, digits = 0, nd = 0;
+  long frac = 0, q, e;
+  MPFR_SAVE_EXPO_DECL (expo);
+
+  if (MPFR_STRTOFR_FAST_DIGITS == 0 || (base != 10 && base != 0))
+    return 0;
+
+  decimal_point = (unsigned char) MPFR_DECIMAL_POINT;
+
+  while (isspace ((unsigned char) *str))
+    str++;
+  neg = (*str == '-');
+  if (*str == '-' || *str == '+')
+    str++;
+  if (base == 0 && str[0] == '0'
+      && (str[1] == 'x' || str[1] == 'X' || str[1] == 'b' || str[1] == 'B'))
+    return 0;
+
+  for (;; str++)
+    {
+      c = (unsigned char) *str;
+      if (c >= '0' && c <= '9')
+        {
+          digits = 1;
+          if (w != 0 || c != '0') /* not a leading zero */
+            {
+              if (++nd > MPFR_STRTOFR_FAST_DIGITS)
+                return 0;
+              w = 10 * w + (c - '0');
+            }
+          frac += point;
+          if (frac > 100000)
+            return 0;
+        }
+      else if ((c == '.' || c == decimal_point) && !point)
+        point = 1;
+      else
+        break;
+    }
+  if (!digits || c == '@')
+    return 0;
+
+  /* optional exponent, read with the same rules as in parse_string */
+  e = 0;
+  if ((c == 'e' || c == 'E') && !isspace ((unsigned char) str[1]))
+    {
+      const char *t = str + 1;
+      int eneg = (*t == '-');
+
+      if (*t == '-' || *t == '+')
+        t++;
+      if (*t >= '0' && *t <= '9')
+        {
+          for (; *t >= '0' && *t <= '9'; t++)
+            {
+              e = 10 * e + (*t - '0');
+              if (e > 100000)
+                return 0;
+            }
+          str = t;
+          if (eneg)
+            e = -e;
+        }
+    }
+
+  if (w == 0)
+    {
+      MPFR_SET_ZERO (x);
+      if (neg)
+        MPFR_SET_NEG (x);
+      else
+        MPFR_SET_POS (x);
+      *res = 0;
+      *string = str;
+      return 1;
+    }
+
+  q = e - frac;
+  if (q > MPFR_STRTOFR_FAST_POW5 || q < -MPFR_STRTOFR_FAST_POW5)
+    return 0;
+  for (e = q < 0 ? -q : q; e > 0; e--)
+    f *= 5;
+
+  MPFR_SAVE_EXPO_MARK (expo);
+  MPFR_TMP_INIT1 (wm, W, GMP_NUMB_BITS);
+  MPFR_TMP_INIT1 (fm, F, GMP_NUMB_BITS);
+  count_leading_zeros (cnt, w);
+  wm[0] = w << cnt;
+  MPFR_EXP (W) = GMP_NUMB_BITS - cnt;
+  if (neg)
+    MPFR_SET_NEG (W);
+  count_leading_zeros (cnt, f);
+  fm[0] = f << cnt;
+  MPFR_EXP (F) = GMP_NUMB_BITS - cnt;
+  *res = (q >= 0) ? mpfr_mul (x, W, F, rnd) : mpfr_div (x, W, F, rnd);
+  mpfr_mul_2si (x, x, q, MPFR_RNDN); /* exact in the extended range */
+  MPFR_SAVE_EXPO_FREE (expo);
+  *res = mpfr_check_range (x, *res, rnd);
+  *string = str;
+  return 1;
+}
+
+/* Maximal absolute value of the digit counts and of the exponents read
+   in strtofr_pow2, so that the binary exponent computed from them can
+   be neither an integer overflow nor out of the extended exponent range
+   (with at most 5 bits per digit, its absolute value is less than
+   11 * MPFR_STRTOFR_POW2_MAX + 6). */
+#define MPFR_STRTOFR_POW2_MAX (MPFR_EMAX_MAX / 16)
+
+/* Fast path for the power-of-two bases 2, 4, 8, 16 and 32: in such a
+   base, each digit gives a fixed number of bits, thus the digits can be
+   packed directly into the significand of x while scanning the string,
+   the bits beyond the precision of x only giving the round bit and the
+   sticky bit. This takes linear time and does not need any memory (the
+   general code stores all the digits in a temporary buffer, converts
+   them with mpn_set_str then rounds the result).
+   Return 1 if the string could be handled, in which case x, *string and
+   *res (ternary value) are set; return 0 if the general code must be
+   used, in which case the exponent and the sign of x are unchanged.
+   The string is scanned with exactly the same syntax rules as in
+   parse_string; NaN, Inf, invalid strings (in particular a "0x" or "0b"
+   prefix not followed by a digit) and huge exponents are left to the
+   general code. */
+static int
+strtofr_pow2 (mpfr_t x, const char **string, int base, mpfr_rnd_t rnd,
+              int *res)
+{
+  const char *str = *string;
+  mp_limb_t *xp = MPFR_MANT (x);
+  mp_size_t xn = MPFR_LIMB_SIZE (x), i;
+  mp_limb_t acc = 0, limb, rb = 0, sticky = 0;
+  const char *start, *pt = NULL;
+  size_t ndigits, nint, nzero;
+  int neg, c, k, nb, sh, decimal_point;
+  int nacc = 0, first_bits = 0, inex = 0;
+  long exp_base = 0, exp_bin = 0;
+  mpfr_exp_t e;
+
+  decimal_point = (unsigned char) MPFR_DECIMAL_POINT;
+
+  while (isspace ((unsigned char) *str))
+    str++;
+  neg = (*str == '-');
+  if (*str == '-' || *str == '+')
+    str++;
+  if ((base == 0 || base == 16) && str[0] == '0'
+      && (str[1] == 'x' || str[1] == 'X'))
+    {
+      base = 16;
+      str += 2;
+    }
+  else if ((base == 0 || base == 2) && str[0] == '0'
+           && (str[1] == 'b' || str[1] == 'B'))
+    {
+      base = 2;
+      str += 2;
+    }
+  switch (base)
+    {
+    case 2:  k = 1; break;
+    case 4:  k = 2; break;
+    case 8:  k = 3; break;
+    case 16: k = 4; break;
+    case 32: k = 5; break;
+    default: return 0;
+    }
+
+  /* Leading zeros, possibly with the point. */
+  start = str;
+  for (;; str++)
+    {
+      c = (unsigned char) *str;
+      if (c == '0')
+        continue;
+      if ((c == '.' || c == decimal_point) && pt == NULL)
+        {
+          pt = str;
+          continue;
+        }
+      break;
+    }
+  nzero = str - start - (pt != NULL);
+
+  /* The bits from the first non-zero digit are accumulated in acc (nacc
+     bits, right aligned), and each complete limb is stored in xp, from
+     the most significant one. Once the xn limbs of x are filled, the next
+     limb gives the round bit and the sticky bit (i is then -1), and the
+     following ones only the sticky bit. */
+  i = xn;
+  c = digit_value_in_base (c, base);
+  if (c != -1)
+    {
+      for (nb = 1; (c >> nb) != 0; nb++)
+        ;
+      first_bits = nb;
+      acc = (mp_limb_t) c;
+      nacc = nb;
+      for (str++; ; str++)
+        {
+          /* same as digit_value_in_base (for base <= 36), inlined */
+          c = (unsigned char) *str;
+          if (c >= '0' && c <= '9')
+            c -= '0';
+          else if (c >= 'a' && c <= 'z')
+            c -= 'a' - 10;
+          else if (c >= 'A' && c <= 'Z')
+            c -= 'A' - 10;
+          else
+            c = MPFR_MAX_BASE;
+          if (c >= base)
+            {
+              if ((*str == '.' || (unsigned char) *str == decimal_point)
+                  && pt == NULL)
+                {
+                  pt = str;
+                  continue;
+                }
+              break;
+            }
+          if (nacc + k < GMP_NUMB_BITS)
+            {
+              acc = (acc << k) | (mp_limb_t) c;
+              nacc += k;
+              continue;
+            }
+          /* a limb is complete; since k <= 5, nacc > 0 */
+          sh = nacc + k - GMP_NUMB_BITS; /* number of bits of c left */
+          limb = (acc << (GMP_NUMB_BITS - nacc)) | ((mp_limb_t) c >> sh);
+          acc = (mp_limb_t) c & MPFR_LIMB_MASK (sh);
+          nacc = sh;
+          if (i > 0)
+            xp[--i] = limb;
+          else if (i == 0)
+            {
+              rb = limb >> (GMP_NUMB_BITS - 1);
+              sticky = limb << 1;
+              i = -1;
+            }
+          else
+            sticky |= limb;
+        }
+    }
+  ndigits = str - start - (pt != NULL);
+  nint = pt != NULL ? pt - start : ndigits;
+  if (ndigits == 0 || nint > (size_t) MPFR_STRTOFR_POW2_MAX
+      || nzero > (size_t) MPFR_STRTOFR_POW2_MAX)
+    return 0;
+
+  /* optional exponent, read with the same rules as in parse_string */
+  if ((*str == '@' || (base <= 10 && (*str == 'e' || *str == 'E')))
+      && !isspace ((unsigned char) str[1]))
+    {
+      char *endptr;
+      long read_exp = strtol (str + 1, &endptr, 10);
+
+      if (read_exp > MPFR_STRTOFR_POW2_MAX
+          || read_exp < - MPFR_STRTOFR_POW2_MAX)
+        return 0;
+      if (endptr != str + 1)
+        str = endptr;
+      exp_base = read_exp;
+    }
+  else if ((base == 2 || base == 16) && (*str == 'p' || *str == 'P')
+           && !isspace ((unsigned char) str[1]))
+    {
+      char *endptr;
+      long read_exp = strtol (str + 1, &endptr, 10);
+
+      if (read_exp > MPFR_STRTOFR_POW2_MAX
+          || read_exp < - MPFR_STRTOFR_POW2_MAX)
+        return 0;
+      if (endptr != str + 1)
+        str = endptr;
+      exp_bin = read_exp;
+    }
+
+  if (first_bits == 0) /* all the digits are zero */
+    {
+      MPFR_SET_ZERO (x);
+      if (neg)
+        MPFR_SET_NEG (x);
+      else
+        MPFR_SET_POS (x);
+      *res = 0;
+      *string = str;
+      return 1;
+    }
+
+  if (nacc > 0) /* last incomplete limb */
+    {
+      limb = acc << (GMP_NUMB_BITS - nacc);
+      if (i > 0)
+        xp[--i] = limb;
+      else if (i == 0)
+        {
+          rb = limb >> (GMP_NUMB_BITS - 1);
+          sticky = limb << 1;
+        }
+      else
+        sticky |= limb;
+    }
+  if (i > 0)
+    MPN_ZERO (xp, i);
+
+  /* The bits of xp[0] beyond the precision of x come before the round
+     bit obtained above. */
+  sh = (int) ((mpfr_prec_t) xn * GMP_NUMB_BITS - MPFR_PREC (x));
+  if (sh > 0)
+    {
+      mp_limb_t low = xp[0] & MPFR_LIMB_MASK (sh);
+
+      sticky |= rb | (low & MPFR_LIMB_MASK (sh - 1));
+      rb = low >> (sh - 1);
+      xp[0] ^= low;
+    }
+
+  /* The value is 0.d1d2d3... * base^nint, where d1 is the first digit
+     (possibly a leading zero). */
+  e = ((mpfr_exp_t) nint - (mpfr_exp_t) nzero) * k - (k - first_bits)
+    + (mpfr_exp_t) exp_base * k + (mpfr_exp_t) exp_bin;
+
+  if (rb != 0 || sticky != 0)
+    {
+      int away;
+
+      if (rnd == MPFR_RNDN)
+        away = rb != 0
+          && (sticky != 0 || (xp[0] & (MPFR_LIMB_ONE << sh)) != 0);
+      else
+        away = ! MPFR_IS_LIKE_RNDZ (rnd, neg);
+      if (away && mpn_add_1 (xp, xp, xn, MPFR_LIMB_ONE << sh))
+        {
+          xp[xn - 1] = MPFR_LIMB_HIGHBIT;
+          e++;
+        }
+      inex = (away != 0) == (neg == 0) ? 1 : -1;
+      if (rnd == MPFR_RNDN && sticky == 0)
+        inex *= 2; /* even rounding, as done by mpfr_round_raw */
+    }
+
+  /* Set sign of x before exp since check_range needs a valid sign */
+  if (neg)
+    MPFR_SET_NEG (x);
+  else
+    MPFR_SET_POS (x);
+  MPFR_EXP (x) = e; /* may be out of the current range */
+  *res = mpfr_check_range (x, inex, rnd);
+  *string = str;
+  return 1;
+}
+
 int
 mpfr_strtofr (mpfr_t x, const char *string, char **end, int base,
               mpfr_rnd_t rnd)
@@ -822,6 +1229,13 @@ mpfr_strtofr (mpfr_t x, const char *string, char **end, int base,
   MPFR_SET_POS (x);
 
   MPFR_STAT_STATIC_ASSERT (MPFR_MAX_BASE >= 62);
+  if (strtofr_fast (x, &string, base, rnd, &res)
+      || strtofr_pow2 (x, &string, base, rnd, &res))
+    {
+      if (end != NULL)
+        *end = (char *) string;
+      return res;
+    }
   res = parse_string (x, &pstr, &string, base);
   /* If res == 0, then it was exact (NAN or INF),
      so it is also the ternary value */
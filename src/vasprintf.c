@@ -87,41 +87,6 @@ static const char num_to_text[] = "0123456789abcdef";
 
 /* some macro and functions for parsing format string */
 
-/* Read an integer; saturate to INT_MAX. */
-#define READ_INT(ap, format, specinfo, field, label_out)                \
-  do {                                                                  \
-    while (*(format))                                                   \
-      {                                                                 \
-        int _i;                                                         \
-        switch (*(format))                                              \
-          {                                                             \
-          case '0':                                                     \
-          case '1':                                                     \
-          case '2':                                                     \
-          case '3':                                                     \
-          case '4':                                                     \
-          case '5':                                                     \
-          case '6':                                                     \
-          case '7':                                                     \
-          case '8':                                                     \
-          case '9':                                                     \
-            specinfo.field = (specinfo.field <= INT_MAX / 10) ?         \
-              specinfo.field * 10 : INT_MAX;                            \
-            _i = *(format) - '0';                                       \
-            MPFR_ASSERTN (_i >= 0 && _i <= 9);                          \
-            specinfo.field = (specinfo.field <= INT_MAX - _i) ?         \
-              specinfo.field + _i : INT_MAX;                            \
-            ++(format);                                                 \
-            break;                                                      \
-          case '*':                                                     \
-            specinfo.field = va_arg ((ap), int);                        \
-            ++(format);                                                 \
-          default:                                                      \
-            goto label_out;                                             \
-          }                                                             \
-      }                                                                 \
-  } while (0)
-
 /* arg_t contains all the types described by the 'type' field of the
    format string */
 enum arg_t
@@ -155,6 +120,7 @@ struct printf_spec
   unsigned int left:1;          /* - flag */
   unsigned int showsign:1;      /* + flag */
   unsigned int group:1;         /* ' flag */
+  unsigned int shortest:1;      /* ~ flag */
 
   int width;                    /* Width */
   int prec;                     /* Precision */
@@ -174,6 +140,7 @@ specinfo_init (struct printf_spec *specinfo)
   specinfo->left = 0;
   specinfo->showsign = 0;
   specinfo->group = 0;
+  specinfo->shortest = 0;
   specinfo->width = 0;
   specinfo->prec = 0;
   specinfo->arg_type = NONE;
@@ -194,6 +161,13 @@ specinfo_init (struct printf_spec *specinfo)
 static int
 specinfo_is_valid (struct printf_spec spec)
 {
+  /* the ~ flag (shortest output) is only valid for the e, f and g
+     conversions of mpfr_t arguments */
+  if (spec.shortest
+      && (spec.arg_type != MPFR_ARG
+          || strchr ("eEfFgG", spec.spec) == NULL || spec.spec == '\0'))
+    return 0;
+
   switch (spec.spec)
     {
     case 'n':
@@ -259,6 +233,11 @@ parse_flags (const char *format, struct printf_spec *specinfo)
           specinfo->group = 1;
           ++format;
           break;
+        case '~':
+          /* MPFR extension: shortest digits that read back to the value */
+          specinfo->shortest = 1;
+          ++format;
+          break;
         default:
           return format;
         }
@@ -352,6 +331,116 @@ parse_arg_type (const char *format, struct printf_spec *specinfo)
   return format;
 }
 
+/* Bits of the STARS argument of parse_spec: the field width, the precision
+   or the rounding mode is given by an argument ('*'). */
+#define STAR_WIDTH 1
+#define STAR_PREC  2
+#define STAR_RND   4
+
+/* Read an integer in *FIELD; saturate to INT_MAX. If it is given by '*',
+   set the bit STAR of *STARS. Return a pointer to the following character. */
+static const char *
+read_int (const char *format, int *field, int *stars, int star)
+{
+  while (*format >= '0' && *format <= '9')
+    {
+      int i = *format - '0';
+
+      *field = (*field <= INT_MAX / 10) ? *field * 10 : INT_MAX;
+      *field = (*field <= INT_MAX - i) ? *field + i : INT_MAX;
+      ++format;
+    }
+  if (*format == '*')
+    {
+      *stars |= star;
+      ++format;
+    }
+  return format;
+}
+
+/* Parse the conversion specification which follows a '%' in FORMAT and
+   fill SPEC accordingly; the fields to be read from the argument list are
+   flagged in *STARS (see READ_STARS). Return a pointer to the conversion
+   specifier character (also stored in SPEC->spec), except if the type is
+   unsupported. */
+static const char *
+parse_spec (const char *format, struct printf_spec *spec, int *stars)
+{
+  specinfo_init (spec);
+  *stars = 0;
+  format = parse_flags (format, spec);
+
+  format = read_int (format, &spec->width, stars, STAR_WIDTH);
+  if (*format == '.')
+    {
+      const char *f = ++format;
+      format = read_int (format, &spec->prec, stars, STAR_PREC);
+      if (f == format)
+        spec->prec = -1;
+    }
+  else
+    spec->prec = -1;
+
+  format = parse_arg_type (format, spec);
+  if (spec->arg_type == UNSUPPORTED)
+    return format;
+  else if (spec->arg_type == MPFR_ARG)
+    {
+      switch (*format)
+        {
+        case '\0':
+          break;
+        case '*':
+          ++format;
+          *stars |= STAR_RND;
+          break;
+        case 'D':
+          ++format;
+          spec->rnd_mode = MPFR_RNDD;
+          break;
+        case 'U':
+          ++format;
+          spec->rnd_mode = MPFR_RNDU;
+          break;
+        case 'Y':
+          ++format;
+          spec->rnd_mode = MPFR_RNDA;
+          break;
+        case 'Z':
+          ++format;
+          spec->rnd_mode = MPFR_RNDZ;
+          break;
+        case 'N':
+          ++format;
+        default:
+          spec->rnd_mode = MPFR_RNDN;
+        }
+    }
+
+  spec->spec = *format;
+  return format;
+}
+
+/* Read from the va_list AP the fields of SPEC given by '*' in the format
+   string, as flagged in STARS by parse_spec. */
+#define READ_STARS(ap, spec, stars)                                     \
+  do {                                                                  \
+    if ((stars) & STAR_WIDTH)                                           \
+      {                                                                 \
+        (spec).width = va_arg ((ap), int);                              \
+        if ((spec).width < 0)                                           \
+          {                                                             \
+            (spec).left = 1;                                            \
+            (spec).width = -(spec).width;                               \
+            MPFR_ASSERTN ((spec).width < INT_MAX);                      \
+          }                                                             \
+      }                                                                 \
+    if ((stars) & STAR_PREC)                                            \
+      (spec).prec = va_arg ((ap), int);                                 \
+    if ((stars) & STAR_RND)                                             \
+      (spec).rnd_mode = (mpfr_rnd_t) va_arg ((ap), int);                \
+  } while (0)
+
 
 /* some macros and functions filling the buffer */
 
@@ -500,11 +589,34 @@ typedef wint_t mpfr_va_wint;
       buffer_cat ((buf_ptr), (start), n);                               \
   } while (0)
 
+/* Output of the formatted string. The characters are written in a buffer,
+   which is:
+   - BUFFER_HEAP: allocated with the memory functions and extended when
+     needed, for mpfr_vasprintf, which returns it;
+   - BUFFER_FIXED: the buffer given by the user to mpfr_sprintf and
+     mpfr_snprintf, of SIZE bytes; the characters which do not fit in it
+     are discarded, but are counted in LEN;
+   - BUFFER_STREAM: a small buffer whose contents are written to the
+     stream FP each time it is full, for mpfr_printf and mpfr_fprintf.
+   Thus only mpfr_vasprintf needs to allocate memory for the output. */
+enum buffer_kind
+  {
+    BUFFER_HEAP,
+    BUFFER_FIXED,
+    BUFFER_STREAM
+  };
+
 struct string_buffer
 {
   char *start;                  /* beginning of the buffer */
   char *curr;                   /* null terminating character */
   size_t size;                  /* buffer capacity */
+  size_t len;                   /* number of characters output so far */
+  enum buffer_kind kind;
+#ifdef _MPFR_H_HAVE_FILE
+  FILE *fp;                     /* output stream (BUFFER_STREAM) */
+#endif
+  int error;                    /* non-zero after an output error */
 };
 
 static void
@@ -514,6 +626,51 @@ buffer_init (struct string_buffer *b, size_t s)
   b->start[0] = '\0';
   b->curr = b->start;
   b->size = s;
+  b->len = 0;
+  b->kind = BUFFER_HEAP;
+  b->error = 0;
+}
+
+/* Use the S bytes at BUF as a buffer, S being possibly zero. */
+static void
+buffer_init_fixed (struct string_buffer *b, char *buf, size_t s)
+{
+  b->start = buf;
+  if (s != 0)
+    b->start[0] = '\0';
+  b->curr = b->start;
+  b->size = s;
+  b->len = 0;
+  b->kind = BUFFER_FIXED;
+  b->error = 0;
+}
+
+#ifdef _MPFR_H_HAVE_FILE
+static void
+buffer_init_stream (struct string_buffer *b, FILE *fp, char *buf, size_t s)
+{
+  MPFR_ASSERTD (s > 1);
+  buffer_init_fixed (b, buf, s);
+  b->kind = BUFFER_STREAM;
+  b->fp = fp;
+}
+#endif
+
+/* Write the contents of the buffer B to its stream, if any, and empty it. */
+static void
+buffer_flush (struct string_buffer *b)
+{
+#ifdef _MPFR_H_HAVE_FILE
+  const size_t pos = b->curr - b->start;
+
+  if (b->kind == BUFFER_STREAM && pos != 0)
+    {
+      if (fwrite (b->start, 1, pos, b->fp) != pos)
+        b->error = 1;
+      b->curr = b->start;
+      *b->curr = '\0';
+    }
+#endif
 }
 
 /* Increase buffer size by a number of character being the least multiple of
@@ -523,6 +680,7 @@ buffer_widen (struct string_buffer *b, size_t len)
 {
   const size_t pos = b->curr - b->start;
   const size_t n = 0x1000 + (len & ~((size_t) 0xfff));
+  MPFR_ASSERTD (b->kind == BUFFER_HEAP);
   MPFR_ASSERTD (pos < b->size);
 
   MPFR_ASSERTN ((len & ~((size_t) 4095)) <= (size_t)(SIZE_MAX - 4096));
@@ -537,42 +695,80 @@ buffer_widen (struct string_buffer *b, size_t len)
   MPFR_ASSERTD (*b->curr == '\0');
 }
 
+/* Return the number of characters, at most LEN, which can be written at
+   b->curr (followed by a null character), after extending or flushing
+   the buffer B if need be. It is less than LEN only if the buffer is a
+   stream buffer (the rest must be written after another call) or a full
+   fixed-size buffer. */
+static size_t
+buffer_room (struct string_buffer *b, size_t len)
+{
+  size_t pos, avail;
+
+  if (b->size == 0)
+    return 0;
+  pos = b->curr - b->start;
+  if (b->kind == BUFFER_HEAP)
+    {
+      if (MPFR_UNLIKELY (pos + len >= b->size))
+        buffer_widen (b, len);
+      return len;
+    }
+  if (b->kind == BUFFER_STREAM && pos + len >= b->size)
+    {
+      buffer_flush (b);
+      pos = 0;
+    }
+  avail = b->size - 1 - pos;
+  return len < avail ? len : avail;
+}
+
 /* Concatenate the LEN first characters of the string S to the buffer B and
    expand it if needed. */
 static void
 buffer_cat (struct string_buffer *b, const char *s, size_t len)
 {
+  size_t n;
+
   MPFR_ASSERTD (len != 0);
   MPFR_ASSERTD (len <= strlen (s));
+  MPFR_ASSERTN (b->len <= SIZE_MAX - len);
 
-  if (MPFR_UNLIKELY ((b->curr + len) >= (b->start + b->size)))
-    buffer_widen (b, len);
-
-  strncat (b->curr, s, len);
-  b->curr += len;
-
-  MPFR_ASSERTD (b->curr < b->start + b->size);
-  MPFR_ASSERTD (*b->curr == '\0');
+  b->len += len;
+  while ((n = buffer_room (b, len)) != 0)
+    {
+      memcpy (b->curr, s, n);
+      b->curr += n;
+      *b->curr = '\0';
+      s += n;
+      len -= n;
+      if (len == 0)
+        break;
+    }
 }
 
 /* Add N characters C to the end of buffer B */
 static void
-buffer_pad (struct string_buffer *b, const char c, const size_t n)
+buffer_pad (struct string_buffer *b, const char c, size_t n)
 {
-  MPFR_ASSERTD (n != 0);
-
-  MPFR_ASSERTN (b->size < SIZE_MAX - n - 1);
-  if (MPFR_UNLIKELY ((b->curr + n + 1) > (b->start + b->size)))
-    buffer_widen (b, n);
+  size_t k;
 
-  if (n == 1)
-    *b->curr = c;
-  else
-    memset (b->curr, c, n);
-  b->curr += n;
-  *b->curr = '\0';
+  MPFR_ASSERTD (n != 0);
+  MPFR_ASSERTN (b->len <= SIZE_MAX - n);
 
-  MPFR_ASSERTD (b->curr < b->start + b->size);
+  b->len += n;
+  while ((k = buffer_room (b, n)) != 0)
+    {
+      if (k == 1)
+        *b->curr = c;
+      else
+        memset (b->curr, c, k);
+      b->curr += k;
+      *b->curr = '\0';
+      n -= k;
+      if (n == 0)
+        break;
+    }
 }
 
 /* Form a string by concatenating the first LEN characters of STR to TZ
@@ -586,7 +782,7 @@ buffer_sandwich (struct string_buffer *b, char *str, size_t len,
   const size_t size = len + tz;
   const size_t r = size % step == 0 ? step : size % step;
   const size_t q = size % step == 0 ? size / step - 1 : size / step;
-  size_t i;
+  size_t i, pos, g, n;
 
   MPFR_ASSERTD (size != 0);
   if (c == '\0')
@@ -596,48 +792,21 @@ buffer_sandwich (struct string_buffer *b, char *str, size_t len,
       return;
     }
 
-  MPFR_ASSERTN (b->size < SIZE_MAX - size - 1 - q);
   MPFR_ASSERTD (len <= strlen (str));
-  if (MPFR_UNLIKELY ((b->curr + size + 1 + q) > (b->start + b->size)))
-    buffer_widen (b, size + q);
 
-  /* first R significant digits */
-  memcpy (b->curr, str, r);
-  b->curr += r;
-  str += r;
-  len -= r;
-
-  /* blocks of thousands. Warning: STR might end in the middle of a block */
-  for (i = 0; i < q; ++i)
+  /* first R significant digits, then blocks of thousands. Warning: STR
+     might end in the middle of a block, which is then filled up with
+     zeros */
+  for (i = 0, pos = 0, g = r; i <= q; i++, pos += g, g = step)
     {
-      *b->curr++ = c;
-      if (MPFR_LIKELY (len > 0))
-        {
-          if (MPFR_LIKELY (len >= step))
-            /* step significant digits */
-            {
-              memcpy (b->curr, str, step);
-              len -= step;
-            }
-          else
-            /* last digits in STR, fill up thousand block with zeros */
-            {
-              memcpy (b->curr, str, len);
-              memset (b->curr + len, '0', step - len);
-              len = 0;
-            }
-        }
-      else
-        /* trailing zeros */
-        memset (b->curr, '0', step);
-
-      b->curr += step;
-      str += step;
+      if (i != 0)
+        buffer_pad (b, c, 1);
+      n = pos >= len ? 0 : len - pos < g ? len - pos : g;
+      if (n != 0)
+        buffer_cat (b, str + pos, n);
+      if (n < g)
+        buffer_pad (b, '0', g - n);
     }
-
-  *b->curr = '\0';
-
-  MPFR_ASSERTD (b->curr < b->start + b->size);
 }
 
 /* let gmp_xprintf process the part it can understand */
@@ -645,13 +814,57 @@ static int
 sprntf_gmp (struct string_buffer *b, const char *fmt, va_list ap)
 {
   int length;
-  char *s;
+  size_t avail;
+  va_list ap2;
 
-  length = gmp_vasprintf (&s, fmt, ap);
-  if (length > 0)
-    buffer_cat (b, s, length);
+#ifdef _MPFR_H_HAVE_FILE
+  if (b->kind == BUFFER_STREAM)
+    {
+      buffer_flush (b);
+      length = gmp_vfprintf (b->fp, fmt, ap);
+      if (length > 0)
+        b->len += length;
+      return length;
+    }
+#endif
 
-  mpfr_free_str (s);
+  /* Try to output directly in the buffer. */
+  avail = b->size - (b->curr - b->start);
+  va_copy (ap2, ap);
+  length = gmp_vsnprintf (b->curr, avail, fmt, ap2);
+  va_end (ap2);
+  if (length <= 0)
+    return length;
+  b->len += length;
+  if ((size_t) length < avail)
+    b->curr += length;
+  else if (b->kind == BUFFER_FIXED)
+    {
+      /* the output has been truncated, the buffer is full */
+      if (avail != 0)
+        b->curr += avail - 1;
+    }
+  else
+    {
+      /* BUFFER_HEAP: extend the buffer and output again */
+      *b->curr = '\0';
+      buffer_widen (b, length);
+      gmp_vsnprintf (b->curr, length + 1, fmt, ap);
+      b->curr += length;
+    }
+  return length;
+}
+
+/* sprntf_gmp with a variable number of arguments */
+static int
+sprntf_gmp_va (struct string_buffer *b, const char *fmt, ...)
+{
+  va_list ap;
+  int length;
+
+  va_start (ap, fmt);
+  length = sprntf_gmp (b, fmt, ap);
+  va_end (ap);
   return length;
 }
 
@@ -671,12 +884,15 @@ init_string_list (struct string_list *sl)
   sl->next = NULL;
 }
 
-/* clear all strings in the list */
+/* clear all strings in the list; the first node, which does not hold any
+   string, is not freed (it is not allocated by register_string) */
 static void
 clear_string_list (struct string_list *sl)
 {
   struct string_list *n;
 
+  MPFR_ASSERTD (sl->string == NULL);
+  sl = sl->next;
   while (sl)
     {
       if (sl->string)
@@ -742,11 +958,81 @@ struct number_parts
   char *exp_ptr;          /* Pointer to exponent part */
   size_t exp_size;        /* Number of characters in *exp_ptr */
 
-  struct string_list *sl; /* List of string buffers in use: we need such a
+  struct string_list sl;  /* List of string buffers in use: we need such a
                              mechanism because fp_ptr may point into the same
                              string as ip_ptr */
+  size_t scratch_used;    /* Number of bytes used in the scratch area, or
+                             (size_t) -1 if it is used by another call */
 };
 
+/* Scratch area for the strings of a conversion: they are usually small
+   and all freed at the end of the conversion, so that they are allocated
+   in this buffer, local to each thread and reused by each conversion,
+   instead of being allocated and freed one by one. The strings that do
+   not fit in it are allocated as usual and registered in np->sl. The
+   scratch area is not used by a nested call (e.g., for logging in a
+   function called by partition_number). */
+#ifndef MPFR_PRINTF_SCRATCH_SIZE
+# define MPFR_PRINTF_SCRATCH_SIZE 512
+#endif
+static MPFR_THREAD_ATTR char scratch_area[MPFR_PRINTF_SCRATCH_SIZE];
+static MPFR_THREAD_ATTR int scratch_in_use = 0;
+
+static void
+init_number_parts_strings (struct number_parts *np)
+{
+  init_string_list (&np->sl);
+  if (scratch_in_use)
+    np->scratch_used = (size_t) -1;
+  else
+    {
+      scratch_in_use = 1;
+      np->scratch_used = 0;
+    }
+}
+
+static void
+clear_number_parts_strings (struct number_parts *np)
+{
+  clear_string_list (&np->sl);
+  if (np->scratch_used != (size_t) -1)
+    scratch_in_use = 0;
+}
+
+/* Return a buffer of N bytes for a string of length N-1 of np; if it
+   is allocated with the memory functions, it must be filled as it is
+   freed with mpfr_free_str. */
+static char *
+np_alloc (struct number_parts *np, size_t n)
+{
+  if (np->scratch_used <= MPFR_PRINTF_SCRATCH_SIZE
+      && n <= MPFR_PRINTF_SCRATCH_SIZE - np->scratch_used)
+    {
+      char *str = scratch_area + np->scratch_used;
+      np->scratch_used += n;
+      return str;
+    }
+  return register_string (&np->sl, (char *) (*__gmp_allocate_func) (n));
+}
+
+/* mpfr_get_str for np: the result is in the scratch area if possible,
+   i.e., if the number of digits M is given. */
+static char *
+np_get_str (struct number_parts *np, mpfr_exp_t *e, int b, size_t m,
+            mpfr_srcptr x, mpfr_rnd_t rnd)
+{
+  if (m != 0 && np->scratch_used <= MPFR_PRINTF_SCRATCH_SIZE
+      && m + 2 <= MPFR_PRINTF_SCRATCH_SIZE - np->scratch_used)
+    {
+      /* sign, m digits and the terminating null character */
+      char *str = mpfr_get_str (scratch_area + np->scratch_used, e, b, m,
+                                x, rnd);
+      np->scratch_used += m + 2;
+      return str;
+    }
+  return register_string (&np->sl, mpfr_get_str (NULL, e, b, m, x, rnd));
+}
+
 /* For a real non zero number x, what is the base exponent f when rounding x
    with rounding mode r to r(x) = m*b^f, where m is a digit and 1 <= m < b ?
    Return non zero value if x is rounded up to b^f, return zero otherwise */
@@ -844,11 +1130,11 @@ regular_ab (struct number_parts *np, mpfr_srcptr p,
     /* prefix part */
     {
       np->prefix_size = 2;
-      str = (char *) (*__gmp_allocate_func) (1 + np->prefix_size);
+      str = np_alloc (np, 1 + np->prefix_size);
       str[0] = '0';
       str[1] = uppercase ? 'X' : 'x';
       str[2] = '\0';
-      np->prefix_ptr = register_string (np->sl, str);
+      np->prefix_ptr = str;
     }
 
   /* integral part */
@@ -864,8 +1150,7 @@ regular_ab (struct number_parts *np, mpfr_srcptr p,
          - if a non-zero precision is specified, then one digit before decimal
          point plus SPEC.PREC after it. */
       nsd = spec.prec < 0 ? 0 : spec.prec + np->ip_size;
-      str = mpfr_get_str (0, &exp, base, nsd, p, spec.rnd_mode);
-      register_string (np->sl, str);
+      str = np_get_str (np, &exp, base, nsd, p, spec.rnd_mode);
       np->ip_ptr = MPFR_IS_NEG (p) ? ++str : str;  /* skip sign if any */
 
       if (base == 16)
@@ -890,19 +1175,19 @@ regular_ab (struct number_parts *np, mpfr_srcptr p,
     }
   else if (next_base_power_p (p, base, spec.rnd_mode))
     {
-      str = (char *)(*__gmp_allocate_func) (2);
+      str = np_alloc (np, 2);
       str[0] = '1';
       str[1] = '\0';
-      np->ip_ptr = register_string (np->sl, str);
+      np->ip_ptr = str;
 
       exp = MPFR_GET_EXP (p);
     }
   else if (base == 2)
     {
-      str = (char *)(*__gmp_allocate_func) (2);
+      str = np_alloc (np, 2);
       str[0] = '1';
       str[1] = '\0';
-      np->ip_ptr = register_string (np->sl, str);
+      np->ip_ptr = str;
 
       exp = MPFR_GET_EXP (p) - 1;
     }
@@ -922,10 +1207,10 @@ regular_ab (struct number_parts *np, mpfr_srcptr p,
         digit++;
       MPFR_ASSERTD ((0 <= digit) && (digit <= 15));
 
-      str = (char *)(*__gmp_allocate_func) (1 + np->ip_size);
+      str = np_alloc (np, 1 + np->ip_size);
       str[0] = num_to_text [digit];
       str[1] = '\0';
-      np->ip_ptr = register_string (np->sl, str);
+      np->ip_ptr = str;
 
       exp = MPFR_GET_EXP (p) - 4;
     }
@@ -1015,8 +1300,8 @@ regular_ab (struct number_parts *np, mpfr_srcptr p,
         x /= 10;
       }
   }
-  str = (char *) (*__gmp_allocate_func) (1 + np->exp_size);
-  np->exp_ptr = register_string (np->sl, str);
+  str = np_alloc (np, 1 + np->exp_size);
+  np->exp_ptr = str;
   {
     char exp_fmt[8];  /* contains at most 7 characters like in "p%+.1i",
                          or "P%+.2li" */
@@ -1068,8 +1353,7 @@ regular_eg (struct number_parts *np, mpfr_srcptr p,
          We use the fact here that mpfr_get_str allows us to ask for only one
          significant digit when the base is not a power of 2. */
       nsd = (spec.prec < 0) ? 0 : spec.prec + np->ip_size;
-      str = mpfr_get_str (0, &exp, 10, nsd, p, spec.rnd_mode);
-      register_string (np->sl, str);
+      str = np_get_str (np, &exp, 10, nsd, p, spec.rnd_mode);
     }
   else
     {
@@ -1142,8 +1426,8 @@ regular_eg (struct number_parts *np, mpfr_srcptr p,
   if (np->exp_size < 4)
     np->exp_size = 4;
 
-  str = (char *) (*__gmp_allocate_func) (1 + np->exp_size);
-  np->exp_ptr = register_string (np->sl, str);
+  str = np_alloc (np, 1 + np->exp_size);
+  np->exp_ptr = str;
 
   {
     char exp_fmt[8];  /* e.g. "e%+.2i", or "E%+.2li" */
@@ -1188,10 +1472,10 @@ regular_fg (struct number_parts *np, mpfr_srcptr p,
     {
       /* Most of the time, integral part is 0 */
       np->ip_size = 1;
-      str = (char *) (*__gmp_allocate_func) (1 + np->ip_size);
+      str = np_alloc (np, 1 + np->ip_size);
       str[0] = '0';
       str[1] = '\0';
-      np->ip_ptr = register_string (np->sl, str);
+      np->ip_ptr = str;
 
       if (spec.prec == 0)
         /* only two possibilities: either 1 or 0. */
@@ -1260,11 +1544,10 @@ regular_fg (struct number_parts *np, mpfr_srcptr p,
                   np->fp_leading_zeros = spec.prec - 1;
 
                   np->fp_size = 1;
-                  str =
-                    (char *) (*__gmp_allocate_func) (1 + np->fp_size);
+                  str = np_alloc (np, 1 + np->fp_size);
                   str[0] = '1';
                   str[1] = '\0';
-                  np->fp_ptr = register_string (np->sl, str);
+                  np->fp_ptr = str;
                 }
               else
                 /* only zeros in fractional part */
@@ -1287,8 +1570,7 @@ regular_fg (struct number_parts *np, mpfr_srcptr p,
                      base ten (undocumented feature, see comments in
                      get_str.c) */
 
-                  str = mpfr_get_str (NULL, &exp, 10, nsd, p, spec.rnd_mode);
-                  register_string (np->sl, str);
+                  str = np_get_str (np, &exp, 10, nsd, p, spec.rnd_mode);
                 }
               else
                 {
@@ -1360,9 +1642,7 @@ regular_fg (struct number_parts *np, mpfr_srcptr p,
 
       if (dec_info == NULL)
         { /* this case occurs with mpfr_printf ("%.0RUf", x) with x=9.5 */
-          str =
-            mpfr_get_str (NULL, &exp, 10, spec.prec+exp+1, p, spec.rnd_mode);
-          register_string (np->sl, str);
+          str = np_get_str (np, &exp, 10, spec.prec+exp+1, p, spec.rnd_mode);
         }
       else
         {
@@ -1429,6 +1709,49 @@ regular_fg (struct number_parts *np, mpfr_srcptr p,
   return 0;
 }
 
+/* Determine the different parts of the string representation of the regular
+   number P when the ~ flag is used: the digits are the shortest decimal
+   digits that read back to P in its precision, as given by
+   mpfr_get_str_shortest; they are displayed with style spec.spec as if
+   the precision field were such that all of them, and only them, are output.
+   The precision and rounding fields are ignored.
+
+   return -1 if some field of number_parts is greater than INT_MAX */
+static int
+regular_shortest (struct number_parts *np, mpfr_srcptr p,
+                  struct printf_spec spec)
+{
+  struct decimal_info dec_info;
+  size_t n;
+
+  dec_info.str = mpfr_get_str_shortest (NULL, &dec_info.exp, 10, p);
+  register_string (&np->sl, dec_info.str);
+  n = strlen (dec_info.str) - MPFR_IS_NEG (p); /* number of digits */
+  if (n > INT_MAX)
+    return -1;
+  spec.rnd_mode = MPFR_RNDN;
+
+  if (spec.spec == 'e' || spec.spec == 'E'
+      || ((spec.spec == 'g' || spec.spec == 'G')
+          && (dec_info.exp - 1 >= (mpfr_exp_t) n || dec_info.exp - 1 < -4)))
+    {
+      /* style 'e' with n-1 digits after the decimal point */
+      spec.prec = n - 1;
+      return regular_eg (np, p, spec, &dec_info);
+    }
+  else
+    {
+      /* style 'f' with the digits after the decimal point, if any */
+      if (dec_info.exp >= (mpfr_exp_t) n)
+        spec.prec = 0;
+      else if ((mpfr_exp_t) n - dec_info.exp > INT_MAX)
+        return -1;
+      else
+        spec.prec = n - dec_info.exp;
+      return regular_fg (np, p, spec, &dec_info);
+    }
+}
+
 /* partition_number determines the different parts of the string
    representation of the number p according to the given specification.
    partition_number initializes the given structure np, so all previous
@@ -1461,9 +1784,7 @@ partition_number (struct number_parts *np, mpfr_srcptr p,
   np->fp_trailing_zeros = 0;
   np->exp_ptr = NULL;
   np->exp_size = 0;
-  np->sl = (struct string_list *)
-    (*__gmp_allocate_func) (sizeof (struct string_list));
-  init_string_list (np->sl);
+  init_number_parts_strings (np);
 
   uppercase = spec.spec == 'A' || spec.spec == 'E' || spec.spec == 'F'
     || spec.spec == 'G';
@@ -1478,9 +1799,9 @@ partition_number (struct number_parts *np, mpfr_srcptr p,
             np->pad_type = LEFT;
 
           np->ip_size = MPFR_NAN_STRING_LENGTH;
-          str = (char *) (*__gmp_allocate_func) (1 + np->ip_size);
+          str = np_alloc (np, 1 + np->ip_size);
           strcpy (str, uppercase ? MPFR_NAN_STRING_UC : MPFR_NAN_STRING_LC);
-          np->ip_ptr = register_string (np->sl, str);
+          np->ip_ptr = str;
         }
       else if (MPFR_IS_INF (p))
         {
@@ -1493,9 +1814,9 @@ partition_number (struct number_parts *np, mpfr_srcptr p,
             np->sign = '-';
 
           np->ip_size = MPFR_INF_STRING_LENGTH;
-          str = (char *) (*__gmp_allocate_func) (1 + np->ip_size);
+          str = np_alloc (np, 1 + np->ip_size);
           strcpy (str, uppercase ? MPFR_INF_STRING_UC : MPFR_INF_STRING_LC);
-          np->ip_ptr = register_string (np->sl, str);
+          np->ip_ptr = str;
         }
       else
         {
@@ -1513,19 +1834,19 @@ partition_number (struct number_parts *np, mpfr_srcptr p,
             /* prefix part */
             {
               np->prefix_size = 2;
-              str = (char *) (*__gmp_allocate_func) (1 + np->prefix_size);
+              str = np_alloc (np, 1 + np->prefix_size);
               str[0] = '0';
               str[1] = uppercase ? 'X' : 'x';
               str[2] = '\0';
-              np->prefix_ptr = register_string (np->sl, str);
+              np->prefix_ptr = str;
             }
 
           /* integral part */
           np->ip_size = 1;
-          str = (char *) (*__gmp_allocate_func) (1 + np->ip_size);
+          str = np_alloc (np, 1 + np->ip_size);
           str[0] = '0';
           str[1] = '\0';
-          np->ip_ptr = register_string (np->sl, str);
+          np->ip_ptr = str;
 
           if (spec.prec > 0
               && ((spec.spec != 'g' && spec.spec != 'G') || spec.alt))
@@ -1543,12 +1864,12 @@ partition_number (struct number_parts *np, mpfr_srcptr p,
             /* exponent part */
             {
               np->exp_size = (spec.spec == 'e' || spec.spec == 'E') ? 4 : 3;
-              str = (char *) (*__gmp_allocate_func) (1 + np->exp_size);
+              str = np_alloc (np, 1 + np->exp_size);
               if (spec.spec == 'e' || spec.spec == 'E')
                 strcpy (str, uppercase ? "E+00" : "e+00");
               else
                 strcpy (str, uppercase ? "P+0" : "p+0");
-              np->exp_ptr = register_string (np->sl, str);
+              np->exp_ptr = str;
             }
         }
     }
@@ -1565,15 +1886,20 @@ partition_number (struct number_parts *np, mpfr_srcptr p,
         np->sign = '-';
 
       np->ip_size = 3;
-      str = (char *) (*__gmp_allocate_func) (1 + np->ip_size);
+      str = np_alloc (np, 1 + np->ip_size);
       strcpy (str, uppercase ? "UBF" : "ubf");
-      np->ip_ptr = register_string (np->sl, str);
+      np->ip_ptr = str;
       /* TODO: output more information (e.g. the exponent) if need be. */
     }
   else
     {
       MPFR_ASSERTD (MPFR_IS_PURE_FP (p));
-      if (spec.spec == 'a' || spec.spec == 'A' || spec.spec == 'b')
+      if (spec.shortest)
+        {
+          if (regular_shortest (np, p, spec) == -1)
+            goto error;
+        }
+      else if (spec.spec == 'a' || spec.spec == 'A' || spec.spec == 'b')
         {
           if (regular_ab (np, p, spec) == -1)
             goto error;
@@ -1605,9 +1931,8 @@ partition_number (struct number_parts *np, mpfr_srcptr p,
           struct decimal_info dec_info;
 
           threshold = (spec.prec < 0) ? 6 : (spec.prec == 0) ? 1 : spec.prec;
-          dec_info.str = mpfr_get_str (NULL, &dec_info.exp, 10, threshold,
-                                        p, spec.rnd_mode);
-          register_string (np->sl, dec_info.str);
+          dec_info.str = np_get_str (np, &dec_info.exp, 10, threshold,
+                                     p, spec.rnd_mode);
           /* mpfr_get_str corresponds to a significand between 0.1 and 1,
              whereas here we want a significand between 1 and 10. */
           x = dec_info.exp - 1;
@@ -1672,7 +1997,7 @@ partition_number (struct number_parts *np, mpfr_srcptr p,
   return total;
 
  error:
-  clear_string_list (np->sl);
+  clear_number_parts_strings (np);
   np->prefix_ptr = NULL;
   np->ip_ptr = NULL;
   np->fp_ptr = NULL;
@@ -1750,31 +2075,127 @@ sprnt_fp (struct string_buffer *buf, mpfr_srcptr p,
   if (np.pad_type == RIGHT && np.pad_size != 0)
     buffer_pad (buf, ' ', np.pad_size);
 
-  clear_string_list (np.sl);
+  clear_number_parts_strings (&np);
   return length;
 }
 
-int
-mpfr_vasprintf (char **ptr, const char *fmt, va_list ap)
+/* Store NCHAR, the number of characters output so far, in the object
+   pointed to by P, whose type is given by SPEC (%n conversion). The types
+   accepted are the same as in GMP (except unsupported quad_t) plus mpfr_t,
+   so as to be able to accept the same format strings. N is the size of the
+   mp_limb_t array for the MP_LIMB_ARRAY_ARG type. */
+static void
+store_count (void *p, const struct printf_spec *spec, size_t nchar,
+             mp_size_t n)
+{
+  switch (spec->arg_type)
+    {
+    case CHAR_ARG:
+      *(char *) p = (char) nchar;
+      break;
+    case SHORT_ARG:
+      *(short *) p = (short) nchar;
+      break;
+    case LONG_ARG:
+      *(long *) p = (long) nchar;
+      break;
+#ifdef HAVE_LONG_LONG
+    case LONG_LONG_ARG:
+      *(long long *) p = (long long) nchar;
+      break;
+#endif
+#ifdef _MPFR_H_HAVE_INTMAX_T
+    case INTMAX_ARG:
+      *(intmax_t *) p = (intmax_t) nchar;
+      break;
+#endif
+    case SIZE_ARG:
+      *(size_t *) p = nchar;
+      break;
+    case PTRDIFF_ARG:
+      *(ptrdiff_t *) p = (ptrdiff_t) nchar;
+      break;
+    case MPF_ARG:
+      mpf_set_ui ((mpf_ptr) p, (unsigned long) nchar);
+      break;
+    case MPQ_ARG:
+      mpq_set_ui ((mpq_ptr) p, (unsigned long) nchar, 1L);
+      break;
+    case MP_LIMB_ARG:
+      *(mp_limb_t *) p = (mp_limb_t) nchar;
+      break;
+    case MP_LIMB_ARRAY_ARG:
+      {
+        mp_limb_t *q = (mp_limb_t *) p;
+        if (n < 0)
+          n = -n;
+        else if (n == 0)
+          break;
+
+        /* we assume here that mp_limb_t is wider than int */
+        *q = (mp_limb_t) nchar;
+        while (--n != 0)
+          {
+            q++;
+            *q = MPFR_LIMB_ZERO;
+          }
+      }
+      break;
+    case MPZ_ARG:
+      mpz_set_ui ((mpz_ptr) p, (unsigned long) nchar);
+      break;
+
+    case MPFR_ARG:
+      mpfr_set_ui ((mpfr_ptr) p, (unsigned long) nchar,
+                   spec->rnd_mode);
+      break;
+
+    default:
+      *(int *) p = (int) nchar;
+    }
+}
+
+/* Write in FORMAT the format string for gmp_printf outputting a mpfr_prec_t
+   with conversion specifier SPEC and the width and precision given as
+   arguments, like "%*.*hd" "%*.*d" or "%*.*ld". FORMAT must have room for
+   MPFR_PREC_FORMAT_SIZE + 6 characters. */
+static void
+prec_format (char *format, char spec)
+{
+  format[0] = '%';
+  format[1] = '*';
+  format[2] = '.';
+  format[3] = '*';
+  format[4] = '\0';
+  strcat (format, MPFR_PREC_FORMAT_TYPE);
+  format[4 + MPFR_PREC_FORMAT_SIZE] = spec;
+  format[5 + MPFR_PREC_FORMAT_SIZE] = '\0';
+}
+
+/* Output the formatted string in the buffer BUF (see struct
+   string_buffer).
+   Return the number of characters of the formatted string (possibly not
+   all written in a fixed-size buffer), or -1 in case of error, in which
+   case the buffer contents are undefined. */
+static int
+buffer_vprintf (struct string_buffer *buf, const char *fmt, va_list ap)
 {
-  struct string_buffer buf;
   size_t nbchar;
 
   /* informations on the conversion specification filled by the parser */
   struct printf_spec spec;
+  int stars;
   /* flag raised when previous part of fmt need to be processed by
      gmp_vsnprintf */
   int xgmp_fmt_flag;
   /* beginning and end of the previous unprocessed part of fmt */
   const char *start, *end;
-  /* pointer to arguments for gmp_vasprintf */
+  /* pointer to arguments for gmp_vsnprintf */
   va_list ap2;
 
   MPFR_SAVE_EXPO_DECL (expo);
   MPFR_SAVE_EXPO_MARK (expo);
 
-  nbchar = 0;
-  buffer_init (&buf, 4096);
   xgmp_fmt_flag = 0;
   va_copy (ap2, ap);
   start = fmt;
@@ -1800,29 +2221,8 @@ mpfr_vasprintf (char **ptr, const char *fmt, va_list ap)
       end = fmt - 1;
 
       /* format string analysis */
-      specinfo_init (&spec);
-      fmt = parse_flags (fmt, &spec);
-
-      READ_INT (ap, fmt, spec, width, width_analysis);
-    width_analysis:
-      if (spec.width < 0)
-        {
-          spec.left = 1;
-          spec.width = -spec.width;
-          MPFR_ASSERTN (spec.width < INT_MAX);
-        }
-      if (*fmt == '.')
-        {
-          const char *f = ++fmt;
-          READ_INT (ap, fmt, spec, prec, prec_analysis);
-        prec_analysis:
-          if (f == fmt)
-            spec.prec = -1;
-        }
-      else
-        spec.prec = -1;
-
-      fmt = parse_arg_type (fmt, &spec);
+      fmt = parse_spec (fmt, &spec, &stars);
+      READ_STARS (ap, spec, stars);
       if (spec.arg_type == UNSUPPORTED)
         /* the current architecture doesn't support the type corresponding to
            the format specifier; according to the ISO C99 standard, the
@@ -1830,40 +2230,7 @@ mpfr_vasprintf (char **ptr, const char *fmt, va_list ap)
            literal string, what may be printed after this string is
            undefined. */
         continue;
-      else if (spec.arg_type == MPFR_ARG)
-        {
-          switch (*fmt)
-            {
-            case '\0':
-              break;
-            case '*':
-              ++fmt;
-              spec.rnd_mode = (mpfr_rnd_t) va_arg (ap, int);
-              break;
-            case 'D':
-              ++fmt;
-              spec.rnd_mode = MPFR_RNDD;
-              break;
-            case 'U':
-              ++fmt;
-              spec.rnd_mode = MPFR_RNDU;
-              break;
-            case 'Y':
-              ++fmt;
-              spec.rnd_mode = MPFR_RNDA;
-              break;
-            case 'Z':
-              ++fmt;
-              spec.rnd_mode = MPFR_RNDZ;
-              break;
-            case 'N':
-              ++fmt;
-            default:
-              spec.rnd_mode = MPFR_RNDN;
-            }
-        }
 
-      spec.spec = *fmt;
       if (!specinfo_is_valid (spec))
         /* the format specifier is invalid; according to the ISO C99 standard,
            the behavior is undefined. We choose to print the invalid format
@@ -1880,123 +2247,38 @@ mpfr_vasprintf (char **ptr, const char *fmt, va_list ap)
         break;
       else if (spec.spec == 'n')
         /* put the number of characters written so far in the location pointed
-           by the next va_list argument; the types of pointer accepted are the
-           same as in GMP (except unsupported quad_t) plus pointer to a mpfr_t
-           so as to be able to accept the same format strings. */
+           by the next va_list argument (see store_count) */
         {
           void *p;
-          size_t nchar;
+          mp_size_t nlimbs = 0;
 
           p = va_arg (ap, void *);
-          FLUSH (xgmp_fmt_flag, start, end, ap2, &buf);
+          if (spec.arg_type == MP_LIMB_ARRAY_ARG)
+            nlimbs = va_arg (ap, mp_size_t);
+          FLUSH (xgmp_fmt_flag, start, end, ap2, buf);
           va_end (ap2);
+          va_copy (ap2, ap);
           start = fmt;
-          nchar = buf.curr - buf.start;
-
-          switch (spec.arg_type)
-            {
-            case CHAR_ARG:
-              *(char *) p = (char) nchar;
-              break;
-            case SHORT_ARG:
-              *(short *) p = (short) nchar;
-              break;
-            case LONG_ARG:
-              *(long *) p = (long) nchar;
-              break;
-#ifdef HAVE_LONG_LONG
-            case LONG_LONG_ARG:
-              *(long long *) p = (long long) nchar;
-              break;
-#endif
-#ifdef _MPFR_H_HAVE_INTMAX_T
-            case INTMAX_ARG:
-              *(intmax_t *) p = (intmax_t) nchar;
-              break;
-#endif
-            case SIZE_ARG:
-              *(size_t *) p = nchar;
-              break;
-            case PTRDIFF_ARG:
-              *(ptrdiff_t *) p = (ptrdiff_t) nchar;
-              break;
-            case MPF_ARG:
-              mpf_set_ui ((mpf_ptr) p, (unsigned long) nchar);
-              break;
-            case MPQ_ARG:
-              mpq_set_ui ((mpq_ptr) p, (unsigned long) nchar, 1L);
-              break;
-            case MP_LIMB_ARG:
-              *(mp_limb_t *) p = (mp_limb_t) nchar;
-              break;
-            case MP_LIMB_ARRAY_ARG:
-              {
-                mp_limb_t *q = (mp_limb_t *) p;
-                mp_size_t n;
-                n = va_arg (ap, mp_size_t);
-                if (n < 0)
-                  n = -n;
-                else if (n == 0)
-                  break;
 
-                /* we assume here that mp_limb_t is wider than int */
-                *q = (mp_limb_t) nchar;
-                while (--n != 0)
-                  {
-                    q++;
-                    *q = MPFR_LIMB_ZERO;
-                  }
-              }
-              break;
-            case MPZ_ARG:
-              mpz_set_ui ((mpz_ptr) p, (unsigned long) nchar);
-              break;
-
-            case MPFR_ARG:
-              mpfr_set_ui ((mpfr_ptr) p, (unsigned long) nchar,
-                           spec.rnd_mode);
-              break;
-
-            default:
-              *(int *) p = (int) nchar;
-            }
-          va_copy (ap2, ap); /* after the switch, due to MP_LIMB_ARRAY_ARG
-                                case */
+          store_count (p, &spec, buf->len, nlimbs);
         }
       else if (spec.arg_type == MPFR_PREC_ARG)
         /* output mpfr_prec_t variable */
         {
-          char *s;
-          char format[MPFR_PREC_FORMAT_SIZE + 6]; /* see examples below */
-          size_t length;
+          char format[MPFR_PREC_FORMAT_SIZE + 6]; /* see prec_format */
           mpfr_prec_t prec;
           prec = va_arg (ap, mpfr_prec_t);
 
-          FLUSH (xgmp_fmt_flag, start, end, ap2, &buf);
+          FLUSH (xgmp_fmt_flag, start, end, ap2, buf);
           va_end (ap2);
           va_copy (ap2, ap);
           start = fmt;
 
-          /* construct format string, like "%*.*hd" "%*.*d" or "%*.*ld" */
-          format[0] = '%';
-          format[1] = '*';
-          format[2] = '.';
-          format[3] = '*';
-          format[4] = '\0';
-          strcat (format, MPFR_PREC_FORMAT_TYPE);
-          format[4 + MPFR_PREC_FORMAT_SIZE] = spec.spec;
-          format[5 + MPFR_PREC_FORMAT_SIZE] = '\0';
-          length = gmp_asprintf (&s, format, spec.width, spec.prec, prec);
-          if (buf.size <= INT_MAX - length)
-            {
-              buffer_cat (&buf, s, length);
-              mpfr_free_str (s);
-            }
-          else
-            {
-              mpfr_free_str (s);
-              goto overflow_error;
-            }
+          prec_format (format, spec.spec);
+          if (sprntf_gmp_va (buf, format, spec.width, spec.prec, prec) < 0)
+            goto error;
+          if (buf->len > INT_MAX)
+            goto overflow_error;
         }
       else if (spec.arg_type == MPFR_ARG)
         /* output a mpfr_t variable */
@@ -2015,12 +2297,12 @@ mpfr_vasprintf (char **ptr, const char *fmt, va_list ap)
 
           p = va_arg (ap, mpfr_srcptr);
 
-          FLUSH (xgmp_fmt_flag, start, end, ap2, &buf);
+          FLUSH (xgmp_fmt_flag, start, end, ap2, buf);
           va_end (ap2);
           va_copy (ap2, ap);
           start = fmt;
 
-          if (sprnt_fp (&buf, p, spec) < 0)
+          if (sprnt_fp (buf, p, spec) < 0)
             goto overflow_error;
         }
       else
@@ -2032,16 +2314,13 @@ mpfr_vasprintf (char **ptr, const char *fmt, va_list ap)
     }
 
   if (start != fmt)
-    FLUSH (xgmp_fmt_flag, start, fmt, ap2, &buf);
+    FLUSH (xgmp_fmt_flag, start, fmt, ap2, buf);
 
   va_end (ap2);
-  nbchar = buf.curr - buf.start;
-  MPFR_ASSERTD (nbchar == strlen (buf.start));
-  buf.start =
-    (char *) (*__gmp_reallocate_func) (buf.start, buf.size, nbchar + 1);
-  buf.size = nbchar + 1; /* update needed for __gmp_free_func below when
-                            nbchar is too large (overflow_error) */
-  *ptr = buf.start;
+  buffer_flush (buf);
+  if (buf->error)
+    goto error;
+  nbchar = buf->len;
 
   /* If nbchar is larger than INT_MAX, the ISO C99 standard is silent, but
      POSIX says concerning the snprintf() function:
@@ -2067,12 +2346,368 @@ mpfr_vasprintf (char **ptr, const char *fmt, va_list ap)
 
  error:
   MPFR_SAVE_EXPO_FREE (expo);
-  *ptr = NULL;
-  (*__gmp_free_func) (buf.start, buf.size);
+  return -1;
+}
+
+/* If PTR is not NULL, set *PTR to a string allocated with the memory
+   functions, which contains the formatted string (like mpfr_vasprintf);
+   otherwise write the formatted string in the buffer BUF of SIZE bytes
+   (like mpfr_vsnprintf).
+   Return the number of characters of the formatted string, or -1 in case
+   of error (then *PTR is set to NULL). */
+int
+mpfr_vasnprintf_aux (char **ptr, char *buf, size_t size, const char *fmt,
+                     va_list ap)
+{
+  struct string_buffer b;
+  int ret;
+
+  if (ptr == NULL)
+    {
+      buffer_init_fixed (&b, buf, size);
+      return buffer_vprintf (&b, fmt, ap);
+    }
+
+  buffer_init (&b, 4096);
+  ret = buffer_vprintf (&b, fmt, ap);
+  if (ret < 0)
+    {
+      (*__gmp_free_func) (b.start, b.size);
+      *ptr = NULL;
+      return -1;
+    }
+  MPFR_ASSERTD (b.len == strlen (b.start));
+  *ptr = (char *) (*__gmp_reallocate_func) (b.start, b.size, b.len + 1);
+  return ret;
+}
+
+#ifdef _MPFR_H_HAVE_VA_LIST_FILE
+/* Write the formatted string to the stream FP, without building it in
+   memory. Return the number of characters written, or -1 in case of
+   error. */
+int
+mpfr_vfprintf_aux (FILE *fp, const char *fmt, va_list ap)
+{
+  char buf[512];
+  struct string_buffer b;
+
+  buffer_init_stream (&b, fp, buf, sizeof (buf));
+  return buffer_vprintf (&b, fmt, ap);
+}
+#endif
+
+/* Compiled format strings (mpfr_printf_compile): the format string is
+   parsed once into a sequence of steps, which are then executed for each
+   set of arguments by buffer_vprintf_compiled, without any parsing. A
+   compiled format is not modified by its use, so that it can be shared by
+   several threads. */
+enum step_t
+  {
+    STEP_TEXT,  /* literal characters (with %% already reduced to %) */
+    STEP_GMP,   /* part of the format string to be given to gmp_printf,
+                   whose arguments are consumed by the NARGS following
+                   STEP_ARG steps */
+    STEP_ARG,   /* argument of a STEP_GMP conversion */
+    STEP_N,     /* %n conversion */
+    STEP_PREC,  /* mpfr_prec_t argument, output with gmp_printf and the
+                   format STR */
+    STEP_MPFR   /* mpfr_t argument */
+  };
+
+struct printf_step
+{
+  enum step_t kind;
+  const char *str;
+  size_t len;
+  size_t nargs;
+  struct printf_spec spec;
+  int stars;                    /* see parse_spec */
+};
+
+struct __mpfr_printf_format
+{
+  size_t size;                  /* size of the allocated block */
+  size_t nsteps;
+  struct printf_step step[1];   /* actually nsteps, followed by the strings
+                                   referenced by the steps */
+};
+
+/* Add to F the step outputting the part [START, END) of the format string,
+   which contains no mpfr conversions. If *GMP_STEP is nonnegative, it is
+   the index of the STEP_GMP step reserved for this part, which contains
+   gmp_printf conversions; otherwise, it only contains literal characters
+   and %%. The needed strings are stored from S; return the new end of the
+   strings. */
+static char *
+compile_part (mpfr_printf_format_t f, char *s, const char *start,
+              const char *end, long *gmp_step)
+{
+  struct printf_step *step;
+  size_t n = end - start;
+
+  if (*gmp_step >= 0)
+    {
+      step = &f->step[*gmp_step];
+      step->kind = STEP_GMP;
+      step->nargs = f->nsteps - *gmp_step - 1;
+      memcpy (s, start, n);
+      s[n] = '\0';
+      step->str = s;
+      step->len = n;
+      *gmp_step = -1;
+      return s + n + 1;
+    }
+
+  if (n != 0)
+    {
+      size_t i, j;
+
+      step = &f->step[f->nsteps++];
+      step->kind = STEP_TEXT;
+      for (i = j = 0; i < n; i++)
+        {
+          s[j++] = start[i];
+          if (start[i] == '%')
+            i++;  /* skip the second '%' of %% */
+        }
+      step->str = s;
+      step->len = j;
+      s += j;
+    }
+  return s;
+}
+
+/* Parse the format string FMT once for all. Return the compiled format,
+   to be freed with mpfr_printf_free_compiled, or NULL if FMT contains an
+   invalid or unsupported conversion specification. */
+mpfr_printf_format_t
+mpfr_printf_compile (const char *fmt)
+{
+  mpfr_printf_format_t f;
+  struct printf_spec spec;
+  const char *start, *end, *p;
+  size_t nconv, nsteps, size;
+  long gmp_step;
+  int stars;
+  char *s;
+
+  /* Each conversion gives at most two steps (the preceding part of the
+     format string and the conversion itself), and the strings of the steps
+     are not longer than the format string, except the formats of the
+     mpfr_prec_t arguments. */
+  nconv = 0;
+  for (p = fmt; *p; p++)
+    if (*p == '%')
+      nconv++;
+  nsteps = 2 * nconv + 1;
+  size = sizeof (struct __mpfr_printf_format)
+    + (nsteps - 1) * sizeof (struct printf_step)
+    + (p - fmt) + nsteps + nconv * (MPFR_PREC_FORMAT_SIZE + 6);
+  f = (mpfr_printf_format_t) (*__gmp_allocate_func) (size);
+  f->size = size;
+  f->nsteps = 0;
+  s = (char *) (f->step + nsteps);
+
+  gmp_step = -1;
+  start = fmt;
+  while (*fmt)
+    {
+      struct printf_step *step;
 
+      while ((*fmt) && (*fmt != '%'))
+        ++fmt;
+
+      if (*fmt == '\0')
+        break;
+
+      if (*++fmt == '%')
+        {
+          ++fmt;
+          continue;
+        }
+
+      end = fmt - 1;
+      fmt = parse_spec (fmt, &spec, &stars);
+      if (spec.arg_type == UNSUPPORTED || !specinfo_is_valid (spec))
+        {
+          mpfr_printf_free_compiled (f);
+          return NULL;
+        }
+      fmt++;
+
+      if (spec.spec != 'n' && spec.arg_type != MPFR_PREC_ARG
+          && spec.arg_type != MPFR_ARG)
+        /* gmp_printf conversion, output with the enclosing part */
+        {
+          if (gmp_step < 0)
+            gmp_step = f->nsteps++;
+          step = &f->step[f->nsteps++];
+          step->kind = STEP_ARG;
+        }
+      else
+        {
+          s = compile_part (f, s, start, end, &gmp_step);
+          start = fmt;
+          step = &f->step[f->nsteps++];
+          if (spec.spec == 'n')
+            step->kind = STEP_N;
+          else if (spec.arg_type == MPFR_PREC_ARG)
+            {
+              step->kind = STEP_PREC;
+              prec_format (s, spec.spec);
+              step->str = s;
+              s += MPFR_PREC_FORMAT_SIZE + 6;
+            }
+          else
+            step->kind = STEP_MPFR;
+        }
+      step->spec = spec;
+      step->stars = stars;
+    }
+  compile_part (f, s, start, fmt, &gmp_step);
+  MPFR_ASSERTD (f->nsteps <= nsteps);
+
+  return f;
+}
+
+void
+mpfr_printf_free_compiled (mpfr_printf_format_t f)
+{
+  (*__gmp_free_func) (f, f->size);
+}
+
+/* Same as buffer_vprintf for the compiled format F. */
+static int
+buffer_vprintf_compiled (struct string_buffer *buf, mpfr_printf_format_t f,
+                         va_list ap)
+{
+  size_t i;
+  va_list ap2;
+
+  MPFR_SAVE_EXPO_DECL (expo);
+  MPFR_SAVE_EXPO_MARK (expo);
+
+  for (i = 0; i < f->nsteps; i++)
+    {
+      const struct printf_step *step = &f->step[i];
+      struct printf_spec spec;
+
+      switch (step->kind)
+        {
+        case STEP_TEXT:
+          buffer_cat (buf, step->str, step->len);
+          break;
+
+        case STEP_GMP:
+          {
+            int r;
+
+            va_copy (ap2, ap);
+            r = sprntf_gmp (buf, step->str, ap2);
+            va_end (ap2);
+            if (r == -1)
+              goto error;
+          }
+          break;
+
+        case STEP_ARG:
+          spec = step->spec;
+          READ_STARS (ap, spec, step->stars);
+          CONSUME_VA_ARG (spec, ap);
+          break;
+
+        case STEP_N:
+          {
+            void *p;
+            mp_size_t n = 0;
+
+            spec = step->spec;
+            READ_STARS (ap, spec, step->stars);
+            p = va_arg (ap, void *);
+            if (spec.arg_type == MP_LIMB_ARRAY_ARG)
+              n = va_arg (ap, mp_size_t);
+            store_count (p, &spec, buf->len, n);
+          }
+          break;
+
+        case STEP_PREC:
+          {
+            mpfr_prec_t prec;
+
+            spec = step->spec;
+            READ_STARS (ap, spec, step->stars);
+            prec = va_arg (ap, mpfr_prec_t);
+            if (sprntf_gmp_va (buf, step->str, spec.width, spec.prec, prec)
+                < 0)
+              goto error;
+            if (buf->len > INT_MAX)
+              goto overflow_error;
+          }
+          break;
+
+        default:
+          MPFR_ASSERTD (step->kind == STEP_MPFR);
+          spec = step->spec;
+          READ_STARS (ap, spec, step->stars);
+          if (sprnt_fp (buf, va_arg (ap, mpfr_srcptr), spec) < 0)
+            goto overflow_error;
+        }
+    }
+
+  buffer_flush (buf);
+  if (buf->error)
+    goto error;
+
+  /* see buffer_vprintf */
+  if (buf->len <= INT_MAX)
+    {
+      MPFR_SAVE_EXPO_FREE (expo);
+      return buf->len;
+    }
+
+ overflow_error:
+  MPFR_SAVE_EXPO_UPDATE_FLAGS(expo, MPFR_FLAGS_ERANGE);
+#ifdef EOVERFLOW
+  errno = EOVERFLOW;
+#endif
+
+ error:
+  MPFR_SAVE_EXPO_FREE (expo);
   return -1;
 }
 
+/* Write the output of the compiled format F in the buffer BUF of SIZE
+   bytes, like mpfr_vsnprintf. */
+int
+mpfr_vsnprintf_compiled_aux (char *buf, size_t size, mpfr_printf_format_t f,
+                             va_list ap)
+{
+  struct string_buffer b;
+
+  buffer_init_fixed (&b, buf, size);
+  return buffer_vprintf_compiled (&b, f, ap);
+}
+
+#ifdef _MPFR_H_HAVE_VA_LIST_FILE
+/* Write the output of the compiled format F to the stream FP, like
+   mpfr_vfprintf_aux. */
+int
+mpfr_vfprintf_compiled_aux (FILE *fp, mpfr_printf_format_t f, va_list ap)
+{
+  char buf[512];
+  struct string_buffer b;
+
+  buffer_init_stream (&b, fp, buf, sizeof (buf));
+  return buffer_vprintf_compiled (&b, f, ap);
+}
+#endif
+
+int
+mpfr_vasprintf (char **ptr, const char *fmt, va_list ap)
+{
+  return mpfr_vasnprintf_aux (ptr, NULL, 0, fmt, ap);
+}
+
 #else /* HAVE_STDARG */
 
 /* Avoid an empty translation unit (see ISO C99, 6.9) */
@@ -614,6 +614,59 @@ reduced_expo_range (void)
   mpfr_clears (x, y, ex_y, (mpfr_ptr) 0);
 }
 
+/* Compare the results of the table-based engine, used for small precision,
+   with those of the binary splitting algorithm, used above
+   MPFR_ATAN_TABLE_THRESHOLD, on values around the table points i/2^6 and
+   i/2^12 and their inverses. */
+static void
+check_table_engine (void)
+{
+  mpfr_t x, y, z;
+  mpfr_prec_t p;
+  unsigned long i;
+  int k, r, inex1, inex2;
+
+  mpfr_init2 (x, 80);
+  mpfr_init2 (z, MPFR_ATAN_TABLE_THRESHOLD + 100);
+  for (p = MPFR_PREC_MIN; p <= 150; p += 7)
+    {
+      mpfr_init2 (y, p);
+      for (i = 1; i <= 64; i++)
+        for (k = 0; k < 6; k++)
+          {
+            mpfr_set_ui_2exp (x, i, (k & 2) ? -12 : -6, MPFR_RNDN);
+            if (k & 1)
+              mpfr_nextabove (x);
+            else
+              mpfr_nextbelow (x);
+            if (k >= 4)
+              mpfr_ui_div (x, 1, x, MPFR_RNDN);
+            if (i & 1)
+              mpfr_neg (x, x, MPFR_RNDN);
+            r = RND_RAND ();
+            inex1 = mpfr_atan (y, x, (mpfr_rnd_t) r);
+            mpfr_atan (z, x, MPFR_RNDN);
+            inex2 = mpfr_prec_round (z, p, (mpfr_rnd_t) r);
+            if (! mpfr_equal_p (y, z) || SIGN (inex1) != SIGN (inex2))
+              {
+                printf ("Error in check_table_engine for p=%lu, %s\nx=",
+                        (unsigned long) p,
+                        mpfr_print_rnd_mode ((mpfr_rnd_t) r));
+                mpfr_dump (x);
+                printf ("expected ");
+                mpfr_dump (z);
+                printf ("got      ");
+                mpfr_dump (y);
+                printf ("inex1=%d inex2=%d\n", inex1, inex2);
+                exit (1);
+              }
+            mpfr_set_prec (z, MPFR_ATAN_TABLE_THRESHOLD + 100);
+          }
+      mpfr_clear (y);
+    }
+  mpfr_clears (x, z, (mpfr_ptr) 0);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -626,8 +679,13 @@ main (int argc, char *argv[])
   atan2_bug_20071003 ();
   atan2_different_prec ();
   reduced_expo_range ();
+  check_table_engine ();
 
   test_generic_atan  (MPFR_PREC_MIN, 200, 17);
+  test_generic_atan  (MPFR_ATAN_TABLE_THRESHOLD - 1,
+                      MPFR_ATAN_TABLE_THRESHOLD + 1, 2);
+  /* truncation of the binary splitting values in mpfr_atan_aux */
+  test_generic_atan  (20000, 20000, 1);
   test_generic_atan2 (MPFR_PREC_MIN, 200, 17);
   test_generic_atan2_neg (MPFR_PREC_MIN, 200, 17);
 
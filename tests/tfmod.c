@@ -403,6 +403,129 @@ bug20160217 (void)
   mpfr_clears (x, y, r, (mpfr_ptr) 0);
 }
 
+/* Huge exponent gap between x and y: x = 2^n and y = 3 or 3*2^emin,
+   so that the remainder only depends on the parity of the gap. */
+static void
+huge_gap (void)
+{
+  mpfr_t x, y, r;
+  mpfr_exp_t emin, emax, n;
+  long quo;
+  int i, j, inexact;
+  long expected;
+
+  emin = mpfr_get_emin ();
+  emax = mpfr_get_emax ();
+  set_emin (MPFR_EMIN_MIN);
+  set_emax (MPFR_EMAX_MAX);
+
+  mpfr_inits2 (200, x, y, r, (mpfr_ptr) 0);
+
+  for (i = 0; i < 4; i++)
+    for (j = 0; j < 2; j++)
+      {
+        /* x = 2^n with n = emax - 1 - i */
+        n = MPFR_EMAX_MAX - 1 - i;
+        mpfr_set_ui_2exp (x, 1, n, MPFR_RNDN);
+        if (j)
+          {
+            /* y = 3*2^emin */
+            mpfr_set_ui_2exp (y, 3, MPFR_EMIN_MIN, MPFR_RNDN);
+            n -= MPFR_EMIN_MIN;
+          }
+        else
+          mpfr_set_ui (y, 3, MPFR_RNDN);
+        /* 2^n = 1 mod 3 if n is even, 2 otherwise */
+        expected = (n % 2 == 0) ? 1 : 2;
+        inexact = mpfr_fmod (r, x, y, MPFR_RNDN);
+        if (j)
+          mpfr_div_2si (r, r, MPFR_EMIN_MIN, MPFR_RNDN);
+        if (inexact != 0 || mpfr_cmp_si (r, expected) != 0)
+          {
+            printf ("Error in huge_gap for fmod, i=%d j=%d\n", i, j);
+            printf ("Expected %ld, got ", expected);
+            mpfr_dump (r);
+            exit (1);
+          }
+        /* for remquo, the quotient is rounded to nearest, thus the
+           remainder is 1 or -1, and the low bits of the quotient q
+           satisfy 3q + rem = 2^n = 0 mod 8 */
+        expected = (n % 2 == 0) ? 1 : -1;
+        inexact = mpfr_remquo (r, &quo, x, y, MPFR_RNDN);
+        if (j)
+          mpfr_div_2si (r, r, MPFR_EMIN_MIN, MPFR_RNDN);
+        if (inexact != 0 || mpfr_cmp_si (r, expected) != 0 || quo <= 0
+            || (3 * quo + expected) % 8 != 0)
+          {
+            printf ("Error in huge_gap for remquo, i=%d j=%d\n", i, j);
+            printf ("Expected rem=%ld, got quo=%ld and rem=", expected, quo);
+            mpfr_dump (r);
+            exit (1);
+          }
+      }
+
+  mpfr_clears (x, y, r, (mpfr_ptr) 0);
+
+  set_emin (emin);
+  set_emax (emax);
+}
+
+/* Huge exponent gap in a reduced exponent range: x = 2^5 and y = 3*2^emin
+   with emax = 10. The gap does not fit in an unsigned long when mpfr_exp_t
+   is wider than long (e.g., with _MPFR_EXP_FORMAT=4 and a 32-bit long),
+   in which case it must be handled without any MPFR arithmetic, which
+   would overflow in this range. No flag may be raised. */
+static void
+huge_gap_small_emax (void)
+{
+  mpfr_t x, y, r, e;
+  mpfr_exp_t emin, emax, n;
+  long quo, expected;
+  int inexact;
+
+  emin = mpfr_get_emin ();
+  emax = mpfr_get_emax ();
+  set_emin (MPFR_EMIN_MIN);
+  set_emax (10);
+
+  mpfr_inits2 (20, x, y, r, e, (mpfr_ptr) 0);
+  mpfr_set_ui_2exp (x, 1, 5, MPFR_RNDN);
+  mpfr_set_ui_2exp (y, 3, MPFR_EMIN_MIN, MPFR_RNDN);
+  /* x/2^emin = 2^n with n = 5 - emin, and 2^n = 1 mod 3 iff n is even */
+  n = 5 - MPFR_EMIN_MIN;
+
+  expected = (n % 2 == 0) ? 1 : 2;
+  mpfr_set_ui_2exp (e, expected, MPFR_EMIN_MIN, MPFR_RNDN);
+  mpfr_clear_flags ();
+  inexact = mpfr_fmod (r, x, y, MPFR_RNDN);
+  if (inexact != 0 || ! mpfr_equal_p (r, e) || __gmpfr_flags != 0)
+    {
+      printf ("Error in huge_gap_small_emax for fmod\n");
+      printf ("Expected "); mpfr_dump (e);
+      printf ("Got      "); mpfr_dump (r);
+      printf ("Flags: %u\n", (unsigned int) __gmpfr_flags);
+      exit (1);
+    }
+
+  /* the quotient is rounded to nearest: the remainder is +/- 2^emin */
+  expected = (n % 2 == 0) ? 1 : -1;
+  mpfr_set_si_2exp (e, expected, MPFR_EMIN_MIN, MPFR_RNDN);
+  mpfr_clear_flags ();
+  inexact = mpfr_remquo (r, &quo, x, y, MPFR_RNDN);
+  if (inexact != 0 || ! mpfr_equal_p (r, e) || __gmpfr_flags != 0)
+    {
+      printf ("Error in huge_gap_small_emax for remquo\n");
+      printf ("Expected "); mpfr_dump (e);
+      printf ("Got      "); mpfr_dump (r);
+      printf ("Flags: %u\n", (unsigned int) __gmpfr_flags);
+      exit (1);
+    }
+
+  mpfr_clears (x, y, r, e, (mpfr_ptr) 0);
+  set_emin (emin);
+  set_emax (emax);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -410,6 +533,8 @@ main (int argc, char *argv[])
 
   bug20090519 ();
   bug20160217 ();
+  huge_gap ();
+  huge_gap_small_emax ();
 
   test_generic (MPFR_PREC_MIN, 100, 100);
 
@@ -237,6 +237,225 @@ doit (int argc, char *argv[], mpfr_prec_t p1, mpfr_prec_t p2)
   mpfr_clear (y);
 }
 
+static int
+same_number (mpfr_ptr x, mpfr_ptr y)
+{
+  return mpfr_get_prec (x) == mpfr_get_prec (y)
+    && (mpfr_nan_p (x) ? mpfr_nan_p (y) :
+        mpfr_equal_p (x, y) && mpfr_signbit (x) == mpfr_signbit (y));
+}
+
+/* check the buffer and array variants against the stream functions */
+static void
+check_buffer (void)
+{
+  char *filename = FILE_NAME_RW;
+  mpfr_t x[20], y[20];
+  mpfr_ptr tx[20], ty[20];
+  unsigned char buf[8000], fbuf[1000];
+  size_t size, total, k;
+  FILE *fh;
+  int i;
+
+  for (i = 0; i < 20; i++)
+    {
+      mpfr_init2 (x[i], 1 + randlimb () % (i < 10 ? 300 : 3000));
+      mpfr_init2 (y[i], 2);
+      tx[i] = x[i];
+      ty[i] = y[i];
+      if (i < 4)
+        {
+          if (i == 0)
+            mpfr_set_nan (x[i]);
+          else if (i == 1)
+            mpfr_set_inf (x[i], -1);
+          else
+            mpfr_set_zero (x[i], i == 2 ? -1 : 1);
+          continue;
+        }
+      mpfr_urandomb (x[i], RANDS);
+      if (mpfr_zero_p (x[i]))
+        mpfr_set_ui (x[i], 1, MPFR_RNDN);
+      /* embedded and external exponents */
+      if (i % 3)
+        mpfr_set_exp (x[i], (mpfr_exp_t) (randlimb () % 95) - 47);
+      else
+        mpfr_set_exp (x[i], (randlimb () % 2 ? 1 : -1) *
+                      (mpfr_exp_t) (randlimb () % 1000000));
+      if (i % 2)
+        mpfr_neg (x[i], x[i], MPFR_RNDN);
+    }
+
+  total = 0;
+  for (i = 0; i < 20; i++)
+    {
+      /* the buffer contents must be what mpfr_fpif_export writes */
+      fh = fopen (filename, "w+");
+      if (fh == NULL)
+        {
+          printf ("Failed to open for reading/writing %s, exiting...\n",
+                  filename);
+          exit (1);
+        }
+      if (mpfr_fpif_export (fh, x[i]) != 0)
+        {
+          printf ("Failed to export number %d, exiting...\n", i);
+          exit (1);
+        }
+      rewind (fh);
+      k = fread (fbuf, 1, sizeof (fbuf), fh);
+      fclose (fh);
+      remove (filename);
+
+      size = mpfr_fpif_export_buffer (NULL, 0, x[i]);
+      if (size != k || mpfr_fpif_export_buffer (buf, size, x[i]) != size
+          || memcmp (buf, fbuf, size) != 0)
+        {
+          printf ("mpfr_fpif_export_buffer differs from mpfr_fpif_export "
+                  "for number %d (size %lu instead of %lu)\n", i,
+                  (unsigned long) size, (unsigned long) k);
+          exit (1);
+        }
+      total += size;
+
+      k = mpfr_fpif_import_buffer (y[i], buf, size);
+      if (k != size || ! same_number (x[i], y[i]))
+        {
+          printf ("mpfr_fpif_import_buffer failed on number %d\n", i);
+          printf ("expected "); mpfr_dump (x[i]);
+          printf ("got      "); mpfr_dump (y[i]);
+          exit (1);
+        }
+      /* a truncated buffer must be detected */
+      for (k = 0; k < size; k++)
+        if (mpfr_fpif_import_buffer (y[i], buf, k) != 0)
+          {
+            printf ("mpfr_fpif_import_buffer did not fail on number %d "
+                    "truncated to %lu bytes\n", i, (unsigned long) k);
+            exit (1);
+          }
+    }
+
+  /* arrays: nothing is written in a too small buffer */
+  MPFR_ASSERTN (mpfr_fpif_export_array (NULL, 0, tx, 20) == total);
+  MPFR_ASSERTN (total <= sizeof (buf));
+  memset (buf, 0xAA, sizeof (buf));
+  MPFR_ASSERTN (mpfr_fpif_export_array (buf, total - 1, tx, 20) == total);
+  for (k = 0; k < total; k++)
+    MPFR_ASSERTN (buf[k] == 0xAA);
+  MPFR_ASSERTN (mpfr_fpif_export_array (buf, total, tx, 20) == total);
+  MPFR_ASSERTN (mpfr_fpif_import_array (ty, 20, buf, total - 1) == 0);
+  for (i = 0; i < 20; i++)
+    mpfr_set_prec (y[i], 2);
+  k = mpfr_fpif_import_array (ty, 20, buf, total);
+  MPFR_ASSERTN (k == total);
+  for (i = 0; i < 20; i++)
+    {
+      if (! same_number (x[i], y[i]))
+        {
+          printf ("mpfr_fpif_import_array failed on number %d\n", i);
+          printf ("expected "); mpfr_dump (x[i]);
+          printf ("got      "); mpfr_dump (y[i]);
+          exit (1);
+        }
+      mpfr_clear (x[i]);
+      mpfr_clear (y[i]);
+    }
+}
+
+/* check the import into a significand set up by mpfr_custom_init */
+static void
+check_custom (void)
+{
+  char *filename = FILE_NAME_RW;
+  mpfr_t x, y;
+  mpfr_prec_t p, q;
+  unsigned char buf[1000];
+  void *mant;
+  size_t size, msize;
+  FILE *fh;
+  int i, r;
+
+  for (i = 0; i < 40; i++)
+    {
+      p = 1 + randlimb () % 300;
+      mpfr_init2 (x, p);
+      if (i < 4)
+        {
+          if (i == 0)
+            mpfr_set_nan (x);
+          else if (i == 1)
+            mpfr_set_inf (x, 1);
+          else
+            mpfr_set_zero (x, i == 2 ? -1 : 1);
+        }
+      else
+        {
+          mpfr_urandomb (x, RANDS);
+          if (mpfr_zero_p (x))
+            mpfr_set_ui (x, 1, MPFR_RNDN);
+          mpfr_set_exp (x, (mpfr_exp_t) (randlimb () % 2000) - 1000);
+          if (i % 2)
+            mpfr_neg (x, x, MPFR_RNDN);
+        }
+      size = mpfr_fpif_export_buffer (buf, sizeof (buf), x);
+      MPFR_ASSERTN (size <= sizeof (buf));
+
+      /* the target may have a larger precision, but not a smaller one */
+      q = (i % 4 == 3 && p > 1) ? p - 1 - randlimb () % (p - 1)
+        : p + randlimb () % 200;
+      msize = mpfr_custom_get_size (q);
+      mant = tests_allocate (msize);
+      mpfr_custom_init (mant, q);
+      mpfr_custom_init_set (y, MPFR_NAN_KIND, 0, q, mant);
+
+      fh = fopen (filename, "w+");
+      if (fh == NULL)
+        {
+          printf ("Failed to open for reading/writing %s, exiting...\n",
+                  filename);
+          exit (1);
+        }
+      fwrite (buf, size, 1, fh);
+      rewind (fh);
+      r = mpfr_fpif_import_custom (y, fh);
+      fclose (fh);
+      remove (filename);
+      MPFR_ASSERTN (mpfr_get_prec (y) == q);
+      MPFR_ASSERTN (mpfr_custom_get_significand (y) == mant);
+      if (q < p)
+        MPFR_ASSERTN (r != 0);
+      else if (r != 0 || ! (mpfr_nan_p (x) ? mpfr_nan_p (y) :
+                            mpfr_equal_p (x, y) &&
+                            mpfr_signbit (x) == mpfr_signbit (y)))
+        {
+          printf ("mpfr_fpif_import_custom failed on number %d\n", i);
+          printf ("expected "); mpfr_dump (x);
+          printf ("got      "); mpfr_dump (y);
+          exit (1);
+        }
+
+      mpfr_custom_init_set (y, MPFR_NAN_KIND, 0, q, mant);
+      r = mpfr_fpif_import_custom_buffer (y, buf, size) == size;
+      MPFR_ASSERTN (mpfr_get_prec (y) == q);
+      MPFR_ASSERTN (mpfr_custom_get_significand (y) == mant);
+      if (q < p)
+        MPFR_ASSERTN (r == 0);
+      else if (r == 0 || ! (mpfr_nan_p (x) ? mpfr_nan_p (y) :
+                            mpfr_equal_p (x, y) &&
+                            mpfr_signbit (x) == mpfr_signbit (y)))
+        {
+          printf ("mpfr_fpif_import_custom_buffer failed on number %d\n", i);
+          printf ("expected "); mpfr_dump (x);
+          printf ("got      "); mpfr_dump (y);
+          exit (1);
+        }
+
+      tests_free (mant, msize);
+      mpfr_clear (x);
+    }
+}
+
 /* exercise error when precision > MPFR_PREC_MAX */
 static void
 extra (void)
@@ -276,6 +495,8 @@ main (int argc, char *argv[])
   extra ();
   doit (argc, argv, 130, 2048);
   doit (argc, argv, 1, 53);
+  check_buffer ();
+  check_custom ();
 
   tests_end_mpfr ();
 
@@ -387,6 +387,56 @@ bug_20090316 (FILE *fout)
   mpfr_clear (x);
 }
 
+/* Check that what is written to a stream is the same string as the one
+   built by mpfr_asprintf, in particular when it is larger than the
+   internal buffer used for the output. */
+static void
+check_stream (void)
+{
+  FILE *f;
+  mpfr_t x;
+  mpz_t z;
+  char *s, *t;
+  int i, n1, n2, c1, c2;
+  const char *fmt[] = { "%Ra|%Zd%n", "%.3000Rf|%Zd|%n",
+                        "%'30.1000Re%%%Zx%n", "%-2000.10Rg<%Zo>%n" };
+
+  f = tmpfile ();
+  if (f == NULL)
+    return;
+
+  mpfr_init2 (x, 3000);
+  mpz_init (z);
+  mpfr_const_pi (x, MPFR_RNDN);
+  mpz_ui_pow_ui (z, 7, 1000);
+  for (i = 0; i < sizeof (fmt) / sizeof (fmt[0]); i++)
+    {
+      rewind (f);
+      c1 = c2 = -1;
+      n1 = mpfr_fprintf (f, fmt[i], x, z, &c1);
+      n2 = mpfr_asprintf (&s, fmt[i], x, z, &c2);
+      if (n1 != n2 || n2 < 0 || c1 != c2)
+        {
+          printf ("Error in check_stream for \"%s\": got %d (%d), "
+                  "expected %d (%d)\n", fmt[i], n1, c1, n2, c2);
+          exit (1);
+        }
+      t = (char *) tests_allocate (n2 + 1);
+      rewind (f);
+      if (fread (t, 1, n2, f) != n2 || memcmp (s, t, n2) != 0)
+        {
+          printf ("Error in check_stream for \"%s\": wrong output\n",
+                  fmt[i]);
+          exit (1);
+        }
+      tests_free (t, n2 + 1);
+      mpfr_free_str (s);
+    }
+  mpz_clear (z);
+  mpfr_clear (x);
+  fclose (f);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -424,6 +474,7 @@ main (int argc, char *argv[])
   check_random (fout, N);
 
   bug_20090316 (fout);
+  check_stream ();
 
   fclose (fout);
   tests_end_mpfr ();
@@ -381,6 +381,168 @@ check_tiny (void)
   mpfr_clear (x);
 }
 
+/* Return c * 10^q as a decimal64 number, where 0 <= c < 10^16 and
+   -398 <= q <= 369; all the operations are exact since the intermediate
+   values are representable. */
+static _Decimal64
+make_decimal64 (unsigned long chi, unsigned long clo, int q)
+{
+  _Decimal64 d;
+
+  d = (_Decimal64) chi * (_Decimal64) 100000000 + (_Decimal64) clo;
+  for (; q > 0; q--)
+    d *= (_Decimal64) 10;
+  for (; q < 0; q++)
+    d /= (_Decimal64) 10;
+  return d;
+}
+
+/* check the correct rounding and the ternary value of mpfr_set_decimal64,
+   and the correct rounding of mpfr_get_decimal64, in all the rounding
+   modes, by comparison with conversions from/to decimal strings */
+static void
+check_rounding (void)
+{
+  mpfr_t x, y, z;
+  char s[64], t[64];
+  _Decimal64 d, d2;
+  unsigned long chi, clo;
+  mpfr_exp_t e;
+  int i, q, rnd, inex1, inex2;
+
+  mpfr_init2 (z, 128);
+  mpfr_init2 (y, 128);
+  for (i = 0; i < 1000; i++)
+    {
+      mpfr_init2 (x, 2 + randlimb () % 128);
+      /* the coefficient c = chi * 10^8 + clo has 1 to 16 digits */
+      chi = (randlimb () % 2) ? randlimb () % 100000000 : 0;
+      clo = randlimb () % 100000000;
+      if (chi == 0 && clo == 0)
+        clo = 1;
+      q = (int) (randlimb () % 768) - 398;
+      d = make_decimal64 (chi, clo, q);
+      if (chi != 0)
+        sprintf (s, "%lu%08luE%d", chi, clo, q);
+      else
+        sprintf (s, "%luE%d", clo, q);
+      if (i % 2)
+        {
+          d = -d;
+          memmove (s + 1, s, strlen (s) + 1);
+          s[0] = '-';
+        }
+      RND_LOOP (rnd)
+        {
+          mpfr_prec_t p = mpfr_get_prec (x);
+
+          inex1 = mpfr_set_decimal64 (x, d, (mpfr_rnd_t) rnd);
+          mpfr_set_prec (z, p);
+          inex2 = mpfr_strtofr (z, s, NULL, 10, (mpfr_rnd_t) rnd);
+          if (! mpfr_equal_p (x, z) || ! SAME_SIGN (inex1, inex2))
+            {
+              printf ("Error in check_rounding for %s, %s\n", s,
+                      mpfr_print_rnd_mode ((mpfr_rnd_t) rnd));
+              printf ("expected "); mpfr_dump (z);
+              printf ("with inex = %d\n", inex2);
+              printf ("got      "); mpfr_dump (x);
+              printf ("with inex = %d\n", inex1);
+              exit (1);
+            }
+          mpfr_set_prec (z, 128);
+
+          /* in the normal range, mpfr_get_decimal64 must give the same
+             16-digit decimal number as mpfr_get_str */
+          d2 = mpfr_get_decimal64 (x, (mpfr_rnd_t) rnd);
+          mpfr_get_str (t, &e, 10, 16, x, (mpfr_rnd_t) rnd);
+          if (e - 16 < -398 || e > 385)
+            continue;
+          sprintf (t + strlen (t), "E%ld", (long) e - 16);
+          mpfr_set_decimal64 (y, d2, MPFR_RNDN);
+          mpfr_set_str (z, t, 10, MPFR_RNDN);
+          if (! mpfr_equal_p (y, z))
+            {
+              printf ("Error in check_rounding for %s\n",
+                      mpfr_print_rnd_mode ((mpfr_rnd_t) rnd));
+              printf ("x = "); mpfr_dump (x);
+              printf ("expected %s\n", t);
+              printf ("got      "); print_decimal64 (d2);
+              exit (1);
+            }
+        }
+      mpfr_clear (x);
+    }
+  mpfr_clear (y);
+  mpfr_clear (z);
+}
+
+static void
+check_array (void)
+{
+  mpfr_t x[8], y;
+  mpfr_ptr tab[8];
+  _Decimal64 d[8], e;
+  int i, rnd, inex, inex1;
+
+  mpfr_init2 (y, 64);
+  for (i = 0; i < 8; i++)
+    {
+      mpfr_init2 (x[i], 64);
+      tab[i] = x[i];
+    }
+  RND_LOOP (rnd)
+    {
+      mpfr_set_nan (x[0]);
+      mpfr_set_inf (x[1], -1);
+      mpfr_set_zero (x[2], -1);
+      mpfr_set_str (x[3], "0.1", 10, MPFR_RNDN);
+      mpfr_set_si_2exp (x[4], -3, -1320, MPFR_RNDN);
+      mpfr_set_si_2exp (x[5], 1, 1300, MPFR_RNDN);
+      mpfr_const_pi (x[6], MPFR_RNDN);
+      mpfr_set_str (x[7], "1e-390", 10, MPFR_RNDN);
+      mpfr_get_decimal64_array (d, tab, 8, (mpfr_rnd_t) rnd);
+      inex = 0;
+      for (i = 0; i < 8; i++)
+        {
+          e = mpfr_get_decimal64 (x[i], (mpfr_rnd_t) rnd);
+          /* memcmp checks the sign of zero; the other bits of
+             a NaN or an infinity are not specified */
+          if (mpfr_nan_p (x[i]) ? d[i] == d[i] : d[i] != e ||
+              (d[i] == 0 && memcmp (&d[i], &e, sizeof (_Decimal64)) != 0))
+            {
+              printf ("Error in mpfr_get_decimal64_array for i=%d, %s\n",
+                      i, mpfr_print_rnd_mode ((mpfr_rnd_t) rnd));
+              exit (1);
+            }
+          inex |= mpfr_set_decimal64 (y, d[i], (mpfr_rnd_t) rnd);
+        }
+      inex1 = mpfr_set_decimal64_array (tab, d, 8, (mpfr_rnd_t) rnd);
+      if ((inex1 != 0) != (inex != 0))
+        {
+          printf ("Error in mpfr_set_decimal64_array for %s: wrong ternary "
+                  "value %d\n", mpfr_print_rnd_mode ((mpfr_rnd_t) rnd), inex1);
+          exit (1);
+        }
+      for (i = 0; i < 8; i++)
+        {
+          mpfr_set_decimal64 (y, d[i], (mpfr_rnd_t) rnd);
+          if ((! mpfr_equal_p (x[i], y) &&
+               ! (mpfr_nan_p (x[i]) && mpfr_nan_p (y))) ||
+              mpfr_signbit (x[i]) != mpfr_signbit (y))
+            {
+              printf ("Error in mpfr_set_decimal64_array for i=%d, %s\n",
+                      i, mpfr_print_rnd_mode ((mpfr_rnd_t) rnd));
+              printf ("expected "); mpfr_dump (y);
+              printf ("got      "); mpfr_dump (x[i]);
+              exit (1);
+            }
+        }
+    }
+  for (i = 0; i < 8; i++)
+    mpfr_clear (x[i]);
+  mpfr_clear (y);
+}
+
 int
 main (void)
 {
@@ -399,6 +561,8 @@ main (void)
   check_native ();
   check_overflow ();
   check_tiny ();
+  check_rounding ();
+  check_array ();
 
   tests_end_mpfr ();
   return 0;
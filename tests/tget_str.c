@@ -1206,6 +1206,268 @@ check_reduced_exprange (void)
 
 #define ITER 1000
 
+/* mpfr_get_str and mpfr_strtofr cache the powers of the base they
+   compute: check that the result of a conversion does not depend on the
+   conversions done in between. */
+static void
+check_repeated (void)
+{
+  mpfr_t x, y, z;
+  char s1[100], s2[100], s3[100];
+  mpfr_exp_t e1, e2, e3;
+  int i, j, b, b3;
+  size_t m;
+
+  mpfr_inits2 (200, x, y, z, (mpfr_ptr) 0);
+  for (i = 0; i < 100; i++)
+    {
+      mpfr_set_prec (x, 2 + (randlimb () % 199));
+      mpfr_urandomb (x, RANDS);
+      mpfr_mul_2si (x, x, (long) (randlimb () % 61) - 30, MPFR_RNDN);
+      b = 2 + (randlimb () % 61);
+      m = 2 + (randlimb () % 60);
+      mpfr_get_str (s1, &e1, b, m, x, MPFR_RNDN);
+      mpfr_strtofr (y, s1, NULL, b, MPFR_RNDN);
+      for (j = 0; j < 10; j++)
+        {
+          /* same magnitude as x, other base, digits or precision */
+          mpfr_set_prec (z, 2 + (randlimb () % 199));
+          mpfr_urandomb (z, RANDS);
+          mpfr_mul_2si (z, z, mpfr_get_exp (x) + (long) (randlimb () % 3) - 1,
+                        MPFR_RNDN);
+          b3 = (j & 1) ? b : 2 + (randlimb () % 61);
+          mpfr_get_str (s3, &e3, b3, 2 + (randlimb () % 60), z, MPFR_RNDN);
+          mpfr_strtofr (z, s3, NULL, b3, MPFR_RNDN);
+        }
+      mpfr_get_str (s2, &e2, b, m, x, MPFR_RNDN);
+      mpfr_set_prec (z, mpfr_get_prec (y));
+      mpfr_strtofr (z, s1, NULL, b, MPFR_RNDN);
+      if (e1 != e2 || strcmp (s1, s2) != 0 || !mpfr_equal_p (y, z))
+        {
+          printf ("Error in check_repeated for b=%d m=%lu, x=", b,
+                  (unsigned long) m);
+          mpfr_dump (x);
+          printf ("first %s e=%ld, then %s e=%ld\n", s1, (long) e1,
+                  s2, (long) e2);
+          exit (1);
+        }
+    }
+  mpfr_clears (x, y, z, (mpfr_ptr) 0);
+}
+
+/* Check that mpfr_get_str_shortest returns a string that reads back to x,
+   and that no string with one digit less does. */
+static void
+check_shortest (void)
+{
+  mpfr_t x, y;
+  char *s, *t, *u, buf[200];
+  mpfr_exp_t e, f;
+  int i, b, r;
+  size_t n;
+
+  mpfr_inits2 (200, x, y, (mpfr_ptr) 0);
+  for (i = 0; i < 1000; i++)
+    {
+      mpfr_set_prec (x, 2 + (randlimb () % 150));
+      mpfr_set_prec (y, mpfr_get_prec (x));
+      mpfr_urandomb (x, RANDS);
+      if (i % 8 == 0)
+        mpfr_set_ui_2exp (x, 1, 0, MPFR_RNDN); /* power of 2 */
+      mpfr_mul_2si (x, x, (long) (randlimb () % 201) - 100, MPFR_RNDN);
+      if (randlimb () & 1)
+        mpfr_neg (x, x, MPFR_RNDN);
+      b = (i & 1) ? 10 : 2 + (randlimb () % 61);
+      s = mpfr_get_str_shortest (NULL, &e, b, x);
+      sprintf (buf, "%s@%ld", s, (long) (e - (mpfr_exp_t) strlen (s)
+                                          + (s[0] == '-')));
+      mpfr_strtofr (y, buf, NULL, b, MPFR_RNDN);
+      n = strlen (s) - (s[0] == '-');
+      if (!mpfr_equal_p (x, y) || (n > 1 && s[strlen (s) - 1] == '0'))
+        {
+          printf ("Error in check_shortest for b=%d, x=", b);
+          mpfr_dump (x);
+          printf ("got %s, which reads back to ", buf);
+          mpfr_dump (y);
+          exit (1);
+        }
+      /* no string with n-1 digits reads back to x */
+      if (n > (IS_POW2 (b) ? 2 : 1))
+        for (r = 0; r < 2; r++)
+          {
+            t = mpfr_get_str (NULL, &f, b, n - 1, x,
+                              r ? MPFR_RNDU : MPFR_RNDD);
+            sprintf (buf, "%s@%ld", t, (long) (f - (mpfr_exp_t) strlen (t)
+                                                + (t[0] == '-')));
+            mpfr_strtofr (y, buf, NULL, b, MPFR_RNDN);
+            if (mpfr_equal_p (x, y))
+              {
+                printf ("Error in check_shortest for b=%d, x=", b);
+                mpfr_dump (x);
+                printf ("got %s, but %s is shorter\n", s, buf);
+                exit (1);
+              }
+            mpfr_free_str (t);
+          }
+      /* the result can also be written in a user buffer */
+      u = mpfr_get_str_shortest (buf, &f, b, x);
+      if (u != buf || f != e || strcmp (s, buf) != 0)
+        {
+          printf ("Error in check_shortest with a user buffer for b=%d\n",
+                  b);
+          exit (1);
+        }
+      mpfr_free_str (s);
+    }
+
+  mpfr_set_prec (x, 53);
+  mpfr_set_str (x, "1e23", 10, MPFR_RNDN);
+  s = mpfr_get_str_shortest (NULL, &e, 10, x);
+  if (strcmp (s, "1") != 0 || e != 24)
+    {
+      printf ("Error in check_shortest for 1e23: got %s, e=%ld\n", s,
+              (long) e);
+      exit (1);
+    }
+  mpfr_free_str (s);
+  mpfr_set_zero (x, -1);
+  s = mpfr_get_str_shortest (NULL, &e, 10, x);
+  if (strcmp (s, "-0") != 0 || e != 0)
+    {
+      printf ("Error in check_shortest for -0: got %s, e=%ld\n", s,
+              (long) e);
+      exit (1);
+    }
+  mpfr_free_str (s);
+
+  mpfr_clears (x, y, (mpfr_ptr) 0);
+}
+
+/* Check the direct algorithm of mpfr_get_str_shortest (base 10 and a
+   precision up to 64): except for a power of 2, among the strings of the
+   same length, the result must be the one given by mpfr_get_str with
+   rounding to nearest. */
+static void
+check_shortest_direct (void)
+{
+  mpfr_t x;
+  char *s, *t;
+  mpfr_exp_t e, f;
+  size_t n;
+  int i;
+
+  mpfr_init2 (x, 64);
+  for (i = 0; i < 10000; i++)
+    {
+      mpfr_set_prec (x, 5 + (randlimb () % 60));
+      mpfr_urandomb (x, RANDS);
+      if (mpfr_zero_p (x) || mpfr_powerof2_raw (x))
+        continue;
+      if (i % 16 == 0)
+        {
+          /* largest significand */
+          mpfr_set_ui (x, 1, MPFR_RNDN);
+          mpfr_nextbelow (x);
+        }
+      mpfr_mul_2si (x, x, i % 4 == 0 ? 16300 - (long) (randlimb () % 32600)
+                    : 1000 - (long) (randlimb () % 2000), MPFR_RNDN);
+      s = mpfr_get_str_shortest (NULL, &e, 10, x);
+      n = strlen (s);
+      t = mpfr_get_str (NULL, &f, 10, n, x, MPFR_RNDN);
+      /* remove the trailing zeros of t, if it was rounded to a power of 10 */
+      while (strlen (t) > 1 && t[strlen (t) - 1] == '0')
+        t[strlen (t) - 1] = '\0';
+      if (strcmp (s, t) != 0 || e != f)
+        {
+          printf ("Error in check_shortest_direct for x=");
+          mpfr_dump (x);
+          printf ("got %s, e=%ld instead of %s, e=%ld\n", s, (long) e,
+                  t, (long) f);
+          exit (1);
+        }
+      mpfr_free_str (s);
+      mpfr_free_str (t);
+    }
+  mpfr_clear (x);
+}
+
+/* Check mpfr_get_str_array against mpfr_get_str. */
+static void
+check_array (void)
+{
+#define NARRAY 40
+  mpfr_t x[NARRAY];
+  mpfr_ptr tab[NARRAY];
+  size_t offsets[NARRAY], size, m;
+  mpfr_exp_t e[NARRAY], f;
+  char *buf, *s;
+  int i, j, b;
+  mpfr_rnd_t r;
+
+  for (i = 0; i < NARRAY; i++)
+    {
+      mpfr_init2 (x[i], (i & 1) ? 53 : 2 + (randlimb () % 150));
+      tab[i] = x[i];
+    }
+
+  for (j = 0; j < 50; j++)
+    {
+      b = j == 0 ? 10 : j == 1 ? 16 : 2 + (randlimb () % 61);
+      m = (j & 2) ? 0 : 1 + (randlimb () % 40);
+      if (m == 1 && IS_POW2 (b))
+        m = 2;
+      r = RND_RAND ();
+      for (i = 0; i < NARRAY; i++)
+        {
+          mpfr_urandomb (x[i], RANDS);
+          /* exponents in a range larger than the table of
+             mpfr_get_str_array, with repetitions */
+          mpfr_mul_2si (x[i], x[i], (long) (randlimb () % 200) - 100,
+                        MPFR_RNDN);
+          if (randlimb () & 1)
+            mpfr_neg (x[i], x[i], MPFR_RNDN);
+        }
+      mpfr_set_nan (x[3]);
+      mpfr_set_inf (x[5], -1);
+      mpfr_set_inf (x[6], 1);
+      mpfr_set_zero (x[7], -1);
+      mpfr_set_zero (x[8], 1);
+
+      size = mpfr_get_str_array (NULL, offsets, e, b, m, tab, NARRAY, r);
+      buf = (char *) tests_allocate (size + 1);
+      buf[size] = 'X';
+      mpfr_clear_flags ();
+      if (mpfr_get_str_array (buf, offsets, e, b, m, tab, NARRAY, r) != size
+          || buf[size] != 'X' || !mpfr_nanflag_p ())
+        {
+          printf ("Error in mpfr_get_str_array: wrong size or flags"
+                  " (b=%d, m=%lu)\n", b, (unsigned long) m);
+          exit (1);
+        }
+      for (i = 0; i < NARRAY; i++)
+        {
+          s = mpfr_get_str (NULL, &f, b, m, x[i], r);
+          if (strcmp (buf + offsets[i], s) != 0
+              || (i != 0 && offsets[i] != offsets[i-1]
+                  + strlen (buf + offsets[i-1]) + 1)
+              || (mpfr_number_p (x[i]) && e[i] != f))
+            {
+              printf ("Error in mpfr_get_str_array for b=%d m=%lu %s, x=",
+                      b, (unsigned long) m, mpfr_print_rnd_mode (r));
+              mpfr_dump (x[i]);
+              printf ("expected %s e=%ld\n", s, (long) f);
+              printf ("got      %s e=%ld\n", buf + offsets[i], (long) e[i]);
+              exit (1);
+            }
+          mpfr_free_str (s);
+        }
+      tests_free (buf, size + 1);
+    }
+
+  for (i = 0; i < NARRAY; i++)
+    mpfr_clear (x[i]);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -1268,6 +1530,10 @@ main (int argc, char *argv[])
 
   check_bug_base2k ();
   check_reduced_exprange ();
+  check_repeated ();
+  check_shortest ();
+  check_shortest_direct ();
+  check_array ();
 
   tests_end_mpfr ();
   return 0;
@@ -22,6 +22,319 @@ http://www.gnu.org/licenses/ or write to the Free Software Foundation, Inc.,
 
 #include "mpfr-test.h"
 
+/* Exercise the cache of significands (see src/free_cache.c): live numbers
+   must keep their own significand whatever the order of the calls. */
+static void
+check_significand_cache (void)
+{
+  mpfr_t x[40];
+  int live[40];
+  void *m;
+  int i, j, k;
+
+  for (i = 0; i < 40; i++)
+    live[i] = 0;
+  for (k = 0; k < 2000; k++)
+    {
+      i = randlimb () % 40;
+      if (live[i] && (randlimb () & 1))
+        {
+          mpfr_clear (x[i]);
+          live[i] = 0;
+        }
+      else
+        {
+          mpfr_prec_t p = 8 + randlimb () % (20 * GMP_NUMB_BITS);
+
+          if (live[i])
+            mpfr_set_prec (x[i], p);
+          else
+            mpfr_init2 (x[i], p);
+          live[i] = 1;
+          mpfr_set_ui (x[i], i, MPFR_RNDN);
+          mpfr_nextabove (x[i]);
+        }
+      for (j = 0; j < 40; j++)
+        if (live[j])
+          {
+            MPFR_ASSERTN (mpfr_check (x[j]));
+            MPFR_ASSERTN (mpfr_cmp_ui (x[j], j) > 0);
+            mpfr_nextbelow (x[j]);
+            MPFR_ASSERTN (mpfr_cmp_ui (x[j], j) == 0);
+            mpfr_nextabove (x[j]);
+          }
+    }
+  for (i = 0; i < 40; i++)
+    if (live[i])
+      mpfr_clear (x[i]);
+
+  /* a freed significand is reused by the next number of the same size */
+  mpfr_init2 (x[0], 3 * GMP_NUMB_BITS);
+  m = MPFR_MANT (x[0]);
+  mpfr_clear (x[0]);
+  mpfr_init2 (x[1], 3 * GMP_NUMB_BITS - 1);
+#if MPFR_MY_SIGNIFICAND_LIMBS >= 3 && MPFR_MY_SIGNIFICAND_DEPTH > 0
+  MPFR_ASSERTN (MPFR_MANT (x[1]) == m);
+#endif
+  mpfr_clear (x[1]);
+
+  /* the cache is local to the thread, thus kept by MPFR_FREE_GLOBAL_CACHE */
+  mpfr_free_cache2 (MPFR_FREE_GLOBAL_CACHE);
+  mpfr_init2 (x[1], 3 * GMP_NUMB_BITS);
+#if MPFR_MY_SIGNIFICAND_LIMBS >= 3 && MPFR_MY_SIGNIFICAND_DEPTH > 0
+  MPFR_ASSERTN (MPFR_MANT (x[1]) == m);
+#endif
+  mpfr_clear (x[1]);
+  mpfr_free_cache ();
+}
+
+#if !defined(MPFR_MY_MPZ_INIT) || MPFR_MY_MPZ_INIT != 0
+/* Check the size classes of the mpz_t pool (see src/free_cache.c) */
+static void
+check_mpz_pool (void)
+{
+  mpfr_mpz_pool_stats_t s0, s1;
+  mpz_t a, b, c;
+  int depth;
+
+  depth = mpfr_mpz_pool_set_depth (0);
+  mpfr_mpz_pool_set_depth (4);
+  mpfr_mpz_pool_get_stats (&s0);
+
+  mpz_init2 (a, 2 * GMP_NUMB_BITS);
+  mpz_init2 (b, 100 * GMP_NUMB_BITS);
+  mpz_clear (a);
+  mpz_clear (b);
+  /* the mpz_t of 100 limbs is the only one large enough */
+  mpz_init2 (c, 50 * GMP_NUMB_BITS);
+  MPFR_ASSERTN (ALLOC (c) >= 100);
+  /* the other one is reused without a size */
+  mpz_init (a);
+  mpz_set_ui (a, 17);
+  mpz_mul (c, a, a);
+  MPFR_ASSERTN (mpz_cmp_ui (c, 289) == 0);
+  mpfr_mpz_pool_get_stats (&s1);
+  MPFR_ASSERTN (s1.misses - s0.misses == 2);
+  MPFR_ASSERTN (s1.hits - s0.hits == 2);
+  MPFR_ASSERTN (s1.reallocs == s0.reallocs);
+
+  /* the mpz_t of 100 limbs is too small: it is reallocated */
+  mpz_clear (c);
+  mpz_init2 (b, 120 * GMP_NUMB_BITS);
+  MPFR_ASSERTN (ALLOC (b) >= 120 && mpz_sgn (b) == 0);
+  mpfr_mpz_pool_get_stats (&s0);
+  MPFR_ASSERTN (s0.hits - s1.hits == 1);
+  MPFR_ASSERTN (s0.reallocs - s1.reallocs == 1);
+  mpz_clear (a);
+  mpz_clear (b);
+
+  /* mpz_init without a size takes the smallest one, and leaves the large
+     one for mpz_init2 */
+  mpz_init2 (a, 2 * GMP_NUMB_BITS);
+  mpz_init2 (b, 100 * GMP_NUMB_BITS);
+  mpz_clear (b);
+  mpz_clear (a);
+  mpz_init (a);
+  MPFR_ASSERTN (ALLOC (a) < 100);
+  mpfr_mpz_pool_get_stats (&s1);
+  mpz_init2 (b, 100 * GMP_NUMB_BITS);
+  mpfr_mpz_pool_get_stats (&s0);
+  MPFR_ASSERTN (s0.hits - s1.hits == 1 && s0.reallocs == s1.reallocs);
+  mpz_clear (a);
+  mpz_clear (b);
+
+  MPFR_ASSERTN (mpfr_mpz_pool_set_depth (depth) == 4);
+}
+#endif
+
+/* Check mpfr_array_init2, mpfr_array_set_prec and mpfr_array_clear */
+static void
+check_array (void)
+{
+  mpfr_t x[50], y;
+  mpfr_ptr z;
+  size_t stride;
+  void *m;
+  int i;
+
+  mpfr_array_init2 (x[0], 50, 100);
+  MPFR_ASSERTN ((size_t) MPFR_GET_REAL_PTR (x[0]) % 64 == 0);
+  stride = (char *) MPFR_MANT (x[1]) - (char *) MPFR_MANT (x[0]);
+  MPFR_ASSERTN (stride >= MPFR_MALLOC_SIZE (MPFR_PREC2LIMBS (100)));
+  mpfr_init2 (y, 100);
+  for (i = 0; i < 50; i++)
+    {
+      MPFR_ASSERTN (mpfr_nan_p (x[i]) && mpfr_get_prec (x[i]) == 100);
+      MPFR_ASSERTN ((char *) MPFR_MANT (x[i]) - (char *) MPFR_MANT (x[0])
+                    == i * stride);
+      mpfr_sqrt_ui (x[i], i, MPFR_RNDN);
+    }
+  mpfr_clear (x[7]);  /* no effect */
+  for (i = 0; i < 50; i++)
+    {
+      mpfr_sqrt_ui (y, i, MPFR_RNDN);
+      MPFR_ASSERTN (mpfr_check (x[i]) && mpfr_equal_p (x[i], y));
+    }
+
+  /* a smaller precision keeps the block */
+  m = MPFR_MANT (x[0]);
+  mpfr_array_set_prec (x[0], 50, 20);
+  MPFR_ASSERTN (MPFR_MANT (x[0]) == m);
+  for (i = 0; i < 50; i++)
+    MPFR_ASSERTN (mpfr_nan_p (x[i]) && mpfr_get_prec (x[i]) == 20);
+  mpfr_set_prec (x[3], 50);
+
+  /* a larger one needs a new block */
+  mpfr_array_set_prec (x[0], 50, 1000);
+  mpfr_set_prec (y, 1000);
+  for (i = 0; i < 50; i++)
+    {
+      MPFR_ASSERTN (mpfr_nan_p (x[i]) && mpfr_get_prec (x[i]) == 1000);
+      mpfr_const_pi (x[i], MPFR_RNDN);
+      mpfr_div_ui (x[i], x[i], i + 1, MPFR_RNDN);
+    }
+  for (i = 0; i < 50; i++)
+    {
+      mpfr_const_pi (y, MPFR_RNDN);
+      mpfr_div_ui (y, y, i + 1, MPFR_RNDN);
+      MPFR_ASSERTN (mpfr_check (x[i]) && mpfr_equal_p (x[i], y));
+    }
+  mpfr_array_clear (x[0], 50);
+  mpfr_clear (y);
+
+  /* array allocated by the user, and empty array */
+  z = (mpfr_ptr) tests_allocate (3 * sizeof (__mpfr_struct));
+  mpfr_array_init2 (z, 3, MPFR_PREC_MIN);
+  mpfr_set_si (z + 2, -1, MPFR_RNDN);
+  MPFR_ASSERTN (mpfr_cmp_si (z + 2, -1) == 0 && mpfr_nan_p (z + 1));
+  mpfr_array_clear (z, 3);
+  mpfr_array_init2 (z, 0, 53);
+  mpfr_array_set_prec (z, 0, 100);
+  mpfr_array_clear (z, 0);
+  tests_free (z, 3 * sizeof (__mpfr_struct));
+}
+
+/* Check the scratch stack (see src/scratch.c) with nested allocations of
+   growing sizes, which do not overlap. */
+static void
+check_scratch_aux (int depth, size_t n)
+{
+  mpfr_scratch_mark_t m;
+  mp_limb_t *p, *q;
+  size_t i;
+
+  mpfr_scratch_mark (&m);
+  p = mpfr_scratch_alloc (n);
+  for (i = 0; i < n; i++)
+    p[i] = (mp_limb_t) (depth + i);
+  if (depth > 0)
+    {
+      check_scratch_aux (depth - 1, 3 * n);
+      /* release and allocate again, like MPFR_GROUP_REPREC */
+      mpfr_scratch_release (&m);
+      mpfr_scratch_mark (&m);
+      q = mpfr_scratch_alloc (2 * n);
+      for (i = 0; i < 2 * n; i++)
+        q[i] = (mp_limb_t) (depth + i);
+      check_scratch_aux (depth - 1, n + 1);
+      for (i = 0; i < 2 * n; i++)
+        MPFR_ASSERTN (q[i] == (mp_limb_t) (depth + i));
+    }
+  else
+    for (i = 0; i < n; i++)
+      MPFR_ASSERTN (p[i] == (mp_limb_t) (depth + i));
+  mpfr_scratch_release (&m);
+}
+
+static void
+check_scratch (void)
+{
+  int k;
+
+  for (k = 0; k < 3; k++)
+    check_scratch_aux (6, 1 + randlimb () % 100);
+  mpfr_free_cache ();
+}
+
+/* Check mpfr_small_init2 and MPFR_DECL_SMALL */
+static void
+check_small (void)
+{
+  mpfr_small_t s[10];
+  mpfr_ptr x[10];
+  mpfr_t y;
+  mpfr_prec_t p;
+  int i;
+
+  mpfr_init2 (y, MPFR_SMALL_PREC_MAX);
+  for (i = 0; i < 10; i++)
+    {
+      p = 1 + (i * (MPFR_SMALL_PREC_MAX - 1)) / 9;
+      x[i] = mpfr_small_init2 (s[i], p);
+      MPFR_ASSERTN (x[i] == MPFR_SMALL_PTR (s[i]));
+      MPFR_ASSERTN (mpfr_nan_p (x[i]) && mpfr_get_prec (x[i]) == p);
+      MPFR_ASSERTN (MPFR_MANT (x[i]) == s[i]->_mpfr_d);
+      mpfr_set_ui (x[i], i + 1, MPFR_RNDN);
+      mpfr_log (x[i], x[i], MPFR_RNDN);
+      MPFR_ASSERTN (mpfr_check (x[i]));
+      mpfr_set_prec (y, p);
+      mpfr_set_ui (y, i + 1, MPFR_RNDN);
+      mpfr_log (y, y, MPFR_RNDN);
+      MPFR_ASSERTN (mpfr_equal_p (x[i], y));
+    }
+  for (i = 0; i < 10; i++)
+    mpfr_clear (x[i]);  /* no effect */
+
+  /* the precision can be changed in place up to MPFR_SMALL_PREC_MAX */
+  mpfr_set_prec (x[0], MPFR_SMALL_PREC_MAX);
+  MPFR_ASSERTN (MPFR_MANT (x[0]) == s[0]->_mpfr_d);
+  mpfr_const_pi (x[0], MPFR_RNDN);
+  mpfr_set_prec (y, MPFR_SMALL_PREC_MAX);
+  mpfr_const_pi (y, MPFR_RNDN);
+  MPFR_ASSERTN (mpfr_equal_p (x[0], y));
+  mpfr_prec_round (x[0], MPFR_SMALL_PREC_MAX + 1, MPFR_RNDN);  /* heap */
+  MPFR_ASSERTN (MPFR_MANT (x[0]) != s[0]->_mpfr_d);
+  MPFR_ASSERTN (mpfr_check (x[0]) && mpfr_equal_p (x[0], y));
+  mpfr_clear (x[0]);  /* frees the heap significand */
+
+  /* larger precisions are allocated as by mpfr_init2, and the memory
+     checker of the tests detects a missing mpfr_clear */
+  x[0] = mpfr_small_init2 (s[0], MPFR_SMALL_PREC_MAX + 1);
+  MPFR_ASSERTN (MPFR_MANT (x[0]) != s[0]->_mpfr_d);
+  mpfr_const_pi (x[0], MPFR_RNDN);
+  mpfr_set_prec (y, MPFR_SMALL_PREC_MAX + 1);
+  mpfr_const_pi (y, MPFR_RNDN);
+  MPFR_ASSERTN (mpfr_check (x[0]) && mpfr_equal_p (x[0], y));
+  mpfr_set_prec (x[0], 1000);
+  mpfr_const_pi (x[0], MPFR_RNDN);
+  MPFR_ASSERTN (mpfr_check (x[0]));
+  mpfr_clear (x[0]);
+
+  mpfr_clear (y);
+
+  {
+    MPFR_DECL_SMALL (a, 53);
+    MPFR_DECL_SMALL (b, 53);
+
+    mpfr_set_d (a, 1.5, MPFR_RNDN);
+    mpfr_mul (b, a, a, MPFR_RNDN);
+    mpfr_sqrt (b, b, MPFR_RNDN);
+    MPFR_ASSERTN (mpfr_get_d (b, MPFR_RNDN) == 1.5);
+    mpfr_swap (a, b);
+    mpfr_clear (a);
+    mpfr_clear (b);
+  }
+  {
+    MPFR_DECL_SMALL (c, MPFR_SMALL_PREC_MAX + 1);
+
+    MPFR_ASSERTN (mpfr_get_prec (c) == MPFR_SMALL_PREC_MAX + 1);
+    mpfr_set_ui (c, 3, MPFR_RNDN);
+    mpfr_sqrt (c, c, MPFR_RNDN);
+    MPFR_ASSERTN (mpfr_check (c) && mpfr_cmp_ui (c, 1) > 0);
+    mpfr_clear (c);
+  }
+}
+
 int
 main (void)
 {
@@ -35,6 +348,14 @@ main (void)
   mpfr_inits2 (200, a, b, c, (mpfr_ptr) 0);
   mpfr_clears (a, b, c, (mpfr_ptr) 0);
 
+  check_significand_cache ();
+  check_array ();
+  check_scratch ();
+  check_small ();
+#if !defined(MPFR_MY_MPZ_INIT) || MPFR_MY_MPZ_INIT != 0
+  check_mpz_pool ();
+#endif
+
   /* test for precision 2^31-1, see
      https://gforge.inria.fr/tracker/index.php?func=detail&aid=13918 */
   large_prec = 2147483647;
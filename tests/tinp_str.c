@@ -22,6 +22,192 @@ http://www.gnu.org/licenses/ or write to the Free Software Foundation, Inc.,
 
 #include "mpfr-test.h"
 
+#define FILE_NAME "tinp_str.tmp"
+
+/* Open FILE_NAME for reading, through a pipe (which is not seekable) if
+   use_pipe is non-zero. */
+static FILE *
+reopen (int use_pipe)
+{
+  FILE *f;
+
+#ifdef HAVE_POPEN
+  if (use_pipe)
+    f = popen ("cat " FILE_NAME, "r");
+  else
+#endif
+    f = fopen (FILE_NAME, "r");
+  if (f == NULL)
+    {
+      printf ("Error, can't open " FILE_NAME " for reading\n");
+      exit (1);
+    }
+  return f;
+}
+
+static void
+close_file (FILE *f, int use_pipe)
+{
+#ifdef HAVE_POPEN
+  if (use_pipe)
+    {
+      /* read the end of the output of cat */
+      while (getc (f) != EOF)
+        ;
+      pclose (f);
+    }
+  else
+#endif
+    fclose (f);
+}
+
+static FILE *
+open_with (const char *s, int use_pipe)
+{
+  FILE *f;
+
+  f = fopen (FILE_NAME, "w");
+  if (f == NULL)
+    {
+      printf ("Error, can't open " FILE_NAME " for writing\n");
+      exit (1);
+    }
+  fprintf (f, " %s 7", s);
+  fclose (f);
+  return reopen (use_pipe);
+}
+
+/* Check numbers with more digits than stored by mpfr_inp_str, close to
+   a rounding boundary, so that more digits have to be read again. */
+static void
+check_long (int use_pipe)
+{
+  mpfr_t g, x, y;
+  mpfr_prec_t p;
+  mpfr_exp_t e;
+  char *s, *t;
+  size_t k, n, size;
+  FILE *f;
+  int i, base, r;
+
+  for (i = 0; i < 200; i++)
+    {
+      p = 3 + randlimb () % 60;
+      base = i % 3 ? 10 : 3;
+      r = RND_RAND ();
+      mpfr_init2 (g, p + 1);
+      mpfr_init2 (x, p);
+      mpfr_init2 (y, p);
+      /* g is a rounding boundary for the precision p */
+      mpfr_urandomb (g, RANDS);
+      mpfr_nextabove (g);
+      mpfr_mul_2si (g, g, (long) (randlimb () % 10000) - 5000, MPFR_RNDN);
+      s = mpfr_get_str (NULL, &e, base, 3000, g, MPFR_RNDN);
+      n = strlen (s);
+      size = n + 64;
+      t = (char *) tests_allocate (size);
+      if (i % 4 == 0 && s[n - 1] > '1')
+        s[n - 1]--;
+      sprintf (t, "0.%s%s@%ld", s, i % 2 ? "0000000001" : "", (long) e);
+      mpfr_free_str (s);
+
+      f = open_with (t, use_pipe);
+      k = mpfr_inp_str (x, f, base, (mpfr_rnd_t) r);
+      n = strlen (t);
+      MPFR_ASSERTN (mpfr_set_str (y, t, base, (mpfr_rnd_t) r) == 0);
+      if (k != n + 1 || ! mpfr_equal_p (x, y))
+        {
+          printf ("Error in mpfr_inp_str for %s (base %d, %s%s)\n", t,
+                  base, mpfr_print_rnd_mode ((mpfr_rnd_t) r),
+                  use_pipe ? ", pipe" : "");
+          printf ("expected "); mpfr_dump (y);
+          printf ("got      "); mpfr_dump (x);
+          exit (1);
+        }
+      /* the next word must not have been read */
+      k = mpfr_inp_str (x, f, 10, MPFR_RNDN);
+      MPFR_ASSERTN (k == 2 && mpfr_cmp_ui (x, 7) == 0);
+      close_file (f, use_pipe);
+
+      tests_free (t, size);
+      mpfr_clear (g);
+      mpfr_clear (x);
+      mpfr_clear (y);
+    }
+  remove (FILE_NAME);
+}
+
+/* Check that huge numbers are read in bounded memory. */
+static void
+check_huge (int use_pipe)
+{
+  mpfr_t x, y;
+  size_t limit;
+  long n = 1000000, i;
+  FILE *f;
+  int r;
+
+  mpfr_init2 (x, 53);
+  mpfr_init2 (y, 53);
+  RND_LOOP (r)
+    {
+      /* 10^n + 1/2, with n+1 digits in the integer part */
+      f = fopen (FILE_NAME, "w");
+      MPFR_ASSERTN (f != NULL);
+      putc ('1', f);
+      for (i = 0; i < n; i++)
+        putc ('0', f);
+      fputs (".5 7", f);
+      fclose (f);
+      f = reopen (use_pipe);
+      limit = tests_memory_limit;
+      tests_memory_limit = 100000;
+      i = mpfr_inp_str (x, f, 10, (mpfr_rnd_t) r);
+      tests_memory_limit = limit;
+      close_file (f, use_pipe);
+      /* 10^n is not exactly representable, and at distance at least 2^n
+         from a rounding boundary */
+      mpfr_set_str (y, "1e1000000", 10, (mpfr_rnd_t) r);
+      if (i != n + 3 || ! mpfr_equal_p (x, y))
+        {
+          printf ("Error in mpfr_inp_str for 10^%ld + 1/2 (%s%s)\n", n,
+                  mpfr_print_rnd_mode ((mpfr_rnd_t) r),
+                  use_pipe ? ", pipe" : "");
+          printf ("expected "); mpfr_dump (y);
+          printf ("got      "); mpfr_dump (x);
+          exit (1);
+        }
+
+      /* 10^(-n-1), with n leading zeros in the fractional part */
+      f = fopen (FILE_NAME, "w");
+      MPFR_ASSERTN (f != NULL);
+      fputs ("0.", f);
+      for (i = 0; i < n; i++)
+        putc ('0', f);
+      fputs ("1 7", f);
+      fclose (f);
+      f = reopen (use_pipe);
+      limit = tests_memory_limit;
+      tests_memory_limit = 100000;
+      i = mpfr_inp_str (x, f, 10, (mpfr_rnd_t) r);
+      tests_memory_limit = limit;
+      close_file (f, use_pipe);
+      mpfr_set_str (y, "1e-1000001", 10, (mpfr_rnd_t) r);
+      if (i != n + 3 || ! mpfr_equal_p (x, y))
+        {
+          printf ("Error in mpfr_inp_str for 10^(-%ld) (%s%s)\n", n + 1,
+                  mpfr_print_rnd_mode ((mpfr_rnd_t) r),
+                  use_pipe ? ", pipe" : "");
+          printf ("expected "); mpfr_dump (y);
+          printf ("got      "); mpfr_dump (x);
+          exit (1);
+        }
+    }
+  remove (FILE_NAME);
+  mpfr_clear (x);
+  mpfr_clear (y);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -96,6 +282,13 @@ main (int argc, char *argv[])
   mpfr_clear (x);
   mpfr_clear (y);
 
+  check_long (0);
+  check_huge (0);
+#ifdef HAVE_POPEN
+  check_long (1);
+  check_huge (1);
+#endif
+
   tests_end_mpfr ();
   return 0;
 }
@@ -1596,6 +1596,113 @@ tst20140422 (void)
   mpfr_clears (x, y, z1, z2, (mpfr_ptr) 0);
 }
 
+/* Check that mpfr_pow_prepared gives the same results (value, ternary
+   value and flags) as mpfr_pow, with the same prepared base used for
+   several exponents and increasing target precisions. */
+static void
+check_prepared (void)
+{
+  mpfr_t x, y, z1, z2;
+  mpfr_pow_prepared_t p;
+  mpfr_flags_t flags1, flags2;
+  int i, j, inex1, inex2;
+  mpfr_rnd_t rnd;
+
+  mpfr_init2 (x, 100);
+  mpfr_init2 (y, 100);
+  mpfr_init2 (z1, MPFR_PREC_MIN);
+  mpfr_init2 (z2, MPFR_PREC_MIN);
+
+  for (i = 0; i < 30; i++)
+    {
+      mpfr_set_prec (x, MPFR_PREC_MIN + (randlimb () % 100));
+      switch (i)
+        {
+        case 0:
+          mpfr_set_nan (x);
+          break;
+        case 1:
+          mpfr_set_inf (x, -1);
+          break;
+        case 2:
+          mpfr_set_zero (x, -1);
+          break;
+        case 3:
+          mpfr_set_si (x, -1, MPFR_RNDN);
+          break;
+        case 4:
+          mpfr_set_ui_2exp (x, 1, -17, MPFR_RNDN);
+          break;
+        case 5:
+          mpfr_set_ui (x, 1296, MPFR_RNDN);  /* 1296^(3/4) = 216 */
+          break;
+        default:
+          mpfr_urandomb (x, RANDS);
+          mpfr_mul_2si (x, x, (long) (randlimb () % 41) - 20, MPFR_RNDN);
+          if (randlimb () % 2)
+            mpfr_neg (x, x, MPFR_RNDN);
+        }
+      mpfr_pow_prepared_init (p, x);
+
+      for (j = 0; j < 40; j++)
+        {
+          mpfr_set_prec (y, MPFR_PREC_MIN + (randlimb () % 64));
+          switch (j % 8)
+            {
+            case 0:
+              mpfr_set_si (y, (long) (randlimb () % 21) - 10, MPFR_RNDN);
+              break;
+            case 1:
+              mpfr_set_si_2exp (y, (long) (randlimb () % 21) - 10, -2,
+                                MPFR_RNDN);
+              break;
+            case 2:
+              /* large exponent, possible overflow or underflow */
+              mpfr_urandomb (y, RANDS);
+              mpfr_mul_2ui (y, y, 32, MPFR_RNDN);
+              break;
+            default:
+              mpfr_urandomb (y, RANDS);
+              mpfr_mul_2si (y, y, (long) (randlimb () % 11) - 5, MPFR_RNDN);
+            }
+          if (randlimb () % 2)
+            mpfr_neg (y, y, MPFR_RNDN);
+
+          mpfr_set_prec (z1, MPFR_PREC_MIN + j * 10 + (randlimb () % 10));
+          mpfr_set_prec (z2, MPFR_PREC (z1));
+          rnd = RND_RAND ();
+          mpfr_clear_flags ();
+          inex1 = mpfr_pow (z1, x, y, rnd);
+          flags1 = __gmpfr_flags;
+          mpfr_clear_flags ();
+          inex2 = mpfr_pow_prepared (z2, p, y, rnd);
+          flags2 = __gmpfr_flags;
+          if ((mpfr_nan_p (z1) ? ! mpfr_nan_p (z2) :
+               ! mpfr_equal_p (z1, z2) || MPFR_SIGN (z1) != MPFR_SIGN (z2))
+              || SIGN (inex1) != SIGN (inex2) || flags1 != flags2)
+            {
+              printf ("Error in check_prepared for %s\n",
+                      mpfr_print_rnd_mode (rnd));
+              printf ("x = ");
+              mpfr_dump (x);
+              printf ("y = ");
+              mpfr_dump (y);
+              printf ("Expected inex = %d, flags = %u, z = ", inex1,
+                      (unsigned int) flags1);
+              mpfr_dump (z1);
+              printf ("Got      inex = %d, flags = %u, z = ", inex2,
+                      (unsigned int) flags2);
+              mpfr_dump (z2);
+              exit (1);
+            }
+        }
+
+      mpfr_pow_prepared_clear (p);
+    }
+
+  mpfr_clears (x, y, z1, z2, (mpfr_ptr) 0);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -1625,6 +1732,7 @@ main (int argc, char **argv)
   bug20080820 ();
   bug20110320 ();
   tst20140422 ();
+  check_prepared ();
 
   test_generic (MPFR_PREC_MIN, 100, 100);
   test_generic_ui (MPFR_PREC_MIN, 100, 100);
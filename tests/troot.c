@@ -359,6 +359,109 @@ exact_powers (unsigned long bmax, unsigned long kmax)
   mpz_clear (z);
 }
 
+/* Check the Newton iteration used in large precision (see mpfr_root_newton)
+   with exact comparisons: if y = root(x,k) is rounded toward zero, then
+   y^k <= x < nextabove(y)^k, and similarly for the other rounding modes.
+   For j < 2, x is an exact k-th power, whose root must be returned exactly;
+   for odd k, x is negative when j is odd. */
+static void
+check_newton (void)
+{
+  static const unsigned long kk[] = { 4, 5, 7, 17, 100 };
+  mpfr_t x, y, z, zk, w;
+  mpfr_prec_t p;
+  unsigned long k;
+  long s;
+  int i, j, r, t, inex, cmp, ok, neg;
+
+  for (i = 0; i < sizeof (kk) / sizeof (kk[0]); i++)
+    for (j = 0; j < 6; j++)
+      {
+        k = kk[i];
+        neg = (k & 1) && (j & 1);
+        p = MAX (MPFR_ROOT_THRESHOLD / (k * k), 2 * GMP_NUMB_BITS)
+          + 1 + randlimb () % 64;
+        mpfr_init2 (x, p + randlimb () % 64);
+        mpfr_init2 (y, p);
+        mpfr_init2 (z, p + 1);
+        mpfr_init2 (zk, k * (p + 1));
+        mpfr_init2 (w, p / 2);
+        s = (long) (randlimb () % 201) - 100;
+        if (j < 2)
+          {
+            /* exact root w, with a shift multiple of k so that
+               (w^k * 2^(s*k))^(1/k) = w * 2^s is exact */
+            mpfr_urandomb (w, RANDS);
+            if (neg)
+              mpfr_neg (w, w, MPFR_RNDN);
+            mpfr_set_prec (x, k * (p / 2));
+            inex = mpfr_pow_ui (x, w, k, MPFR_RNDN);
+            MPFR_ASSERTN (inex == 0);
+            mpfr_mul_2si (x, x, s * (long) k, MPFR_RNDN);
+            mpfr_mul_2si (w, w, s, MPFR_RNDN);
+          }
+        else
+          {
+            mpfr_urandomb (x, RANDS);
+            if (neg)
+              mpfr_neg (x, x, MPFR_RNDN);
+            mpfr_mul_2si (x, x, s, MPFR_RNDN);
+          }
+        RND_LOOP (r)
+          {
+            inex = mpfr_root (y, x, k, (mpfr_rnd_t) r);
+            if (j < 2 && (inex != 0 || ! mpfr_equal_p (y, w)))
+              {
+                printf ("Error in check_newton for k=%lu, %s (exact root)\n"
+                        "x = ", k, mpfr_print_rnd_mode ((mpfr_rnd_t) r));
+                mpfr_dump (x);
+                printf ("expected "); mpfr_dump (w);
+                printf ("got      "); mpfr_dump (y);
+                printf ("inex = %d\n", inex);
+                exit (1);
+              }
+            /* sign(y - x^(1/k)) = sign(y^k - x) */
+            t = mpfr_pow_ui (zk, y, k, MPFR_RNDN);
+            MPFR_ASSERTN (t == 0);
+            cmp = mpfr_cmp (zk, x);
+            ok = SIGN (inex) == cmp;
+            if (ok && cmp != 0)
+              {
+                /* z = other end of the allowed interval (in precision p+1):
+                   the midpoint for MPFR_RNDN, the neighbour of y otherwise */
+                mpfr_set (z, y, MPFR_RNDN);
+                for (t = (r == MPFR_RNDN) ? 1 : 2; t > 0; t--)
+                  if (cmp < 0)
+                    mpfr_nextabove (z);
+                  else
+                    mpfr_nextbelow (z);
+                t = mpfr_pow_ui (zk, z, k, MPFR_RNDN);
+                MPFR_ASSERTN (t == 0);
+                t = mpfr_cmp (zk, x);
+                ok = t * cmp < 0 || (r == MPFR_RNDN && t == 0);
+                /* y < x^(1/k) is a rounding toward -inf, i.e., toward
+                   zero if x > 0 and away from zero if x < 0 */
+                if (r != MPFR_RNDN && cmp < 0)
+                  ok = ok && (r == MPFR_RNDD
+                              || r == (neg ? MPFR_RNDA : MPFR_RNDZ));
+                if (r != MPFR_RNDN && cmp > 0)
+                  ok = ok && (r == MPFR_RNDU
+                              || r == (neg ? MPFR_RNDZ : MPFR_RNDA));
+              }
+            if (!ok)
+              {
+                printf ("Error in check_newton for k=%lu, %s\nx = ",
+                        k, mpfr_print_rnd_mode ((mpfr_rnd_t) r));
+                mpfr_dump (x);
+                printf ("got inex = %d, sign(y^k - x) = %d, y = ", inex, cmp);
+                mpfr_dump (y);
+                exit (1);
+              }
+          }
+        mpfr_clears (x, y, z, zk, w, (mpfr_ptr) 0);
+      }
+}
+
 /* Compare root(x,2^h) with pow(x,2^(-h)). */
 static void
 cmp_pow (void)
@@ -465,6 +568,7 @@ main (int argc, char *argv[])
   special ();
   bigint ();
   cmp_pow ();
+  check_newton ();
 
   mpfr_init (x);
 
@@ -528,6 +632,10 @@ main (int argc, char *argv[])
   bad_cases (root4, pow4, "mpfr_root[4]", 8, -256, 255, 4, 128, 800, 40);
   bad_cases (root5, pow5, "mpfr_root[5]", 8, -256, 255, 4, 128, 800, 40);
   bad_cases (root17, pow17, "mpfr_root[17]", 8, -256, 255, 4, 128, 800, 40);
+  bad_cases (root17, pow17, "mpfr_root[17]", 8, -256, 255,
+             MPFR_ROOT_THRESHOLD / (17 * 17) + 1,
+             MPFR_ROOT_THRESHOLD / (17 * 17) + 200,
+             64, 5);
   bad_cases (root120, pow120, "mpfr_root[120]", 8, -256, 255, 4, 128, 800, 40);
 
   tests_end_mpfr ();
@@ -1258,6 +1258,136 @@ check_emin (void)
   check_emin_aux (MPFR_EMIN_MIN);
 }
 
+/* ~ flag: shortest digits that read back to the same value */
+static void
+shortest (void)
+{
+  mpfr_t x;
+
+  mpfr_init2 (x, 53);
+
+  mpfr_set_str (x, "0.1", 10, MPFR_RNDN);
+  check_sprintf ("0.1", "%~Rg", x);
+  check_sprintf ("1e-01", "%~Re", x);
+  check_sprintf ("0.1", "%~Rf", x);
+  check_sprintf ("  0.1", "%~5Rf", x);
+  check_sprintf ("+0.1", "%+~.20RUf", x); /* precision and rounding ignored */
+
+  mpfr_set_str (x, "1e23", 10, MPFR_RNDN);
+  check_sprintf ("1e+23", "%~Rg", x);
+  check_sprintf ("1E+23", "%~RE", x);
+  check_sprintf ("100000000000000000000000", "%~Rf", x);
+
+  mpfr_set_str (x, "-123.456", 10, MPFR_RNDN);
+  check_sprintf ("-123.456", "%~Rg", x);
+  check_sprintf ("-1.23456e+02", "%~Re", x);
+
+  mpfr_set_ui (x, 1, MPFR_RNDN);
+  mpfr_div_ui (x, x, 3, MPFR_RNDN);
+  check_sprintf ("0.3333333333333333", "%~Rg", x);
+
+  mpfr_set_ui (x, 1200, MPFR_RNDN);
+  check_sprintf ("1.2e+03", "%~Rg", x);
+  check_sprintf ("1200", "%~Rf", x);
+
+  mpfr_set_str (x, "1e-5", 10, MPFR_RNDN);
+  check_sprintf ("1e-05", "%~Rg", x);
+  check_sprintf ("0.00001", "%~Rf", x);
+
+  mpfr_set_prec (x, 24);
+  mpfr_set_str (x, "0.1", 10, MPFR_RNDN);
+  check_sprintf ("0.1", "%~Rg", x);
+  mpfr_set_str (x, "16777215", 10, MPFR_RNDN);
+  check_sprintf ("16777215", "%~Rg", x);
+
+  mpfr_clear (x);
+}
+
+/* Check that the compiled formats give the same output as the usual
+   functions. */
+static void
+compiled (void)
+{
+  const char *fmt1 = "%i%% %RNE|%%|%-*.*RDf%n, %Zd%s";
+  const char *fmt2 = "[%*Pu] %-*x %'.20Rg%%";
+  mpfr_printf_format_t f1, f2, f3;
+  char s1[256], s2[256];
+  mpfr_prec_t p;
+  mpz_t z;
+  mpfr_t x;
+  int i, k1, k2, n1, n2, size;
+
+  mpz_init (z);
+  mpfr_init2 (x, 100);
+  f1 = mpfr_printf_compile (fmt1);
+  f2 = mpfr_printf_compile (fmt2);
+  f3 = mpfr_printf_compile ("100%% sure");
+  if (f1 == NULL || f2 == NULL || f3 == NULL)
+    {
+      printf ("Error in mpfr_printf_compile: unexpected NULL\n");
+      exit (1);
+    }
+
+  for (i = 0; i < 50; i++)
+    {
+      /* also check truncation and SIZE = 0 */
+      size = i < 40 ? sizeof (s1) : i - 40;
+      mpfr_urandomb (x, RANDS);
+      mpfr_mul_2si (x, x, (long) (randlimb () % 200) - 100, MPFR_RNDN);
+      if (i & 1)
+        mpfr_neg (x, x, MPFR_RNDN);
+      mpz_set_si (z, (long) randlimb () - 12345);
+      p = randlimb () % 1000;
+
+      s1[0] = s2[0] = '\0';
+      k1 = k2 = -1;
+      n1 = mpfr_snprintf_compiled (s1, size, f1, i, x, 5 - i, i % 30, x,
+                                   &k1, z, "end");
+      n2 = mpfr_snprintf (s2, size, fmt1, i, x, 5 - i, i % 30, x,
+                          &k2, z, "end");
+      if (n1 != n2 || k1 != k2 || strcmp (s1, s2) != 0)
+        {
+          printf ("Error in mpfr_snprintf_compiled with \"%s\", size %d\n",
+                  fmt1, size);
+          printf ("expected \"%s\" (%d, %%n = %d)\n", s2, n2, k2);
+          printf ("got      \"%s\" (%d, %%n = %d)\n", s1, n1, k1);
+          exit (1);
+        }
+
+      n1 = mpfr_snprintf_compiled (s1, size, f2, i - 20, p, 6, i, x);
+      n2 = mpfr_snprintf (s2, size, fmt2, i - 20, p, 6, i, x);
+      if (n1 != n2 || strcmp (s1, s2) != 0)
+        {
+          printf ("Error in mpfr_snprintf_compiled with \"%s\", size %d\n",
+                  fmt2, size);
+          printf ("expected \"%s\" (%d)\n", s2, n2);
+          printf ("got      \"%s\" (%d)\n", s1, n1);
+          exit (1);
+        }
+    }
+
+  n1 = mpfr_snprintf_compiled (s1, sizeof (s1), f3);
+  if (n1 != 9 || strcmp (s1, "100% sure") != 0)
+    {
+      printf ("Error in mpfr_snprintf_compiled with \"100%%%% sure\"\n");
+      printf ("got \"%s\" (%d)\n", s1, n1);
+      exit (1);
+    }
+
+  if (mpfr_printf_compile ("%Rd") != NULL
+      || mpfr_printf_compile ("abc%") != NULL)
+    {
+      printf ("Error in mpfr_printf_compile: invalid format accepted\n");
+      exit (1);
+    }
+
+  mpfr_printf_free_compiled (f1);
+  mpfr_printf_free_compiled (f2);
+  mpfr_printf_free_compiled (f3);
+  mpfr_clear (x);
+  mpz_clear (z);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -1276,6 +1406,8 @@ main (int argc, char **argv)
   binary ();
   decimal ();
   mixed ();
+  shortest ();
+  compiled ();
   check_emax ();
   check_emin ();
 
@@ -307,6 +307,197 @@ test2 (void)
 }
 
 
+static int
+same_value (mpfr_ptr x, mpfr_ptr y)
+{
+  return mpfr_nan_p (x) ? mpfr_nan_p (y) :
+    mpfr_equal_p (x, y) && mpfr_signbit (x) == mpfr_signbit (y);
+}
+
+/* test the tables of numbers in a fixed layout */
+static void
+test_table (void)
+{
+  mpfr_t x, v, v2, w[50];
+  void *table, *copy;
+  size_t size;
+  mpfr_prec_t prec;
+  unsigned long n, i;
+  int inex, inex2;
+
+  size = mpfr_custom_table_size (100, 50);
+  table = tests_allocate (size);
+  mpfr_custom_table_init (table, 100, 50);
+  if (mpfr_custom_table_check (table, size, &prec, &n) != 0
+      || prec != 100 || n != 50)
+    {
+      printf ("mpfr_custom_table_check failed on a new table\n");
+      exit (1);
+    }
+  if (mpfr_custom_table_check (table, size - 1, NULL, NULL) == 0)
+    {
+      printf ("mpfr_custom_table_check did not detect a too small size\n");
+      exit (1);
+    }
+  /* the number of elements is stored on 8 bytes in the byte order given
+     at offset 11, whatever the size of unsigned long */
+  for (i = 0; i < 8; i++)
+    MPFR_ASSERTN (((unsigned char *) table)[24 + i] ==
+                  ((((unsigned char *) table)[11] == 'L' ? i == 0 : i == 7)
+                   ? 50 : 0));
+
+  mpfr_init2 (x, 150);
+  for (i = 0; i < 50; i++)
+    {
+      mpfr_custom_table_get (v, table, i);
+      MPFR_ASSERTN (mpfr_nan_p (v) && mpfr_get_prec (v) == 100);
+
+      if (i == 0)
+        mpfr_set_inf (x, -1);
+      else if (i == 1)
+        mpfr_set_zero (x, -1);
+      else if (i == 2)
+        mpfr_set_nan (x);
+      else
+        {
+          mpfr_urandomb (x, RANDS);
+          mpfr_mul_2si (x, x, (long) (randlimb () % 20000) - 10000,
+                        MPFR_RNDN);
+          if (i % 2)
+            mpfr_neg (x, x, MPFR_RNDN);
+        }
+      mpfr_init2 (w[i], 100);
+      inex = mpfr_custom_table_set (table, i, x, MPFR_RNDN);
+      inex2 = mpfr_set (w[i], x, MPFR_RNDN);
+      mpfr_custom_table_get (v, table, i);
+      if (! same_value (v, w[i]) || ! SAME_SIGN (inex, inex2))
+        {
+          printf ("mpfr_custom_table_set failed for i=%lu\n", i);
+          printf ("expected "); mpfr_dump (w[i]);
+          printf ("got      "); mpfr_dump (v);
+          exit (1);
+        }
+    }
+
+  /* modify element 10 in place, through its view */
+  mpfr_custom_table_get (v, table, 10);
+  mpfr_mul_2ui (v, v, 1000, MPFR_RNDN);
+  mpfr_neg (v, v, MPFR_RNDN);
+  MPFR_ASSERTN (mpfr_custom_table_set (table, 10, v, MPFR_RNDN) == 0);
+  mpfr_mul_2ui (w[10], w[10], 1000, MPFR_RNDN);
+  mpfr_neg (w[10], w[10], MPFR_RNDN);
+
+  /* the table can be moved (e.g. written to a file, then mapped) */
+  copy = tests_allocate (size);
+  memcpy (copy, table, size);
+  memset (table, 0, size);
+  MPFR_ASSERTN (mpfr_custom_table_check (table, size, NULL, NULL) != 0);
+  MPFR_ASSERTN (mpfr_custom_table_check (copy, size, NULL, NULL) == 0);
+  for (i = 0; i < 50; i++)
+    {
+      mpfr_custom_table_get (v2, copy, i);
+      if (! same_value (v2, w[i]))
+        {
+          printf ("wrong element %lu in the copied table\n", i);
+          printf ("expected "); mpfr_dump (w[i]);
+          printf ("got      "); mpfr_dump (v2);
+          exit (1);
+        }
+      mpfr_clear (w[i]);
+    }
+
+  /* an element whose significand is not normalized, or has nonzero
+     trailing bits, is read as NaN */
+  for (i = 3; i < 5; i++)
+    {
+      mpfr_custom_table_get (v2, copy, i);
+      if (! mpfr_regular_p (v2))
+        continue;
+      if (i == 3)
+        MPFR_MANT (v2)[MPFR_LIMB_SIZE (v2) - 1] &= ~MPFR_LIMB_HIGHBIT;
+      else
+        MPFR_MANT (v2)[0] |= MPFR_LIMB_ONE;
+      mpfr_custom_table_get (v2, copy, i);
+      MPFR_ASSERTN (mpfr_nan_p (v2));
+    }
+
+  mpfr_clear (x);
+  tests_free (table, size);
+  tests_free (copy, size);
+}
+
+/* test the allocation of significands in an arena */
+static void
+test_arena (void)
+{
+  mpfr_arena_t a;
+  mpfr_t x[100], y, z;
+  mpfr_prec_t p;
+  void *chunk, *m;
+  int i, k;
+
+  mpfr_arena_init (a, 64);  /* small, so that the arena has to grow */
+  mpfr_init2 (y, 2);
+  mpfr_init2 (z, 2);
+  chunk = NULL;
+  for (k = 0; k < 3; k++)
+    {
+      for (i = 0; i < 100; i++)
+        {
+          p = 1 + (i * 37) % 300;
+          mpfr_init2_arena (x[i], p, a);
+          MPFR_ASSERTN (mpfr_nan_p (x[i]) && mpfr_get_prec (x[i]) == p);
+          MPFR_ASSERTN ((size_t) MPFR_MANT (x[i]) % sizeof (mp_limb_t) == 0);
+          mpfr_set_ui (x[i], i + 1, MPFR_RNDN);
+          mpfr_div_ui (x[i], x[i], 3, MPFR_RNDN);
+          MPFR_ASSERTN (mpfr_check (x[i]));
+        }
+      /* the significands do not overlap */
+      for (i = 0; i < 100; i++)
+        {
+          mpfr_set_prec (y, mpfr_get_prec (x[i]));
+          mpfr_set_ui (y, i + 1, MPFR_RNDN);
+          mpfr_div_ui (y, y, 3, MPFR_RNDN);
+          MPFR_ASSERTN (mpfr_equal_p (x[i], y));
+          mpfr_clear (x[i]);  /* no effect */
+        }
+      /* after a reset, the same allocations reuse a single chunk */
+      mpfr_arena_reset (a);
+      if (k > 0)
+        MPFR_ASSERTN (a->_mpfr_chunk == chunk);
+      chunk = a->_mpfr_chunk;
+    }
+
+  /* numbers in an arena can be used like the other ones */
+  mpfr_init2_arena (x[0], 100, a);
+  mpfr_init2_arena (x[1], 100, a);
+  mpfr_const_pi (x[0], MPFR_RNDN);
+  m = MPFR_MANT (x[0]);
+  mpfr_set_prec (x[0], 64);  /* stays in the arena */
+  MPFR_ASSERTN (MPFR_MANT (x[0]) == m);
+  mpfr_set_prec (x[0], 1000);  /* moved to the heap */
+  MPFR_ASSERTN (MPFR_MANT (x[0]) != m && ! MPFR_IS_ARENA_ALLOC (x[0]));
+  mpfr_const_pi (x[0], MPFR_RNDN);
+  MPFR_ASSERTN (mpfr_check (x[0]));
+  mpfr_clear (x[0]);
+
+  mpfr_const_pi (x[1], MPFR_RNDN);
+  mpfr_set_prec (y, 100);
+  mpfr_const_pi (y, MPFR_RNDN);
+  mpfr_prec_round (x[1], 500, MPFR_RNDN);  /* moved to the heap */
+  MPFR_ASSERTN (! MPFR_IS_ARENA_ALLOC (x[1]) && mpfr_equal_p (x[1], y));
+  mpfr_init2_arena (x[2], 200, a);
+  mpfr_set (x[2], x[1], MPFR_RNDN);
+  mpfr_swap (x[1], x[2]);
+  MPFR_ASSERTN (MPFR_IS_ARENA_ALLOC (x[1]) && mpfr_equal_p (x[1], y));
+  mpfr_clear (x[1]);
+  mpfr_clear (x[2]);  /* frees the heap significand */
+
+  mpfr_arena_clear (a);
+  mpfr_clear (y);
+  mpfr_clear (z);
+}
+
 int
 main (void)
 {
@@ -318,6 +509,8 @@ main (void)
       test2 ();
       test_nan_inf_zero ();
     }
+  test_table ();
+  test_arena ();
   tests_end_mpfr ();
   return 0;
 }
@@ -1189,6 +1189,153 @@ bug20120829 (void)
   mpfr_clears (e, x1, x2, (mpfr_ptr) 0);
 }
 
+/* Compare the fast path for short decimal strings with the general code,
+   which is used when the significand has more than 19 digits. */
+static void
+check_fast (void)
+{
+  mpfr_t x, y;
+  char s1[64], s2[64], *end1, *end2;
+  const char *suffix[] = { "", "e", "e+", "e 5", ".5", "@3", ",1" };
+  unsigned long w;
+  int i, j, r, q, inex1, inex2;
+
+  mpfr_inits2 (53, x, y, (mpfr_ptr) 0);
+  for (i = 0; i < 10000; i++)
+    {
+      mpfr_set_prec (x, 1 + (randlimb () % 100));
+      mpfr_set_prec (y, mpfr_get_prec (x));
+      w = randlimb () % 1000000000;
+      q = (int) (randlimb () % 71) - 35;
+      j = randlimb () % (sizeof (suffix) / sizeof (suffix[0]));
+      sprintf (s1, "%s%lu.%lue%d%s", (i & 1) ? "-" : "", w,
+               (unsigned long) (randlimb () % 1000000000), q, suffix[j]);
+      /* same value with trailing zeros, hence too many digits */
+      end1 = strchr (s1, 'e');
+      sprintf (s2, "%.*s000000000000000000000e%d%s", (int) (end1 - s1), s1,
+               q, suffix[j]);
+      RND_LOOP (r)
+        {
+          inex1 = mpfr_strtofr (x, s1, &end1, 10, (mpfr_rnd_t) r);
+          inex2 = mpfr_strtofr (y, s2, &end2, 10, (mpfr_rnd_t) r);
+          if (!mpfr_equal_p (x, y) || SIGN (inex1) != SIGN (inex2)
+              || strcmp (end1, end2) != 0)
+            {
+              printf ("Error in check_fast for %s, %s\n",
+                      s1, mpfr_print_rnd_mode ((mpfr_rnd_t) r));
+              printf ("Expected inex = %d, end = \"%s\", x = ", inex2,
+                      end2);
+              mpfr_dump (y);
+              printf ("Got      inex = %d, end = \"%s\", x = ", inex1,
+                      end1);
+              mpfr_dump (x);
+              exit (1);
+            }
+        }
+    }
+  mpfr_clears (x, y, (mpfr_ptr) 0);
+}
+
+/* Parse numbers one after the other in a buffer, like CSV data. */
+static void
+check_buffer (void)
+{
+  const char buf[] = "1.5,-2.25e1, 0x1.8p1;0x,0b.;.5.25@2 12";
+  const char *expected[] = { "1.5", "-22.5", "3", "0", "0", "0.5",
+                             "25", "12" };
+  const int base[] = { 10, 10, 0, 16, 0, 10, 10, 10 };
+  mpfr_t x, y;
+  char *s, *end;
+  int i;
+
+  mpfr_inits2 (53, x, y, (mpfr_ptr) 0);
+  s = (char *) buf;
+  for (i = 0; i < sizeof (base) / sizeof (base[0]); i++)
+    {
+      mpfr_strtofr (x, s, &end, base[i], MPFR_RNDN);
+      mpfr_set_str (y, expected[i], 10, MPFR_RNDN);
+      if (end == s || !mpfr_equal_p (x, y))
+        {
+          printf ("Error in check_buffer for i = %d\n", i);
+          printf ("Expected %s, got ", expected[i]);
+          mpfr_dump (x);
+          exit (1);
+        }
+      /* skip the rest of the field (e.g. "x" after "0") and the separator,
+         except after ".5", which is followed by the next number */
+      s = end;
+      if (*s != '.')
+        {
+          s += strcspn (s, ",; ");
+          if (*s != 0)
+            s++;
+        }
+    }
+  if (*s != 0)
+    {
+      printf ("Error in check_buffer: remaining \"%s\"\n", s);
+      exit (1);
+    }
+  mpfr_clears (x, y, (mpfr_ptr) 0);
+}
+
+/* Check the fast path for power-of-two bases: read back exact
+   representations of random numbers at another precision, and compare
+   with mpfr_set. */
+static void
+check_pow2 (void)
+{
+  mpfr_t x, y, z;
+  char *s, *t, *end;
+  mpfr_exp_t e;
+  int i, r, b, inex1, inex2;
+
+  mpfr_inits2 (300, x, y, z, (mpfr_ptr) 0);
+  for (i = 0; i < 1000; i++)
+    {
+      mpfr_set_prec (x, 1 + (randlimb () % 300));
+      mpfr_urandomb (x, RANDS);
+      if (MPFR_IS_ZERO (x))
+        continue;
+      mpfr_mul_2si (x, x, (long) (randlimb () % 200) - 100, MPFR_RNDN);
+      if (i & 1)
+        mpfr_neg (x, x, MPFR_RNDN);
+      mpfr_set_prec (y, 1 + (randlimb () % 300));
+      mpfr_set_prec (z, mpfr_get_prec (y));
+      b = 2 << (randlimb () % 5);
+      /* with n = 0, the digits are an exact representation of x */
+      s = mpfr_get_str (NULL, &e, b, 0, x, MPFR_RNDN);
+      t = (char *) tests_allocate (strlen (s) + 64);
+      if (b == 16 && (i & 2))
+        sprintf (t, "%s0x0.%s000p%ld;", (i & 1) ? "-" : "",
+                 s + (i & 1), (long) e * 4);
+      else
+        sprintf (t, "%s0.%s@%ld;", (i & 1) ? "-" : "00",
+                 s + (i & 1), (long) e);
+      RND_LOOP (r)
+        {
+          inex1 = mpfr_strtofr (y, t, &end, b == 16 && (i & 2) ? 0 : b,
+                                (mpfr_rnd_t) r);
+          inex2 = mpfr_set (z, x, (mpfr_rnd_t) r);
+          if (!mpfr_equal_p (y, z) || SIGN (inex1) != SIGN (inex2)
+              || *end != ';')
+            {
+              printf ("Error in check_pow2 for %s, %s\n",
+                      t, mpfr_print_rnd_mode ((mpfr_rnd_t) r));
+              printf ("Expected inex = %d, x = ", inex2);
+              mpfr_dump (z);
+              printf ("Got      inex = %d, x = ", inex1);
+              mpfr_dump (y);
+              printf ("end = \"%s\"\n", end);
+              exit (1);
+            }
+        }
+      tests_free (t, strlen (s) + 64);
+      mpfr_free_str (s);
+    }
+  mpfr_clears (x, y, z, (mpfr_ptr) 0);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -1203,6 +1350,9 @@ main (int argc, char *argv[])
   test20100310 ();
   bug20120814 ();
   bug20120829 ();
+  check_buffer ();
+  check_fast ();
+  check_pow2 ();
 
   tests_end_mpfr ();
   return 0;